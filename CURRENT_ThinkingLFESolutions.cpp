@@ -31,18 +31,94 @@
 #include <cctype>            // Character type checking
 #include <algorithm>         // STL algorithms
 #include <vector>            // Dynamic arrays for audio buffers
+#include <memory>            // Allocator base for the uninitialized planar buffer
 #include <random>            // Random number generation for grain randomization
 #include <cstdint>           // Fixed-width integer types
 #include <limits>            // Numeric limits
-
-// Apple Core Audio Framework Headers
+#include <numeric>           // std::gcd for resampling ratios
+#include <new>               // Replaceable allocation functions (allocation guard test mode)
+#include <cstdio>            // Low-level diagnostics safe to print from the audio thread
+#include <cstdlib>           // malloc/free/abort for the allocation guard
+
+// POSIX file mapping and resource usage (source loader)
+#include <sys/mman.h>        // mmap/madvise for the mapped source loader
+#include <sys/stat.h>        // File size for the mapping
+#include <sys/resource.h>    // Peak resident set size report
+#include <fcntl.h>           // open()
+#include <unistd.h>          // close(), sysconf()
+
+// Apple Core Audio Framework Headers (elsewhere, or with -DGRANULAR_HEADLESS, only the offline renderer is built)
+#if defined(__APPLE__) && !defined(GRANULAR_HEADLESS)
 #include <CoreAudio/CoreAudio.h>    // Core Audio system interface
 #include <AudioUnit/AudioUnit.h>    // Audio Unit processing framework
+#elif !defined(GRANULAR_HEADLESS)
+#define GRANULAR_HEADLESS
+#endif
 
 // Threading and Timing Headers
 #include <chrono>            // High-resolution timing
 #include <thread>            // Multi-threading support
+#include <atomic>            // Lock-free flags shared between audio and control threads
+
+// SIMD intrinsics for the grain kernels (variants are selected at runtime)
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#ifdef GRANULAR_HEADLESS
+// =============================================================================
+// CORE AUDIO TYPES FOR HEADLESS BUILDS
+// =============================================================================
+
+/**
+ * The engine itself only touches Core Audio's plain data types: the render
+ * callback signature, the buffer list it fills and the stream description.
+ * Headless builds (Linux build servers, -DGRANULAR_HEADLESS) declare the same
+ * layouts here and leave out device selection, the HAL output unit and the
+ * live control loop; they render offline to WAV (see OFFLINE RENDER).
+ */
+typedef uint32_t UInt32;
+typedef int32_t  OSStatus;
+typedef double   Float64;
+typedef uint32_t AudioUnitRenderActionFlags;
+
+enum : OSStatus { noErr = 0 };
+
+struct AudioBuffer {
+    UInt32 mNumberChannels;
+    UInt32 mDataByteSize;
+    void*  mData;
+};
+
+struct AudioBufferList {
+    UInt32      mNumberBuffers;
+    AudioBuffer mBuffers[1];    // Variable length, as in Core Audio
+};
+
+struct AudioTimeStamp {
+    Float64  mSampleTime;
+    uint64_t mHostTime;
+    Float64  mRateScalar;
+    uint64_t mWordClockTime;
+    UInt32   mFlags;
+};
+
+struct AudioStreamBasicDescription {
+    Float64 mSampleRate;
+    UInt32  mFormatID;
+    UInt32  mFormatFlags;
+    UInt32  mBytesPerPacket;
+    UInt32  mFramesPerPacket;
+    UInt32  mBytesPerFrame;
+    UInt32  mChannelsPerFrame;
+    UInt32  mBitsPerChannel;
+    UInt32  mReserved;
+};
+#endif
 
+#ifndef GRANULAR_HEADLESS
 // =============================================================================
 // AUDIO DEVICE MANAGEMENT SYSTEM
 // =============================================================================
@@ -158,6 +234,7 @@ int getAudioDevices() {
     delete[] array_devices;
     return selection_device;
 }
+#endif // GRANULAR_HEADLESS
 
 // =============================================================================
 // GLOBAL STATE MANAGEMENT SYSTEM
@@ -531,44 +608,159 @@ void function_anchor_configure(uint32_t outChannels, bool is_initial_setup = tru
 
 
 
+constexpr std::size_t kframes_envelope = 1024;
 
-inline bool function_channel_chosen(UInt32 ichannel, UInt32 outChannels) {
-    // Always allow all channels during audio playback to prevent channel disappearing
-    return true;
+/**
+ * SHARED ENVELOPE TABLE REGISTRY
+ *
+ * Envelope shapes are computed once at startup and never written again.
+ * Grains keep a pointer to the table that was active when they spawned, so
+ * spawning costs the same at any table resolution and changing the shape
+ * (live key 'e') is a single atomic pointer publish; grains already sounding
+ * finish with the shape they started with.
+ */
+struct struct_envelope_table {
+    const char* name_envelope;                  // Display name for the live controls
+    float frames_envelope[kframes_envelope + 1];  // Immutable gain curve, 0..1 across the grain, plus one guard point
+    float envelope_rms;                           // RMS of the curve, for gain normalization
+};
+
+/**
+ * FIXED-POINT ENVELOPE PHASE
+ * Each grain walks its envelope with a 16.16 fixed-point phase. The increment
+ * (table steps per output frame) is computed once at spawn, so the inner loop
+ * needs no division; the fractional bits drive a linear interpolation between
+ * neighbouring table entries, which keeps long grains free of zipper noise.
+ * The guard point repeats the last entry so index + 1 is always readable.
+ */
+constexpr uint32_t kbits_fraction_envelope = 16;
+constexpr float kscale_fraction_envelope = 1.0f / static_cast<float>(1u << kbits_fraction_envelope);
+
+inline uint32_t function_envelope_increment(uint32_t iframes_grain) {
+    // Spans the table over frames 0..N-1 of the grain; rounded down so the last
+    // frame lands on (or just before) the final entry and never past the guard point
+    return static_cast<uint32_t>((static_cast<uint64_t>(kframes_envelope - 1) << kbits_fraction_envelope) /
+                                 std::max<uint32_t>(iframes_grain - 1, 1));
+}
+
+inline float function_envelope_lookup(const float* iframes_envelope, uint32_t iphase) {
+    const uint32_t index_envelope = iphase >> kbits_fraction_envelope;
+    const float fraction = static_cast<float>(iphase & ((1u << kbits_fraction_envelope) - 1)) * kscale_fraction_envelope;
+    const float value_low = iframes_envelope[index_envelope];
+    return value_low + fraction * (iframes_envelope[index_envelope + 1] - value_low);
 }
 
+enum : std::size_t {
+    kenvelope_hann = 0,
+    kenvelope_tukey,
+    kenvelope_gaussian,
+    kenvelope_triangle,
+    kcount_envelope_tables
+};
+
+struct_envelope_table garray_envelope_tables[kcount_envelope_tables];
+
+std::atomic<const struct_envelope_table*> g_envelope_active{&garray_envelope_tables[kenvelope_hann]};
+
+/**
+ * PERFORMANCE OPTIMIZATION CONSTANT
+ * Capacity of the grain pool: the most grains that can ever sound at once.
+ * The audible limit is the runtime polyphony setting (g_grain_polyphony),
+ * which can be raised live up to this capacity for dense clouds.
+ */
+static const int max_density_cloud_grain = 4096;
+
+std::atomic<uint32_t> g_grain_polyphony{8};   // Runtime polyphony limit (live key 'v'), 1..max_density_cloud_grain
+
+// Source interpolation for transposed grains (live key 'i'); read once per block
+enum : int {
+    kinterpolation_linear = 0,
+    kinterpolation_hermite,
+    kinterpolation_sinc,
+    kcount_interpolation_modes
+};
+
+const char* const garray_names_interpolation[kcount_interpolation_modes] = {"Linear", "Cubic Hermite", "Windowed sinc (8-16 taps, band-limited)"};
+
+std::atomic<int> g_interpolation_mode{kinterpolation_hermite};
+
+constexpr float krate_grain_max = 2.0f;   // Fastest grain playback rate (travel factor 0.5); bounds source spans per block
+
+// Widest travel variation: the shortest grain (factor 1 - this) plays at exactly krate_grain_max
+constexpr float kpercent_travel_max = 100.0f * (1.0f - 1.0f / krate_grain_max);
+
+/**
+ * MULTI-FILE SOURCE BANK
+ *
+ * Grains can draw from a bank of sources instead of only the primary file.
+ * Every grain carries a source ID:
+ * • ID 0 is the primary source (global_AudioFileData: resident, sidecar-mapped
+ *   or streaming)
+ * • IDs 1..count_sources-1 are the extra files named at startup, all decoded
+ *   and resampled to the engine rate into one contiguous arena
+ *
+ * The arena is a single 64-byte-aligned allocation. A flat index of offsets,
+ * channel strides, lengths and channel counts (one fixed-size array per
+ * field) locates each source, and every channel starts on a 64-byte
+ * boundary. The callback turns (source, channel, frame) into a pointer with
+ * one multiply-add, without allocating or following nested vectors.
+ *
+ * Each bank source is read at the primary play head's relative position, so
+ * sources of different lengths are traversed together. New grains read the
+ * selected source (live key 'b'), or a random bank source per grain.
+ */
+constexpr uint32_t kcount_sources_max = 64;          // Bank capacity, including the primary source
+constexpr size_t kbytes_arena_align = 64;
+constexpr int ksource_random = -1;                    // g_source_selection: a random bank source per grain
+
+struct struct_source_bank {
+    float* arena = nullptr;                           // Every extra source, channel after channel
+    size_t floats_arena = 0;
+    uint32_t count_sources = 1;                       // ID 0 (the primary source) always exists
+    uint64_t offset_source[kcount_sources_max];       // Floats from the arena start to channel 0
+    uint64_t stride_channel[kcount_sources_max];      // Floats between channel starts (64-byte multiple)
+    uint32_t frames_source[kcount_sources_max];       // Engine-rate frames per channel
+    uint16_t channels_source[kcount_sources_max];
+    std::string name_source[kcount_sources_max];      // For reports only
+};
+
+struct_source_bank global_SourceBank;
+std::vector<std::string> g_names_bank;                // Extra files named at startup
+std::atomic<int> g_source_selection{0};               // Bank source new grains read, or ksource_random
 
 /**
- * GRANULAR SYNTHESIS GRAIN STRUCTURE
+ * GRANULAR SYNTHESIS GRAIN POOL (STRUCT-OF-ARRAYS)
  * 
- * This structure represents a single grain in the granular synthesis process.
  * Each grain is a small segment of audio with its own envelope, timing, and
- * spatial target. The system can process multiple grains simultaneously for
- * rich, complex textures.
+ * spatial target. Grain state is stored field-by-field in contiguous arrays
+ * indexed by slot number, so the callback streams through a few small arrays
+ * instead of striding over large per-grain records.
  * 
  * TECHNICAL DESIGN:
- * - Optimized for real-time processing with minimal memory footprint
- * - Contains pre-calculated envelope data for efficiency
- * - Tracks both source position and playback progress independently
- * - Includes spatial routing information for multi-channel output
- */
-struct struct_grain {
-    uint32_t address_start_frame;       // Starting position in source audio file
-    uint32_t address_present_grain;     // Current playback position within this grain
-    uint32_t frames_grain;              // Total length of this grain in samples
-    float gain_grain;                   // Volume scaling factor for this grain
-    float frames_gain_envelope[1024];   // Pre-calculated envelope shape for smooth fading
-    bool status_callback_grain;         // Active flag: true = processing, false = available for reuse
-    int target_object;                  // Spatial target: 1-3 for objects, -1 for silence, -2 for all channels
+ * - Hot state (positions, lengths, gains, targets, rates) is 4 bytes per field
+ *   per grain: 1024 live grains touch roughly 40 KB, which stays L1/L2 resident
+ * - The free-list pops recently retired slots first, so live grains cluster
+ *   in the low slots of every array
+ * - Envelopes are shared read-only tables referenced by pointer, never copied
+ */
+struct struct_grain_pool {
+    uint32_t address_start_frame[max_density_cloud_grain];     // Starting position in source audio file
+    uint32_t address_present_grain[max_density_cloud_grain];   // Current playback position within this grain
+    uint32_t frames_grain[max_density_cloud_grain];            // Total length of this grain in samples
+    float    gain_grain[max_density_cloud_grain];              // Volume scaling factor for this grain
+    float    gain_normalized_grain[max_density_cloud_grain];   // gain_grain x density normalization (spawn / density publish)
+    int32_t  target_object[max_density_cloud_grain];           // Spatial target: 1-3 for objects, -1 for silence, -2 for all channels
+    float    rate_grain[max_density_cloud_grain];              // Source frames advanced per output frame (1.0 = original pitch)
+    uint16_t source_grain[max_density_cloud_grain];            // Source bank ID the grain reads (0 = primary file)
+    uint32_t frames_delay_onset[max_density_cloud_grain];      // Frames into the spawning block before the grain starts sounding
+    uint32_t index_active_grain[max_density_cloud_grain];      // Position of the slot in the active index (for O(1) retirement)
+    bool     status_callback_grain[max_density_cloud_grain];   // Active flag: true = processing, false = available for reuse
+    const struct_envelope_table* envelope_grain[max_density_cloud_grain];  // Shared envelope shape captured at spawn
+    uint32_t phase_envelope_grain[max_density_cloud_grain];    // 16.16 fixed-point envelope position
+    uint32_t increment_envelope_grain[max_density_cloud_grain];// 16.16 envelope steps per output frame, set at spawn
 };
 
-/**
- * PERFORMANCE OPTIMIZATION CONSTANT
- * Maximum number of simultaneous grains supported by the system.
- * This value balances audio quality (more grains = richer texture) with
- * real-time performance requirements (fewer grains = lower CPU usage).
- */
-static const int max_density_cloud_grain = 128;
+constexpr uint32_t kslot_none_grain = 0xFFFFFFFFu;   // Returned when no grain slot is available
 
 /**
  * GRANULAR SYNTHESIS ENGINE CONTROL STRUCTURE
@@ -584,22 +776,100 @@ static const int max_density_cloud_grain = 128;
  * - Provides centralized control for all synthesis parameters
  */
 struct struct_process_grain {
-    struct_grain object_array_grains[max_density_cloud_grain];  // Pool of grain objects for reuse
+    struct_grain_pool pool_grains;                              // Struct-of-arrays pool of grain slots for reuse
+    uint32_t array_free_grains[max_density_cloud_grain];        // Free-list stack of available slot numbers
+    uint32_t count_free_grains;                                 // Number of entries on the free-list stack
+    uint32_t array_active_grains[max_density_cloud_grain];      // Dense index of slots currently sounding
     uint32_t frames_object_grain;      // Default grain length in samples
     uint32_t frames_common_grains;     // Shared parameter for grain processing
     uint32_t count_present_grain;      // Current grain counter for timing
-    uint32_t count_present_frame;      // Frame counter for grain triggering
-    uint32_t active_envelopes_grain;   // Number of currently active grains
+    double frames_until_onset;         // Fractional frames from the current block start to the next grain onset
+    uint32_t frames_interval_normalization; // Onset interval the grain gains were normalized against
+    uint32_t generation_density;       // Last g_density_generation applied by the callback
+    uint32_t active_envelopes_grain;   // Number of currently active grains (length of array_active_grains)
     bool status_process_grain;         // Master enable flag for grain processing
 };
 
 struct_process_grain global_ProcessGrain{};
 
-constexpr std::size_t kframes_envelope = 1024;
+/**
+ * O(1) GRAIN SLOT MANAGEMENT
+ *
+ * Free slots live on a stack and sounding slots in a dense active index, so
+ * spawning pops one slot and retiring swaps the last active entry into the
+ * hole. The callback only walks array_active_grains, never the whole pool.
+ */
+void function_grain_pool_reset() {
+    global_ProcessGrain.count_free_grains = 0;
+    for (uint32_t slot = max_density_cloud_grain; slot-- > 0;) {
+        global_ProcessGrain.pool_grains.status_callback_grain[slot] = false;
+        global_ProcessGrain.array_free_grains[global_ProcessGrain.count_free_grains++] = slot;
+    }
+    global_ProcessGrain.active_envelopes_grain = 0;
+    global_ProcessGrain.generation_density = 0;   // Next block re-reads the density parameters
+}
+
+uint32_t function_grain_acquire() {
+    if (global_ProcessGrain.active_envelopes_grain >= g_grain_polyphony.load(std::memory_order_relaxed) ||
+        global_ProcessGrain.count_free_grains == 0) {
+        return kslot_none_grain;
+    }
+
+    uint32_t slot = global_ProcessGrain.array_free_grains[--global_ProcessGrain.count_free_grains];
 
-float garray_frames_envelope[kframes_envelope];
+    global_ProcessGrain.pool_grains.index_active_grain[slot] = global_ProcessGrain.active_envelopes_grain;
+    global_ProcessGrain.array_active_grains[global_ProcessGrain.active_envelopes_grain++] = slot;
+    return slot;
+}
+
+void function_grain_retire(uint32_t iindex_active) {
+    uint32_t slot = global_ProcessGrain.array_active_grains[iindex_active];
+    uint32_t slot_last = global_ProcessGrain.array_active_grains[--global_ProcessGrain.active_envelopes_grain];
+
+    // Swap the last active grain into the hole left by the retired one
+    global_ProcessGrain.array_active_grains[iindex_active] = slot_last;
+    global_ProcessGrain.pool_grains.index_active_grain[slot_last] = iindex_active;
+
+    global_ProcessGrain.pool_grains.status_callback_grain[slot] = false;
+    global_ProcessGrain.array_free_grains[global_ProcessGrain.count_free_grains++] = slot;
+}
+
+/**
+ * DENSITY NORMALIZATION
+ *
+ * Overlapping grains sum roughly in power, so each grain is scaled by
+ * kTargetRMS / (envelope RMS x sqrt(N_eff)), with N_eff = max(1, length / interval).
+ * The value is stored with the grain at spawn and recomputed only when the
+ * control thread publishes new density parameters (g_density_generation),
+ * so the per-grain render loop does no transcendental math.
+ */
+constexpr float ktarget_rms_grain = 0.2f;
+
+#ifdef GRANULAR_BENCHMARK
+uint64_t g_count_normalization = 0;   // sqrt evaluations, reported by the benchmark
+#endif
+
+inline float function_grain_normalization(uint32_t iframes_grain, uint32_t iframes_interval, float ienvelope_rms) {
+#ifdef GRANULAR_BENCHMARK
+    ++g_count_normalization;
+#endif
+    double rho = double(iframes_grain) / double(iframes_interval);
+    double N_eff = std::max(1.0, rho);
+    return ktarget_rms_grain / (ienvelope_rms * std::sqrt(N_eff));
+}
+
+// Renormalize every sounding grain against the current interval (density publish only)
+void function_grain_normalization_refresh() {
+    struct_grain_pool& pool = global_ProcessGrain.pool_grains;
+    for (uint32_t index_active = 0; index_active < global_ProcessGrain.active_envelopes_grain; ++index_active) {
+        const uint32_t slot = global_ProcessGrain.array_active_grains[index_active];
+        pool.gain_normalized_grain[slot] = pool.gain_grain[slot] *
+            function_grain_normalization(pool.frames_grain[slot],
+                                         global_ProcessGrain.frames_interval_normalization,
+                                         pool.envelope_grain[slot]->envelope_rms);
+    }
+}
 
-float g_envelope_rms = 0.612372f;
 
 AudioStreamBasicDescription g_output_asbd{};
 bool g_output_is_float = true;
@@ -608,11 +878,335 @@ bool g_output_non_interleaved = true;
 UInt32 g_output_bits_per_channel = 32;
 double g_output_sample_rate = 48000.0;
 
+// =============================================================================
+// PREALLOCATED MIX BUS & ALLOCATION GUARD
+// =============================================================================
+
+/**
+ * PLANAR MIX BUS
+ *
+ * The callback accumulates every grain into a planar [channel][frame] bus before
+ * converting to the device format. The bus is owned by the engine and sized once
+ * for the largest block the device may request, so the real-time thread never
+ * touches the heap.
+ *
+ * RESIZING PROTOCOL:
+ * - function_mix_bus_prepare() is the only function that allocates the bus and
+ *   must run with the audio unit stopped (setup, or the control thread).
+ * - If the callback receives a block larger than the bus (device format change),
+ *   it outputs silence and raises g_mix_bus_resize_pending. The control thread
+ *   then stops the unit, re-sizes the bus and restarts playback.
+ *
+ * PROCESSING QUANTUM:
+ * The engine never renders at the host's block size. Grains, spawns, the dry
+ * path, channel gains and the limiter all run on fixed quanta of
+ * g_frames_quantum frames into frames_quantum; the callback copies quanta
+ * out into frames_mix until the host block is full, and the unread tail of
+ * the last quantum waits in frames_quantum for the next callback. The
+ * output is therefore the same sample stream whatever block sizes the
+ * device asks for, and the per-grain scratch only needs one quantum.
+ * Quanta are rendered on demand, so the FIFO adds no signal delay; control
+ * changes land on quantum boundaries.
+ */
+constexpr UInt32 kframes_quantum_default = 64;
+constexpr UInt32 kframes_quantum_min = 16;
+constexpr UInt32 kframes_quantum_max = 1024;
+
+UInt32 g_frames_quantum = kframes_quantum_default;   // Read by function_mix_bus_prepare; set only while stopped
+
+struct struct_mix_bus {
+    std::vector<float> frames_mix;      // Planar samples, channel stride = frames of the current host block
+    std::vector<float> frames_quantum;  // Planar FIFO: the last rendered quantum, channel stride = frames_per_quantum
+    std::vector<float> frames_weight;   // Per-grain scratch: envelope x gain for one quantum
+    std::vector<int32_t> frames_index;  // Per-grain scratch: integer source read index per frame
+    std::vector<float> frames_coefficient; // Per-grain scratch: interpolation coefficients, up to 4 per frame
+    std::vector<float> frames_resampled;   // Per-channel scratch: interpolated source run
+    std::vector<float> frames_stream;      // Per-channel scratch: source span copied out of the streaming cache
+    std::vector<uint32_t> state_dither;    // Per-channel requantizer: xorshift32 dither generator state
+    std::vector<float> error_shaping;      // Per-channel requantizer: noise-shaping error history, [tap][channel]
+    std::vector<float> gain_channel;       // Per-output-channel gain reached at the end of the last block
+    UInt32 channels_capacity_mix;       // Largest channel count the bus can hold
+    UInt32 frames_capacity_mix;         // Largest block size (frames) the bus can hold
+    UInt32 frames_per_quantum;          // Fixed render size, g_frames_quantum at prepare
+    UInt32 frames_quantum_read;         // Frames of frames_quantum already handed to the host (= quantum: empty)
+    UInt32 channels_quantum;            // Channel count the FIFO quantum was rendered for
+};
+
+struct_mix_bus global_MixBus{};
+
+constexpr uint32_t ktaps_shaping = 5;   // Longest requantizer noise-shaping filter
+
+// Requantizer modes for integer outputs (live key 'n', see REQUANTIZATION)
+enum : int {
+    kquantize_round = 0,
+    kquantize_tpdf,
+    kquantize_tpdf_first,
+    kquantize_tpdf_second,
+    kquantize_tpdf_eweighted,
+    kcount_quantize_modes
+};
+
+struct struct_quantize_mode {
+    const char* name_mode;
+    const char* keyword_mode;                  // Offline render option value
+    float amplitude_dither;                    // 1.0 = TPDF spanning +/-1 LSB
+    float coefficients[ktaps_shaping];         // h[0] multiplies the most recent error
+};
+
+const struct_quantize_mode garray_quantize_modes[kcount_quantize_modes] = {
+    {"Round (no dither)",                  "round",      0.0f, {0.0f, 0.0f, 0.0f, 0.0f, 0.0f}},
+    {"TPDF dither",                        "tpdf",       1.0f, {0.0f, 0.0f, 0.0f, 0.0f, 0.0f}},
+    {"TPDF + 1st-order shaping",           "first",      1.0f, {1.0f, 0.0f, 0.0f, 0.0f, 0.0f}},
+    {"TPDF + 2nd-order shaping",           "second",     1.0f, {2.0f, -1.0f, 0.0f, 0.0f, 0.0f}},
+    {"TPDF + E-weighted shaping (5 tap)",  "e-weighted", 1.0f, {2.033f, -2.165f, 1.959f, -1.590f, 0.6149f}},
+};
+
+std::atomic<int> g_quantize_mode{kquantize_tpdf};
+
+std::atomic<bool>   g_mix_bus_resize_pending{false};  // Raised by the callback, serviced by the control thread
+std::atomic<UInt32> g_mix_bus_request_channels{0};    // Channel count the callback could not fit
+std::atomic<UInt32> g_mix_bus_request_frames{0};      // Block size the callback could not fit
+
+constexpr UInt32 kframes_default_slice = 4096;        // Core Audio's default maximum frames per slice
+
+/**
+ * MASTER BUS LIMITER STATE
+ *
+ * Delay line, detector scratch and smoothing rings for the look-ahead
+ * limiter (see MASTER BUS LIMITER). Sized with the mix bus for the longest
+ * look-ahead at the device rate, so parameter changes never allocate.
+ * Parameters are published by the control thread (live key 'l') and picked
+ * up at the next block.
+ */
+constexpr float kms_lookahead_max = 10.0f;        // Longest configurable look-ahead
+constexpr uint32_t kframes_detector_lag = 2;      // The true-peak midpoint reads two frames ahead
+
+struct struct_limiter {
+    std::vector<float> frames_delay;      // Planar [channel][history + block]: oldest sample first
+    std::vector<float> frames_peak;       // Per-frame linked true-peak of the detected block
+    std::vector<float> frames_gain;       // Per-frame gain for the outgoing block
+    std::vector<float> values_hold;       // Sliding-minimum ring (monotonic deque): target gains
+    std::vector<uint32_t> frames_hold;    // Sliding-minimum ring: frame stamps of those gains
+    std::vector<float> values_attack;     // Box-filter ring over the attack window
+    UInt32 stride_delay = 0;              // Row length of frames_delay
+    UInt32 frames_history = 0;            // Samples kept from earlier blocks at the head of each row
+    UInt32 frames_lookahead_capacity = 0; // Longest look-ahead the rings can hold
+    UInt32 channels_limiter = 0;
+
+    // Running state, reset whenever the look-ahead or attack length changes
+    UInt32 frames_lookahead = 0;
+    UInt32 frames_attack = 0;
+    uint32_t clock_detector = 0;          // Frames detected since the reset
+    uint32_t head_hold = 0;               // Oldest deque entry (ring index)
+    uint32_t count_hold = 0;
+    uint32_t index_attack = 0;
+    double sum_attack = 0.0;
+    float gain_release = 1.0f;
+    bool status_primed = false;           // False until the first block after a reset or bypass
+};
+
+struct_limiter global_Limiter{};
+
+std::atomic<bool>  g_limiter_enabled{true};
+std::atomic<float> g_limiter_ceiling_db{-1.0f};   // True-peak ceiling, dBFS
+std::atomic<float> g_limiter_attack_ms{1.0f};     // Gain ramp into a peak, at most the look-ahead
+std::atomic<float> g_limiter_release_ms{80.0f};   // Time constant of the recovery after a peak
+std::atomic<float> g_limiter_lookahead_ms{1.5f};  // Delay the detector runs ahead of the output
+
+void function_limiter_prepare(UInt32 ichannels, UInt32 iframes_max) {
+    global_Limiter.frames_lookahead_capacity = static_cast<UInt32>(std::ceil(kms_lookahead_max * 0.001 * g_output_sample_rate));
+    global_Limiter.frames_history = global_Limiter.frames_lookahead_capacity + kframes_detector_lag + 1;
+    global_Limiter.stride_delay = global_Limiter.frames_history + iframes_max;
+    global_Limiter.channels_limiter = ichannels;
+    global_Limiter.frames_delay.assign(static_cast<size_t>(ichannels) * global_Limiter.stride_delay, 0.0f);
+    global_Limiter.frames_peak.assign(iframes_max, 0.0f);
+    global_Limiter.frames_gain.assign(iframes_max, 1.0f);
+    global_Limiter.values_hold.assign(global_Limiter.frames_lookahead_capacity + 1, 1.0f);
+    global_Limiter.frames_hold.assign(global_Limiter.frames_lookahead_capacity + 1, 0);
+    global_Limiter.values_attack.assign(global_Limiter.frames_lookahead_capacity + 1, 1.0f);
+    global_Limiter.status_primed = false;
+}
+
+UInt32 function_limiter_frames_lookahead() {
+    const long frames = std::lround(g_limiter_lookahead_ms.load(std::memory_order_relaxed) * 0.001 * g_output_sample_rate);
+    return std::min<UInt32>(global_Limiter.frames_lookahead_capacity, static_cast<UInt32>(std::max(0L, frames)));
+}
+
+UInt32 function_limiter_latency() {
+    return g_limiter_enabled.load() ? function_limiter_frames_lookahead() + kframes_detector_lag : 0;
+}
+
+void function_limiter_report() {
+    if (!g_limiter_enabled.load()) {
+        std::cout << "Master limiter: bypassed (no latency)\n";
+        return;
+    }
+    const UInt32 frames_latency = function_limiter_latency();
+    std::cout << "Master limiter: ceiling " << g_limiter_ceiling_db.load() << " dBTP, attack " << g_limiter_attack_ms.load()
+              << " ms, release " << g_limiter_release_ms.load() << " ms, look-ahead " << g_limiter_lookahead_ms.load()
+              << " ms (latency " << frames_latency << " frames, " << frames_latency * 1000.0 / g_output_sample_rate << " ms)\n";
+}
+
+/**
+ * OUTPUT CHANNEL GAIN AND MUTE
+ *
+ * One trim and one mute flag per output channel, edited by the control
+ * thread (live key 'm') and read by the callback once per block. Grain
+ * routing is untouched: a muted speaker keeps receiving its grains, they
+ * are just not heard. Each block ramps every channel linearly from the gain
+ * it ended the last block on towards trim x (1 - mute), at most full scale
+ * per kms_channel_gain_ramp, so changes during a show never click. Channels
+ * past kcount_channels_gain stay at unity.
+ */
+constexpr UInt32 kcount_channels_gain = 128;
+constexpr float kms_channel_gain_ramp = 20.0f;    // Ramp time for a full-scale (0 <-> 1) change
+constexpr float kdb_channel_trim_min = -60.0f;
+constexpr float kdb_channel_trim_max = 6.0f;
+
+struct struct_channel_gain {
+    std::atomic<float> trim{1.0f};      // Linear gain, 1.0 = unity
+    std::atomic<bool>  mute{false};
+};
+
+struct_channel_gain garray_channel_gains[kcount_channels_gain];
+
+void function_channel_gains_reset() {
+    for (struct_channel_gain& gain : garray_channel_gains) {
+        gain.trim.store(1.0f);
+        gain.mute.store(false);
+    }
+}
+
+float function_channel_gain_target(UInt32 ichannel) {
+    if (ichannel >= kcount_channels_gain) return 1.0f;
+    const struct_channel_gain& gain = garray_channel_gains[ichannel];
+    return gain.trim.load(std::memory_order_relaxed) * static_cast<float>(!gain.mute.load(std::memory_order_relaxed));
+}
+
+void function_requantizer_reset() {
+    for (size_t ch = 0; ch < global_MixBus.state_dither.size(); ++ch) {
+        global_MixBus.state_dither[ch] = 0x9E3779B9u * static_cast<uint32_t>(ch + 1);   // Odd multiplier: never zero
+    }
+    std::fill(global_MixBus.error_shaping.begin(), global_MixBus.error_shaping.end(), 0.0f);
+}
+
+// Drops whatever is left of the current quantum; the next callback renders a fresh one
+void function_quantum_fifo_reset() {
+    global_MixBus.frames_quantum_read = global_MixBus.frames_per_quantum;
+    global_MixBus.channels_quantum = 0;
+}
+
+void function_mix_bus_prepare(UInt32 ichannels, UInt32 iframes_max) {
+    if (ichannels < 1) ichannels = 1;
+    if (iframes_max < 1) iframes_max = kframes_default_slice;
+    const UInt32 frames_quantum = std::clamp(g_frames_quantum, kframes_quantum_min, kframes_quantum_max);
+
+    global_MixBus.frames_mix.assign(static_cast<size_t>(ichannels) * static_cast<size_t>(iframes_max), 0.0f);
+    global_MixBus.frames_quantum.assign(static_cast<size_t>(ichannels) * frames_quantum, 0.0f);
+    global_MixBus.frames_weight.assign(frames_quantum, 0.0f);
+    global_MixBus.frames_index.assign(frames_quantum, 0);
+    global_MixBus.frames_coefficient.assign(4 * static_cast<size_t>(frames_quantum), 0.0f);
+    global_MixBus.frames_resampled.assign(frames_quantum, 0.0f);
+    global_MixBus.frames_stream.assign(static_cast<size_t>(std::ceil(frames_quantum * krate_grain_max)) + 16, 0.0f);   // Widest tap span
+    global_MixBus.state_dither.resize(ichannels);
+    global_MixBus.error_shaping.resize(static_cast<size_t>(ktaps_shaping) * ichannels);
+    function_requantizer_reset();
+    function_limiter_prepare(ichannels, frames_quantum);
+    global_MixBus.gain_channel.resize(ichannels);
+    for (UInt32 ch = 0; ch < ichannels; ++ch) global_MixBus.gain_channel[ch] = function_channel_gain_target(ch);   // No ramp at start
+    global_MixBus.channels_capacity_mix = ichannels;
+    global_MixBus.frames_capacity_mix = iframes_max;
+    global_MixBus.frames_per_quantum = frames_quantum;
+    function_quantum_fifo_reset();
+    g_mix_bus_resize_pending.store(false);
+
+    std::cout << "Mix bus prepared: " << ichannels << " channels x " << iframes_max << " frames (" << frames_quantum
+              << "-frame processing quantum)\n";
+}
+
+/**
+ * States the engine's timing for the negotiated device: the fixed quantum,
+ * the host block range the FIFO absorbs, and the end-to-end processing
+ * latency the host should compensate (only the limiter delays the signal).
+ */
+void function_quantum_report() {
+    const double ms_per_frame = 1000.0 / g_output_sample_rate;
+    const UInt32 frames_quantum = global_MixBus.frames_per_quantum;
+    const UInt32 frames_latency = function_limiter_latency();
+    std::cout << "Processing quantum: " << frames_quantum << " frames (" << frames_quantum * ms_per_frame
+              << " ms); host blocks of 1-" << global_MixBus.frames_capacity_mix << " frames are served from the quantum FIFO\n"
+              << "Processing latency: " << frames_latency << " frames (" << frames_latency * ms_per_frame
+              << " ms, limiter look-ahead; the FIFO adds none); control changes are heard from the next quantum boundary\n";
+}
+
+/**
+ * ALLOCATION GUARD TEST MODE
+ *
+ * Build with -DGRANULAR_ALLOCATION_GUARD to replace the global allocation
+ * functions. While the audio callback is running, any operator new/delete on
+ * that thread prints a diagnostic and aborts, so a single stray allocation in
+ * the render path fails the run instead of surfacing later as an xrun.
+ */
+#ifdef GRANULAR_ALLOCATION_GUARD
+thread_local bool tls_status_callback_active = false;
+
+static void function_allocation_violation(const char* ioperation) {
+    std::fprintf(stderr, "ALLOCATION GUARD: %s on the audio thread\n", ioperation);
+    std::abort();
+}
+
+// Out of line so the compiler cannot pair the malloc/free below with the replaced
+// operators and flag them as mismatched (-Wmismatched-new-delete); they match by design
+__attribute__((noinline)) static void* function_allocation_acquire(std::size_t isize) {
+    return std::malloc(isize ? isize : 1);
+}
+__attribute__((noinline)) static void function_allocation_release(void* iaddress) {
+    std::free(iaddress);
+}
+
+void* operator new(std::size_t isize) {
+    if (tls_status_callback_active) function_allocation_violation("operator new");
+    void* address_block = function_allocation_acquire(isize);
+    if (!address_block) throw std::bad_alloc();
+    return address_block;
+}
+void* operator new[](std::size_t isize) {
+    if (tls_status_callback_active) function_allocation_violation("operator new[]");
+    void* address_block = function_allocation_acquire(isize);
+    if (!address_block) throw std::bad_alloc();
+    return address_block;
+}
+void operator delete(void* iaddress) noexcept {
+    if (iaddress && tls_status_callback_active) function_allocation_violation("operator delete");
+    function_allocation_release(iaddress);
+}
+void operator delete[](void* iaddress) noexcept {
+    if (iaddress && tls_status_callback_active) function_allocation_violation("operator delete[]");
+    function_allocation_release(iaddress);
+}
+void operator delete(void* iaddress, std::size_t) noexcept { operator delete(iaddress); }
+void operator delete[](void* iaddress, std::size_t) noexcept { operator delete[](iaddress); }
+
+// Marks the current thread as "inside the render callback" for its lifetime
+struct struct_callback_allocation_scope {
+    struct_callback_allocation_scope()  { tls_status_callback_active = true; }
+    ~struct_callback_allocation_scope() { tls_status_callback_active = false; }
+};
+#else
+// User-declared constructor and destructor keep -Wunused-variable quiet at the scope's call sites
+struct struct_callback_allocation_scope {
+    struct_callback_allocation_scope()  {}
+    ~struct_callback_allocation_scope() {}
+};
+#endif
+
 // Grain control parameters
 int g_jitter_range = 1000;  // Jitter range in frames
 float g_interval_multiplier = 0.5f;  // Interval = grain_length * this
+std::atomic<uint32_t> g_density_generation{1};  // Bumped after grain length or interval changes; the callback then renormalizes grains
 float g_travel_factor_min = 0.9f;  // Minimum scale factor
 float g_travel_factor_max = 1.1f;  // Maximum scale factor
+std::mt19937 g_rng_grain{std::random_device{}()};  // Grain randomness, drawn only on the audio thread; reseeded by --seed
 
 bool g_run_channel_order_test = false;
 uint32_t g_test_frames_per_channel = 24000;
@@ -639,90 +1233,506 @@ void triggerChannelOrderTest(uint32_t framesPerChannel,
     g_test_phase.assign(6, 0.0f);
 }
 
+// =============================================================================
+// AUDIO BACKENDS
+// =============================================================================
 
-// LIVE CONTROLS
+/**
+ * AUDIO BACKEND INTERFACE
+ *
+ * The engine is one render callback with Core Audio's signature. A backend
+ * owns the device that pulls it: it negotiates the stream format, installs
+ * the callback and starts / stops the pull, so playback, the live controls
+ * and the offline render do not care which device is behind them.
+ *
+ * - open: negotiate the format (ioformat in: request, out: what the device
+ *   will deliver) and install the callback. Does not start the pull.
+ * - start / stop: begin and pause pulling blocks; may be repeated.
+ * - close: release the device.
+ *
+ * Implementations: the Core Audio HAL output unit (macOS, interactive
+ * playback) and a null device on a simulated clock (every platform).
+ */
+typedef OSStatus (*function_render_t)(void* ibox_audio, AudioUnitRenderActionFlags* ioget_flag,
+                                      const AudioTimeStamp* struct_istamp_time, UInt32 iget_bus,
+                                      UInt32 icount_frames, AudioBufferList* struct_ioData_period_buffer);
+
+struct struct_backend_format {
+    UInt32 id_device = 0;           // Backend-specific device selection (Core Audio: AudioDeviceID)
+    double rate = 48000.0;
+    UInt32 channels = 2;
+    UInt32 frames_block_max = 0;    // Largest block the device will request
+    bool is_float = true;
+    bool non_interleaved = true;
+    UInt32 bits = 32;
+};
 
-void show_sequence_translations() {
-    if (g_use_grain_hopping && !g_grain_sequence.empty()) {
-        std::cout << "\nGenerating spatial translations for your current setup:\n";
-        std::cout << "Objects: " << (garray_channel_anchor[0] + 1) << ", " << (garray_channel_anchor[1] + 1) << ", " << (garray_channel_anchor[2] + 1) << "\n";
-        std::cout << "Current sequence: " << g_original_sequence_string << "\n\n";
-        
-        // Generate all 6 possible translation options (3! = 6 permutations)
-        int new_objects[3] = {(int)(garray_channel_anchor[0] + 1), (int)(garray_channel_anchor[1] + 1), (int)(garray_channel_anchor[2] + 1)};
-        int mappings[6][3] = {
-            {new_objects[0], new_objects[1], new_objects[2]}, 
-            {new_objects[0], new_objects[2], new_objects[1]}, 
-            {new_objects[1], new_objects[0], new_objects[2]}, 
-            {new_objects[1], new_objects[2], new_objects[0]}, 
-            {new_objects[2], new_objects[0], new_objects[1]}, 
-            {new_objects[2], new_objects[1], new_objects[0]}  
-        };
-        
-        std::cout << "Translation options (copy/paste-able):\n"; // I want to make this a "press 1, 2, 3, 4, 5, 6" to apply / try 
-        for (int option = 0; option < 6; ++option) {
-            std::cout << "Option " << (option + 1) << ": ";
-            std::string translated = g_original_sequence_string;
-            
-            // Apply string replacement logic
-            std::vector<std::pair<std::string, std::string>> replacements;
-            replacements.push_back({std::to_string(garray_channel_anchor[0] + 1), std::to_string(mappings[option][0])});
-            replacements.push_back({std::to_string(garray_channel_anchor[1] + 1), std::to_string(mappings[option][1])});
-            replacements.push_back({std::to_string(garray_channel_anchor[2] + 1), std::to_string(mappings[option][2])});
-            
-            std::sort(replacements.begin(), replacements.end(), 
-                     [](const auto& a, const auto& b) { return a.first.length() > b.first.length(); });
-            
-            for (const auto& replacement : replacements) {
-                size_t index_str = 0;
-                while ((index_str = translated.find(replacement.first, index_str)) != std::string::npos) {
-                    translated.replace(index_str, replacement.first.length(), replacement.second);
-                    index_str += replacement.second.length();
-                }
-            }
-            
-            std::cout << translated << "  (" << (garray_channel_anchor[0] + 1) << "→" << mappings[option][0]
-                      << ", " << (garray_channel_anchor[1] + 1) << "→" << mappings[option][1] 
-                      << ", " << (garray_channel_anchor[2] + 1) << "→" << mappings[option][2] << ")\n";
+struct struct_audio_backend {
+    const char* name_backend;
+    bool (*function_open)(struct_backend_format& ioformat, function_render_t irender, void* irefcon);
+    bool (*function_start)();
+    void (*function_stop)();
+    void (*function_close)();
+};
+
+/**
+ * NULL DEVICE
+ *
+ * Pulls blocks from the engine on a simulated sample clock, with no audio
+ * hardware. The stream format, block size and rate come from
+ * g_null_device_config. Each block's size is drawn uniformly within
+ * +/- frames_jitter of frames_block (seeded, so runs repeat), the way a
+ * HAL may hand out uneven slices; the time stamp carries the simulated
+ * clock.
+ *
+ * PACING:
+ * - Real time: block n is requested at clock n / rate of wall time, so the
+ *   engine sees a device's deadlines; a render that finishes after its
+ *   block's deadline counts as late (an xrun on a real device).
+ * - Fast: blocks are pulled back to back, for offline renders, benchmarks
+ *   and soak tests.
+ *
+ * An optional sink receives every rendered block on the device thread (the
+ * offline render writes its WAV there). With frames_total set, the device
+ * stops by itself after that many frames (function_null_device_wait).
+ */
+typedef void (*function_sink_t)(const AudioBufferList* ilist, UInt32 iframes, void* icontext);
+
+struct struct_null_device_config {
+    double rate = 48000.0;
+    UInt32 channels = 2;
+    UInt32 frames_block = 512;
+    UInt32 frames_jitter = 0;
+    bool status_realtime = false;
+    uint64_t frames_total = 0;      // 0 = run until stopped
+    uint32_t seed = 1;              // Block-size jitter
+    bool is_float = true;
+    bool non_interleaved = true;
+    UInt32 bits = 32;
+    function_sink_t function_sink = nullptr;
+    void* context_sink = nullptr;
+};
+
+struct struct_null_device_stats {
+    uint64_t count_blocks = 0;
+    uint64_t frames_rendered = 0;
+    uint64_t count_late = 0;        // Real-time pacing: renders that missed their block's deadline
+    UInt32 frames_block_min = 0;
+    UInt32 frames_block_max = 0;
+    double ns_render_total = 0.0;
+    double ns_render_max = 0.0;
+};
+
+struct struct_null_device {
+    std::vector<unsigned char> bytes_samples;   // Device buffers, sized at open for the largest block
+    std::vector<unsigned char> bytes_list;      // AudioBufferList with one buffer per channel (planar) or one
+    function_render_t function_render = nullptr;
+    void* refcon = nullptr;
+    std::thread thread_device;
+    std::atomic<bool> status_running{false};
+    struct_null_device_stats stats;
+};
+
+struct_null_device_config g_null_device_config{};
+struct_null_device global_NullDevice{};
+
+bool function_null_device_open(struct_backend_format& ioformat, function_render_t irender, void* irefcon) {
+    const struct_null_device_config& config = g_null_device_config;
+    if (config.channels < 1 || config.frames_block < 1 || config.rate <= 0.0 || config.frames_jitter >= config.frames_block) {
+        std::cerr << "Null device: invalid configuration (" << config.channels << " channels, " << config.frames_block
+                  << " +/- " << config.frames_jitter << " frames at " << config.rate << " Hz)\n";
+        return false;
+    }
+    ioformat.rate = config.rate;
+    ioformat.channels = config.channels;
+    ioformat.frames_block_max = config.frames_block + config.frames_jitter;
+    ioformat.is_float = config.is_float;
+    ioformat.non_interleaved = config.non_interleaved;
+    ioformat.bits = config.bits;
+
+    const UInt32 count_buffers = config.non_interleaved ? config.channels : 1;
+    global_NullDevice.bytes_samples.assign(static_cast<size_t>(ioformat.frames_block_max) * config.channels * (config.bits / 8), 0);
+    global_NullDevice.bytes_list.assign(sizeof(AudioBufferList) + count_buffers * sizeof(AudioBuffer), 0);
+    global_NullDevice.function_render = irender;
+    global_NullDevice.refcon = irefcon;
+    global_NullDevice.stats = struct_null_device_stats{};
+    std::cout << "Null device: " << config.channels << " channels, " << config.frames_block;
+    if (config.frames_jitter > 0) std::cout << " +/- " << config.frames_jitter;
+    std::cout << " frames at " << config.rate << " Hz, " << (config.status_realtime ? "real-time" : "fast") << " pacing\n";
+    return true;
+}
+
+void function_null_device_run() {
+    const struct_null_device_config& config = g_null_device_config;
+    struct_null_device& device = global_NullDevice;
+    AudioBufferList* list = reinterpret_cast<AudioBufferList*>(device.bytes_list.data());
+    const UInt32 bytes_sample = config.bits / 8;
+    std::mt19937 rng_block{config.seed};
+    std::uniform_int_distribution<int> dist_jitter(-static_cast<int>(config.frames_jitter), static_cast<int>(config.frames_jitter));
+    AudioUnitRenderActionFlags flags_render = 0;
+    AudioTimeStamp stamp_time{};
+    const auto time_origin = std::chrono::steady_clock::now() - std::chrono::nanoseconds(
+        static_cast<int64_t>(device.stats.frames_rendered * 1e9 / config.rate));   // Resume where a stop left the clock
+
+    while (device.status_running.load(std::memory_order_acquire)) {
+        uint64_t frames_block = static_cast<uint64_t>(static_cast<int>(config.frames_block) + dist_jitter(rng_block));
+        if (config.frames_total > 0) {
+            if (device.stats.frames_rendered >= config.frames_total) break;
+            frames_block = std::min(frames_block, config.frames_total - device.stats.frames_rendered);
+        }
+        const UInt32 frames = static_cast<UInt32>(frames_block);
+
+        list->mNumberBuffers = config.non_interleaved ? config.channels : 1;
+        for (UInt32 index_buffer = 0; index_buffer < list->mNumberBuffers; ++index_buffer) {
+            const UInt32 channels_buffer = config.non_interleaved ? 1 : config.channels;
+            list->mBuffers[index_buffer].mNumberChannels = channels_buffer;
+            list->mBuffers[index_buffer].mDataByteSize = frames * channels_buffer * bytes_sample;
+            list->mBuffers[index_buffer].mData = device.bytes_samples.data() + static_cast<size_t>(index_buffer) * frames * bytes_sample;
+        }
+        stamp_time.mSampleTime = static_cast<Float64>(device.stats.frames_rendered);
+
+        const auto time_start = std::chrono::steady_clock::now();
+        device.function_render(device.refcon, &flags_render, &stamp_time, 0, frames, list);
+        const auto time_end = std::chrono::steady_clock::now();
+        const double ns_render = std::chrono::duration<double, std::nano>(time_end - time_start).count();
+
+        struct_null_device_stats& stats = device.stats;
+        stats.ns_render_total += ns_render;
+        stats.ns_render_max = std::max(stats.ns_render_max, ns_render);
+        stats.frames_block_min = (stats.count_blocks == 0) ? frames : std::min(stats.frames_block_min, frames);
+        stats.frames_block_max = std::max(stats.frames_block_max, frames);
+        ++stats.count_blocks;
+        if (config.function_sink) config.function_sink(list, frames, config.context_sink);
+        stats.frames_rendered += frames;
+
+        if (config.status_realtime) {
+            // The block was due when the clock reached its first frame; it had one block period to render
+            const auto time_deadline = time_origin + std::chrono::nanoseconds(static_cast<int64_t>(stats.frames_rendered * 1e9 / config.rate));
+            if (time_end > time_deadline) ++stats.count_late;
+            std::this_thread::sleep_until(time_deadline);
         }
     }
+    device.status_running.store(false, std::memory_order_release);
 }
 
-void flive_control_display() {
-    std::cout << "\n\nLive Controls:";
-    std::cout << "SPACE - Press SPACE to re-assess spatial setup (replay pitch-per-object in order from low to high for all channels in device).\n";
-    std::cout << "T - Press 't' to change triangular object configuration.\n";
-    std::cout << "Press 'h' to change hopping sequence pattern (keep same channel assignments).\n";
-    std::cout << "Press 'g' to change grain length.\n";
-    std::cout << "Press 'j' to change jitter freedom (grain launch window size).\n";
-    std::cout << "Press 'd' to change density (grain launch interval).\n";
-    std::cout << "Press 'p' to change travel factor (pitch variation range).\n";
-    // std::cout << "Press 'q' to quit\n";
-    // std::cout << "Press any other key to continue audio playback\n";
-    // std::cout << "================================\n\n";
+bool function_null_device_start() {
+    if (global_NullDevice.thread_device.joinable()) global_NullDevice.thread_device.join();
+    global_NullDevice.status_running.store(true);
+    global_NullDevice.thread_device = std::thread(function_null_device_run);
+    return true;
 }
 
-// remember: functions always need to know what each parameter type is, even if it has already been declared elsewhere
-void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being outputted
-                           std::ifstream& file, // where the audio is being read from
-                           uint16_t channels_file, // number of channels in the file
-                           uint32_t rate_samples, // sample rate of the file
-                           uint16_t bits_sample, // bit resolution of the file
+void function_null_device_stop() {
+    global_NullDevice.status_running.store(false);
+    if (global_NullDevice.thread_device.joinable()) global_NullDevice.thread_device.join();
+}
 
-                           // this was declared in the main function (read), playAudioFile (received), and flive_control_monitor (received)
-                           uint32_t audio_format, 
-                           uint32_t selection_device) { // where the output is being sent to
+// Blocks until a device with frames_total set has rendered all of it
+void function_null_device_wait() {
+    if (global_NullDevice.thread_device.joinable()) global_NullDevice.thread_device.join();
+}
 
-    flive_control_display();
-    
-    // forever loop
-    while (true) {
-        
-        // Check if input is available (debug output removed for usability)
-        
-        if (std::cin.peek() != EOF) { // the user input is during audio (not at End Of File)
-            std::cout << "Input detected!\n";
-            char input = std::cin.get(); // Capture the user's keypress
+void function_null_device_close() {
+    function_null_device_stop();
+    global_NullDevice.bytes_samples.clear();
+    global_NullDevice.bytes_samples.shrink_to_fit();
+    global_NullDevice.bytes_list.clear();
+}
+
+void function_null_device_report() {
+    const struct_null_device_stats& stats = global_NullDevice.stats;
+    const double rate = g_null_device_config.rate;
+    if (stats.count_blocks == 0) return;
+    const double us_period = stats.frames_rendered * 1e6 / rate / stats.count_blocks;
+    std::cout << "Null device: " << stats.count_blocks << " blocks (" << stats.frames_block_min << "-" << stats.frames_block_max
+              << " frames), " << stats.frames_rendered / rate << " s of audio; render mean "
+              << stats.ns_render_total / stats.count_blocks / 1000.0 << " us, max " << stats.ns_render_max / 1000.0
+              << " us (mean block period " << us_period << " us)";
+    if (g_null_device_config.status_realtime) std::cout << ", " << stats.count_late << " late";
+    std::cout << "\n";
+}
+
+const struct_audio_backend global_BackendNull = {
+    "null device", function_null_device_open, function_null_device_start, function_null_device_stop, function_null_device_close
+};
+
+#ifndef GRANULAR_HEADLESS
+/**
+ * CORE AUDIO BACKEND
+ *
+ * The HAL output unit on the selected device. The engine runs at the
+ * device's nominal rate with a planar float stream of the requested channel
+ * count; the format the unit reports back is what the callback receives.
+ */
+AudioUnit g_unit_coreaudio = nullptr;
+
+bool function_coreaudio_open(struct_backend_format& ioformat, function_render_t irender, void* irefcon) {
+    AudioStreamBasicDescription formatAudio;
+
+    formatAudio.mSampleRate = ioformat.rate;
+    formatAudio.mFormatID = kAudioFormatLinearPCM; 
+
+    formatAudio.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked | kAudioFormatFlagIsNonInterleaved;
+    formatAudio.mBitsPerChannel = 32;
+    formatAudio.mChannelsPerFrame = ioformat.channels;
+    formatAudio.mFramesPerPacket = 1;
+    formatAudio.mBytesPerFrame = sizeof(Float32);
+    formatAudio.mBytesPerPacket = sizeof(Float32);
+
+    AudioUnit unit_audio;
+    AudioComponentDescription descriptionComponentAudio;
+
+    descriptionComponentAudio.componentType = kAudioUnitType_Output;
+    descriptionComponentAudio.componentSubType = kAudioUnitSubType_HALOutput;
+    descriptionComponentAudio.componentManufacturer = kAudioUnitManufacturer_Apple;
+    descriptionComponentAudio.componentFlags = 0;
+    descriptionComponentAudio.componentFlagsMask = 0;
+
+    AudioComponent component_audio = AudioComponentFindNext(NULL, &descriptionComponentAudio);
+    if (!component_audio) { 
+        std::cerr << "Audio output component error: \n";
+        return false;
+    } else {
+        std::cout << "Audio components detected.\n\n";
+    }
+
+    OSStatus status_unit_audio;
+
+    status_unit_audio = AudioComponentInstanceNew(component_audio, &unit_audio);
+    if (status_unit_audio != noErr) { 
+        std::cerr << "Audio component instance error: " << status_unit_audio << " \n";
+        return false;
+    } else {
+        std::cout << "Audio component instance created.\n";
+
+        std::cout << "Sample rate: " << formatAudio.mSampleRate << "\n";
+        std::cout << "Format ID: " << formatAudio.mFormatID << "\n";
+        std::cout << "Format flags: " << formatAudio.mFormatFlags << "\n";
+        std::cout << "Bits per channel: " << formatAudio.mBitsPerChannel << "\n";
+        std::cout << "Channels per frame: " << formatAudio.mChannelsPerFrame << "\n";
+        std::cout << "Frames per packet: " << formatAudio.mFramesPerPacket << "\n";
+        std::cout << "Bytes per frame: " << formatAudio.mBytesPerFrame << "\n";
+        std::cout << "Bytes per packet: " << formatAudio.mBytesPerPacket << "\n\n";
+    }
+
+    UInt32 selection_device = ioformat.id_device;
+    status_unit_audio = AudioUnitSetProperty(unit_audio,
+                                             kAudioOutputUnitProperty_CurrentDevice,
+                                             kAudioUnitScope_Global, 
+                                             0, 
+                                             &selection_device, 
+                                             sizeof(selection_device));
+    if (status_unit_audio != noErr) {
+        std::cerr << "Failed to set audio output. Error: " << status_unit_audio << " \n";
+        AudioComponentInstanceDispose(unit_audio);
+        return false;
+    } else {
+        std::cout << "Audio output configured.\n";
+    }
+
+    // Run the engine at the device rate; a file at another rate is resampled once at load
+    AudioStreamBasicDescription formatDevice;
+    UInt32 bytes_format_device = sizeof(formatDevice);
+    if (AudioUnitGetProperty(unit_audio,
+                             kAudioUnitProperty_StreamFormat,
+                             kAudioUnitScope_Output,
+                             0,
+                             &formatDevice,
+                             &bytes_format_device) == noErr && formatDevice.mSampleRate > 0.0) {
+        formatAudio.mSampleRate = formatDevice.mSampleRate;
+    }
+    std::cout << "Engine sample rate: " << formatAudio.mSampleRate << " Hz (requested " << ioformat.rate << " Hz)\n";
+
+    status_unit_audio = AudioUnitSetProperty(unit_audio, 
+                                             kAudioUnitProperty_StreamFormat, 
+                                             kAudioUnitScope_Input, 
+                                             0, 
+                                             &formatAudio, 
+                                             sizeof(formatAudio));
+    if (status_unit_audio != noErr) {
+        std::cerr << "Audio unit formatting error: " << status_unit_audio << " \n";
+        AudioComponentInstanceDispose(unit_audio);
+        return false; 
+    } else {
+        std::cout << "Audio unit format established. Observe program output device's sample rate setup and input monitoring (if applicaple).\n\n";
+    }
+
+    UInt32 asbdSize = sizeof(g_output_asbd);
+    if (AudioUnitGetProperty(unit_audio,
+                             kAudioUnitProperty_StreamFormat,
+                             kAudioUnitScope_Input,
+                             0,
+                             &g_output_asbd,
+                             &asbdSize) == noErr) {
+        ioformat.is_float = (g_output_asbd.mFormatFlags & kAudioFormatFlagIsFloat) != 0;
+        ioformat.non_interleaved = (g_output_asbd.mFormatFlags & kAudioFormatFlagIsNonInterleaved) != 0;
+        ioformat.channels = g_output_asbd.mChannelsPerFrame;
+        ioformat.bits = g_output_asbd.mBitsPerChannel;
+        ioformat.rate = g_output_asbd.mSampleRate;
+    }
+
+    UInt32 frames_max_slice = kframes_default_slice;
+    UInt32 bytes_max_slice = sizeof(frames_max_slice);
+    AudioUnitGetProperty(unit_audio,
+                         kAudioUnitProperty_MaximumFramesPerSlice,
+                         kAudioUnitScope_Global,
+                         0,
+                         &frames_max_slice,
+                         &bytes_max_slice);
+    ioformat.frames_block_max = frames_max_slice;
+
+    AURenderCallbackStruct structure_callback_audio;
+    structure_callback_audio.inputProc = irender;
+    structure_callback_audio.inputProcRefCon = irefcon;
+
+    status_unit_audio = AudioUnitSetProperty(unit_audio,
+                                            kAudioUnitProperty_SetRenderCallback, 
+                                            kAudioUnitScope_Input, 
+                                            0, 
+                                            &structure_callback_audio,
+                                            sizeof(structure_callback_audio));
+    if (status_unit_audio != noErr) {
+        std::cerr << "Rendering error: " << status_unit_audio << " \n";
+        AudioComponentInstanceDispose(unit_audio);
+        return false;
+    } else {
+        std::cout << "Audio units render.\n\n";
+    }
+
+    status_unit_audio = AudioUnitInitialize(unit_audio);
+    if (status_unit_audio != noErr) {
+        std::cerr << "Audio initialization error: " << status_unit_audio << " \n";
+        AudioComponentInstanceDispose(unit_audio);
+        return false;
+    } else {
+        std::cout << "Audio initialized.\n";
+    }
+
+    g_unit_coreaudio = unit_audio;
+    return true;
+}
+
+bool function_coreaudio_start() {
+    const OSStatus status_unit_audio = AudioOutputUnitStart(g_unit_coreaudio);
+    if (status_unit_audio != noErr) {
+        std::cerr << "Output playback error: " << status_unit_audio << " \n";
+        return false;
+    }
+    return true;
+}
+
+void function_coreaudio_stop() {
+    AudioOutputUnitStop(g_unit_coreaudio);
+}
+
+void function_coreaudio_close() {
+    if (!g_unit_coreaudio) return;
+    AudioOutputUnitStop(g_unit_coreaudio);
+    AudioComponentInstanceDispose(g_unit_coreaudio);
+    g_unit_coreaudio = nullptr;
+}
+
+const struct_audio_backend global_BackendCoreAudio = {
+    "Core Audio HAL", function_coreaudio_open, function_coreaudio_start, function_coreaudio_stop, function_coreaudio_close
+};
+#endif // GRANULAR_HEADLESS
+
+
+// LIVE CONTROLS
+
+void show_sequence_translations() {
+    if (g_use_grain_hopping && !g_grain_sequence.empty()) {
+        std::cout << "\nGenerating spatial translations for your current setup:\n";
+        std::cout << "Objects: " << (garray_channel_anchor[0] + 1) << ", " << (garray_channel_anchor[1] + 1) << ", " << (garray_channel_anchor[2] + 1) << "\n";
+        std::cout << "Current sequence: " << g_original_sequence_string << "\n\n";
+        
+        // Generate all 6 possible translation options (3! = 6 permutations)
+        int new_objects[3] = {(int)(garray_channel_anchor[0] + 1), (int)(garray_channel_anchor[1] + 1), (int)(garray_channel_anchor[2] + 1)};
+        int mappings[6][3] = {
+            {new_objects[0], new_objects[1], new_objects[2]}, 
+            {new_objects[0], new_objects[2], new_objects[1]}, 
+            {new_objects[1], new_objects[0], new_objects[2]}, 
+            {new_objects[1], new_objects[2], new_objects[0]}, 
+            {new_objects[2], new_objects[0], new_objects[1]}, 
+            {new_objects[2], new_objects[1], new_objects[0]}  
+        };
+        
+        std::cout << "Translation options (copy/paste-able):\n"; // I want to make this a "press 1, 2, 3, 4, 5, 6" to apply / try 
+        for (int option = 0; option < 6; ++option) {
+            std::cout << "Option " << (option + 1) << ": ";
+            std::string translated = g_original_sequence_string;
+            
+            // Apply string replacement logic
+            std::vector<std::pair<std::string, std::string>> replacements;
+            replacements.push_back({std::to_string(garray_channel_anchor[0] + 1), std::to_string(mappings[option][0])});
+            replacements.push_back({std::to_string(garray_channel_anchor[1] + 1), std::to_string(mappings[option][1])});
+            replacements.push_back({std::to_string(garray_channel_anchor[2] + 1), std::to_string(mappings[option][2])});
+            
+            std::sort(replacements.begin(), replacements.end(), 
+                     [](const auto& a, const auto& b) { return a.first.length() > b.first.length(); });
+            
+            for (const auto& replacement : replacements) {
+                size_t index_str = 0;
+                while ((index_str = translated.find(replacement.first, index_str)) != std::string::npos) {
+                    translated.replace(index_str, replacement.first.length(), replacement.second);
+                    index_str += replacement.second.length();
+                }
+            }
+            
+            std::cout << translated << "  (" << (garray_channel_anchor[0] + 1) << "→" << mappings[option][0]
+                      << ", " << (garray_channel_anchor[1] + 1) << "→" << mappings[option][1] 
+                      << ", " << (garray_channel_anchor[2] + 1) << "→" << mappings[option][2] << ")\n";
+        }
+    }
+}
+
+void flive_control_display() {
+    std::cout << "\n\nLive Controls:";
+    std::cout << "SPACE - Press SPACE to re-assess spatial setup (replay pitch-per-object in order from low to high for all channels in device).\n";
+    std::cout << "T - Press 't' to change triangular object configuration.\n";
+    std::cout << "Press 'h' to change hopping sequence pattern (keep same channel assignments).\n";
+    std::cout << "Press 'g' to change grain length.\n";
+    std::cout << "Press 'j' to change jitter freedom (grain launch window size).\n";
+    std::cout << "Press 'd' to change density (grain launch interval).\n";
+    std::cout << "Press 'p' to change travel factor (pitch variation range).\n";
+    std::cout << "Press 'v' to change polyphony (maximum overlapping grains).\n";
+    std::cout << "Press 'e' to change grain envelope shape.\n";
+    std::cout << "Press 'i' to change pitch-shift interpolation quality.\n";
+    if (!g_output_is_float) {
+        std::cout << "Press 'n' to change dither / noise shaping for the integer output.\n";
+    }
+    std::cout << "Press 'l' to adjust the master limiter (bypass, ceiling, attack, release, look-ahead).\n";
+    std::cout << "Press 'm' to trim or mute an output channel.\n";
+    if (global_SourceBank.count_sources > 1) {
+        std::cout << "Press 'b' to choose which source bank file grains draw from.\n";
+    }
+    // std::cout << "Press 'q' to quit\n";
+    // std::cout << "Press any other key to continue audio playback\n";
+    // std::cout << "================================\n\n";
+}
+
+#ifndef GRANULAR_HEADLESS
+// remember: functions always need to know what each parameter type is, even if it has already been declared elsewhere
+void flive_control_monitor(const struct_audio_backend& ibackend, // where the audio is being outputted
+                           std::ifstream& file, // where the audio is being read from
+                           uint16_t channels_file, // number of channels in the file
+                           uint32_t rate_samples, // sample rate of the file
+                           uint16_t bits_sample, // bit resolution of the file
+
+                           // this was declared in the main function (read), playAudioFile (received), and flive_control_monitor (received)
+                           uint32_t audio_format, 
+                           uint32_t selection_device) { // where the output is being sent to
+
+    flive_control_display();
+    
+    // forever loop
+    while (true) {
+        
+        // Check if input is available (debug output removed for usability)
+        
+        if (std::cin.peek() != EOF) { // the user input is during audio (not at End Of File)
+            std::cout << "Input detected!\n";
+            char input = std::cin.get(); // Capture the user's keypress
             
             // User feedback for debugging and transparency
             std::cout << "Key pressed: '" << input << "' (ASCII: " << (int)input << ")\n";
@@ -731,7 +1741,7 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
                 std::cout << "\nPlaying Pitch-Per-Object...\n";
                 
                 // Temporarily halt granular synthesis for channel test
-                AudioOutputUnitStop(unit_audio);
+                ibackend.function_stop();
                 g_status_audio_playback = false;
                 
                 // Initialize channel identification system
@@ -741,7 +1751,7 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
                                       g_test_freq_step);            // Frequency increment per channel
                 
                 // Resume audio processing for sine test
-                AudioOutputUnitStart(unit_audio);
+                ibackend.function_start();
                 
                 // Multi-threaded synchronization: Wait for test completion
                 std::cout << "Listening for channel order test...\n";
@@ -772,7 +1782,7 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
                 
                 // Resume with existing grain hopping sequence (don't ask user again)
                 g_status_audio_playback = true;
-                AudioOutputUnitStart(unit_audio);
+                ibackend.function_start();
                 std::cout << "Audio playback resumed.\n"; // " with new channel configuration"
                 
                 flive_control_display();
@@ -781,7 +1791,7 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
                 std::cout << "\nChanging triangular object configuration...\n";
                 
                 // Keep audio playing during reconfiguration (live channel switching)
-                // // AudioOutputUnitStop(unit_audio);
+                // // ibackend.function_stop();
                 
                 // Keep audio processing enabled during reconfiguration
                 // // g_status_audio_playback = false;
@@ -799,9 +1809,10 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
                 std::cout << "Sequence channel mapping updated for live playback\n";
                 
                 int updated_count = 0;
-                for (struct_grain& grain : global_ProcessGrain.object_array_grains) {
-                    if (grain.status_callback_grain) {
-                        int old_target = grain.target_object;
+                for (uint32_t index_active = 0; index_active < global_ProcessGrain.active_envelopes_grain; ++index_active) {
+                    uint32_t slot = global_ProcessGrain.array_active_grains[index_active];
+                    if (global_ProcessGrain.pool_grains.status_callback_grain[slot]) {
+                        int old_target = global_ProcessGrain.pool_grains.target_object[slot];
                         // Grains automatically follow new channel assignments - no grain updates needed
                         // The audio callback will use the new garray_channel_anchor values immediately
                         updated_count++;
@@ -916,7 +1927,7 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
                 // Audio processing was never disabled, continues with new object configuration
                 // g_status_audio_playback = true;
                 // Audio unit was never stopped, continues with new channel assignments
-                // AudioOutputUnitStart(unit_audio);
+                // ibackend.function_start();
                 std::cout << "Space updated.\n";
                 
 
@@ -962,7 +1973,7 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
                 std::cout << "\nGrain duration parameter:\n";
                 std::cout << "Current grain length: " << global_ProcessGrain.frames_object_grain << " frames ";
                 std::cout << "(" << (global_ProcessGrain.frames_object_grain * 1000 / g_output_sample_rate) << " ms)\n";
-                std::cout << "\nReference the sample rate of the audio file: " << g_output_sample_rate << " Hz\n";
+                std::cout << "\nReference the engine sample rate: " << g_output_sample_rate << " Hz\n";
                 std::cout << "  512 frames = " << (512 * 1000 / g_output_sample_rate) << " ms\n";
                 std::cout << " 1024 frames = " << (1024 * 1000 / g_output_sample_rate) << " ms\n";
                 std::cout << " 2048 frames = " << (2048 * 1000 / g_output_sample_rate) << " ms\n";
@@ -975,6 +1986,7 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
                 if (new_grain_length >= 256 && new_grain_length <= 8192) { // not crash limits but just a limit I set for now
                                                                            // crash: 
                     global_ProcessGrain.frames_object_grain = new_grain_length;
+                    g_density_generation.fetch_add(1, std::memory_order_release);
                     std::cout << "Grain length updated to " << new_grain_length << " frames\n";
                 } else {
                     std::cout << "Invalid range. Keeping current length (" << global_ProcessGrain.frames_object_grain << " frames)\n";
@@ -1012,6 +2024,7 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
                 
                 if (new_multiplier >= 0.1f && new_multiplier <= 2.0f) {
                     g_interval_multiplier = new_multiplier;
+                    g_density_generation.fetch_add(1, std::memory_order_release);
                     uint32_t new_interval = static_cast<uint32_t>(global_ProcessGrain.frames_object_grain * g_interval_multiplier);
                     std::cout << "Interval multiplier updated to " << g_interval_multiplier << "\n";
                     std::cout << "New interval: " << new_interval << " frames (" << (new_interval * 1000 / g_output_sample_rate) << " ms)\n";
@@ -1032,12 +2045,13 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
                 std::cout << "\nTRAVEL FACTOR control (random pitch variation range):\n";
                 std::cout << "Current multiplier range: " << g_travel_factor_min << " to " << g_travel_factor_max << "\n";
                 std::cout << "Current variation: ±" << ((g_travel_factor_max - 1.0f) * 100.0f) << "%\n"; // convert to percentage
-                std::cout << "\nEnter variation percentage (0-50%, e.g., 10 for ±10% pitch variation): "; // idk man
+                std::cout << "\nEnter variation percentage (0-" << kpercent_travel_max << "%, e.g., 10 for ±10% pitch variation;\n"
+                          << "grains play at most " << krate_grain_max << "x speed, so wider settings are not accepted): "; // idk man
                 
                 float variation_percent;
                 std::cin >> variation_percent;
                 
-                if (variation_percent >= 0.0f && variation_percent <= 50.0f) {
+                if (variation_percent >= 0.0f && variation_percent <= kpercent_travel_max) {
                     float variation = variation_percent / 100.0f; // i.e. 35 / 100 = 0.35, therefore 0.65-1.35
                     g_travel_factor_min = 1.0f - variation;
                     g_travel_factor_max = 1.0f + variation;
@@ -1058,20 +2072,215 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
                     std::cout << "Invalid range (in this program). Keeping current travel factor (±" << ((g_travel_factor_max - 1.0f) * 100.0f) << "%)\n";
                 }
                 
+                flive_control_display();
+            } else if (input == 'v') {
+                std::cout << "\nPOLYPHONY control (maximum overlapping grains):\n";
+                std::cout << "Current polyphony: " << g_grain_polyphony.load() << " grains ("
+                          << global_ProcessGrain.active_envelopes_grain << " sounding now)\n";
+                std::cout << "Enter new polyphony (1-" << max_density_cloud_grain << "): ";
+
+                uint32_t new_polyphony;
+                std::cin >> new_polyphony;
+
+                if (new_polyphony >= 1 && new_polyphony <= static_cast<uint32_t>(max_density_cloud_grain)) {
+                    // Grains above a lowered limit finish naturally; only new spawns are limited
+                    g_grain_polyphony.store(new_polyphony);
+                    std::cout << "Polyphony updated to " << new_polyphony << " grains\n";
+                } else {
+                    std::cout << "Invalid range. Keeping current polyphony (" << g_grain_polyphony.load() << " grains)\n";
+                }
+
+                flive_control_display();
+            } else if (input == 'e') {
+                std::cout << "\nENVELOPE SHAPE (applies to newly spawned grains):\n";
+                const struct_envelope_table* envelope_current = g_envelope_active.load();
+                for (std::size_t number_envelope = 0; number_envelope < kcount_envelope_tables; ++number_envelope) {
+                    std::cout << (number_envelope + 1) << ". " << garray_envelope_tables[number_envelope].name_envelope
+                              << ((&garray_envelope_tables[number_envelope] == envelope_current) ? "  (current)" : "") << "\n";
+                }
+                std::cout << "Enter shape number (1-" << kcount_envelope_tables << "): ";
+
+                std::size_t new_envelope;
+                std::cin >> new_envelope;
+
+                if (new_envelope >= 1 && new_envelope <= kcount_envelope_tables) {
+                    // Publish the new table; sounding grains keep the one they started with
+                    g_envelope_active.store(&garray_envelope_tables[new_envelope - 1], std::memory_order_release);
+                    std::cout << "Envelope shape updated to " << garray_envelope_tables[new_envelope - 1].name_envelope << "\n";
+                } else {
+                    std::cout << "Invalid choice. Keeping " << envelope_current->name_envelope << " envelope\n";
+                }
+
+                flive_control_display();
+            } else if (input == 'i') {
+                std::cout << "\nINTERPOLATION QUALITY (transposed grains):\n";
+                const int mode_current = g_interpolation_mode.load();
+                for (int number_mode = 0; number_mode < kcount_interpolation_modes; ++number_mode) {
+                    std::cout << (number_mode + 1) << ". " << garray_names_interpolation[number_mode]
+                              << ((number_mode == mode_current) ? "  (current)" : "") << "\n";
+                }
+                std::cout << "Enter mode number (1-" << kcount_interpolation_modes << "): ";
+
+                int new_mode;
+                std::cin >> new_mode;
+
+                if (new_mode >= 1 && new_mode <= kcount_interpolation_modes) {
+                    // Takes effect from the next audio block
+                    g_interpolation_mode.store(new_mode - 1);
+                    std::cout << "Interpolation updated to " << garray_names_interpolation[new_mode - 1] << "\n";
+                } else {
+                    std::cout << "Invalid choice. Keeping " << garray_names_interpolation[mode_current] << " interpolation\n";
+                }
+
+                flive_control_display();
+            } else if (input == 'n' && !g_output_is_float) {
+                std::cout << "\nREQUANTIZATION (" << g_output_bits_per_channel << "-bit output):\n";
+                const int mode_current = g_quantize_mode.load();
+                for (int number_mode = 0; number_mode < kcount_quantize_modes; ++number_mode) {
+                    std::cout << (number_mode + 1) << ". " << garray_quantize_modes[number_mode].name_mode
+                              << ((number_mode == mode_current) ? "  (current)" : "") << "\n";
+                }
+                std::cout << "Enter mode number (1-" << kcount_quantize_modes << "): ";
+
+                int new_mode;
+                std::cin >> new_mode;
+
+                if (new_mode >= 1 && new_mode <= kcount_quantize_modes) {
+                    // Takes effect from the next audio block
+                    g_quantize_mode.store(new_mode - 1);
+                    std::cout << "Requantizer updated to " << garray_quantize_modes[new_mode - 1].name_mode << "\n";
+                } else {
+                    std::cout << "Invalid choice. Keeping " << garray_quantize_modes[mode_current].name_mode << "\n";
+                }
+
+                flive_control_display();
+            } else if (input == 'l') {
+                std::cout << "\nMASTER LIMITER:\n";
+                function_limiter_report();
+                std::cout << "1. " << (g_limiter_enabled.load() ? "Bypass" : "Enable") << " the limiter\n"
+                          << "2. Ceiling (-24 to 0 dBTP)\n"
+                          << "3. Attack (0.05-10 ms, at most the look-ahead)\n"
+                          << "4. Release (1-2000 ms)\n"
+                          << "5. Look-ahead (0.1-" << kms_lookahead_max << " ms)\n"
+                          << "Enter choice (1-5): ";
+
+                int choice_limiter;
+                std::cin >> choice_limiter;
+
+                if (choice_limiter == 1) {
+                    g_limiter_enabled.store(!g_limiter_enabled.load());
+                } else if (choice_limiter >= 2 && choice_limiter <= 5) {
+                    const float garray_low[4] = {-24.0f, 0.05f, 1.0f, 0.1f};
+                    const float garray_high[4] = {0.0f, kms_lookahead_max, 2000.0f, kms_lookahead_max};
+                    std::atomic<float>* const garray_parameters[4] = {&g_limiter_ceiling_db, &g_limiter_attack_ms,
+                                                                      &g_limiter_release_ms, &g_limiter_lookahead_ms};
+                    std::cout << "Enter value: ";
+                    float value;
+                    std::cin >> value;
+                    if (value >= garray_low[choice_limiter - 2] && value <= garray_high[choice_limiter - 2]) {
+                        // Takes effect from the next audio block (look-ahead or attack changes restart the delay line)
+                        garray_parameters[choice_limiter - 2]->store(value);
+                    } else {
+                        std::cout << "Value out of range. Keeping the current setting\n";
+                    }
+                } else {
+                    std::cout << "Invalid choice. Keeping the current settings\n";
+                }
+                function_limiter_report();
+
+                flive_control_display();
+            } else if (input == 'm') {
+                const UInt32 channels_listed = std::min<UInt32>(g_output_channels, kcount_channels_gain);
+                std::cout << "\nOUTPUT CHANNELS (trim / mute):\n";
+                for (UInt32 ch = 0; ch < channels_listed; ++ch) {
+                    const struct_channel_gain& gain = garray_channel_gains[ch];
+                    std::cout << (ch + 1) << ". " << 20.0f * std::log10(gain.trim.load()) << " dB"
+                              << (gain.mute.load() ? "  (muted)" : "") << "\n";
+                }
+                std::cout << "Enter channel number (1-" << channels_listed << "): ";
+
+                UInt32 number_channel;
+                std::cin >> number_channel;
+
+                if (number_channel >= 1 && number_channel <= channels_listed) {
+                    struct_channel_gain& gain = garray_channel_gains[number_channel - 1];
+                    std::cout << "Enter trim in dB (" << kdb_channel_trim_min << " to +" << kdb_channel_trim_max
+                              << "), or 'm' to toggle mute: ";
+                    std::string entry_gain;
+                    std::cin >> entry_gain;
+
+                    // Takes effect from the next audio block, ramped over up to kms_channel_gain_ramp
+                    if (entry_gain == "m") {
+                        gain.mute.store(!gain.mute.load());
+                        std::cout << "Channel " << number_channel << (gain.mute.load() ? " muted\n" : " unmuted\n");
+                    } else {
+                        float trim_db = 0.0f;
+                        try {
+                            trim_db = std::stof(entry_gain);
+                        } catch (const std::exception&) {
+                            trim_db = kdb_channel_trim_max + 1.0f;
+                        }
+                        if (trim_db >= kdb_channel_trim_min && trim_db <= kdb_channel_trim_max) {
+                            gain.trim.store(std::pow(10.0f, trim_db / 20.0f));
+                            std::cout << "Channel " << number_channel << " trimmed to " << trim_db << " dB\n";
+                        } else {
+                            std::cout << "Invalid trim. Keeping the current setting\n";
+                        }
+                    }
+                } else {
+                    std::cout << "Invalid channel. Keeping the current settings\n";
+                }
+
+                flive_control_display();
+            } else if (input == 'b') {
+                std::cout << "\nSOURCE BANK (file grains draw from):\n";
+                const int selection_current = g_source_selection.load();
+                for (uint32_t number_source = 0; number_source < global_SourceBank.count_sources; ++number_source) {
+                    std::cout << (number_source + 1) << ". "
+                              << (number_source == 0 ? std::string("primary file") : global_SourceBank.name_source[number_source])
+                              << ((static_cast<int>(number_source) == selection_current) ? "  (current)" : "") << "\n";
+                }
+                std::cout << "0. Random source per grain" << ((selection_current == ksource_random) ? "  (current)" : "") << "\n";
+                std::cout << "Enter source number (0-" << global_SourceBank.count_sources << "): ";
+
+                int new_source;
+                std::cin >> new_source;
+
+                if (new_source == 0) {
+                    g_source_selection.store(ksource_random);
+                    std::cout << "Grains now draw from a random source each\n";
+                } else if (new_source >= 1 && new_source <= static_cast<int>(global_SourceBank.count_sources)) {
+                    // Takes effect from the next grain spawned
+                    g_source_selection.store(new_source - 1);
+                    std::cout << "Grains now draw from source " << new_source << "\n";
+                } else {
+                    std::cout << "Invalid choice. Keeping the current source\n";
+                }
+
                 flive_control_display();
             }
         }
         
+        // The callback found the device format larger than the mix bus:
+        // re-size it here, off the audio thread, with the device stopped
+        if (g_mix_bus_resize_pending.load()) {
+            ibackend.function_stop();
+            function_mix_bus_prepare(std::max(g_mix_bus_request_channels.load(), global_MixBus.channels_capacity_mix),
+                                     std::max(g_mix_bus_request_frames.load(), global_MixBus.frames_capacity_mix));
+            ibackend.function_start();
+        }
+
         // 0.1 second delay to prevent excessive CPU usage
         // User can make live controls every 0.1 second
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 }
+#endif // GRANULAR_HEADLESS
 /**
  * Envelope Generation System
  * 
- * This function generates the Hann window
- * (also known as Hanning window), which was my approach as a beginner for preventing audio artifacts
+ * This function fills the shared envelope registry. The default shape is the
+ * Hann window (also known as Hanning window), which was my approach as a beginner for preventing audio artifacts
  * in granular synthesis. The mathematical precision of this envelope directly
  * impacts the audio quality of the final output.
  * 
@@ -1080,6 +2289,11 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
  * This creates a smooth, bell-shaped curve that eliminates click artifacts
  * when grains start and stop.
  * 
+ * ADDITIONAL SHAPES:
+ * • Tukey (50% taper): flat sustain with cosine edges, for denser, fuller grains
+ * • Gaussian (σ = 1/6 of the grain): softer attack, more "cloud-like" overlap
+ * • Triangle: linear attack and release
+ * 
  * TECHNICAL ACHIEVEMENTS:
  * • Implements industry-standard windowing mathematics
  * • Pre-calculates RMS value for accurate gain normalization
@@ -1091,28 +2305,244 @@ void flive_control_monitor(AudioUnit& unit_audio, // where the audio is being ou
  * leakage and maintain smooth audio transitions between overlapping grains.
  */
 void function_shape_envelope() {
-    float sum2 = 0.0f;  // Accumulator for RMS calculation
-    
+    garray_envelope_tables[kenvelope_hann].name_envelope     = "Hann";
+    garray_envelope_tables[kenvelope_tukey].name_envelope    = "Tukey (50% taper)";
+    garray_envelope_tables[kenvelope_gaussian].name_envelope = "Gaussian";
+    garray_envelope_tables[kenvelope_triangle].name_envelope = "Triangle";
+
     for (std::size_t count_frame_envelope = 0; count_frame_envelope < kframes_envelope; ++count_frame_envelope) {
         constexpr float kPi = 3.14159265358979323846f;  // High-precision Pi constant
 
+        // Calculate normalized phase position (0.0 to 1.0)
+        float phase_envelope = static_cast<float>(count_frame_envelope) / (kframes_envelope - 1);
+
         // Generate Hann window: smooth cosine-based envelope
-        garray_frames_envelope[count_frame_envelope] = 0.5f - 0.5f * std::cos(
+        garray_envelope_tables[kenvelope_hann].frames_envelope[count_frame_envelope] = 0.5f - 0.5f * std::cos(
             2.0f * kPi * static_cast<float>(count_frame_envelope) / (kframes_envelope - 1)
         );
 
-        // Calculate normalized phase position (0.0 to 1.0)
-        float phase_envelope = static_cast<float>(count_frame_envelope) / (kframes_envelope - 1);
+        // Tukey: cosine taper over the first and last quarter, flat in between
+        constexpr float kTaper = 0.25f;
+        float edge_distance = std::min(phase_envelope, 1.0f - phase_envelope);
+        garray_envelope_tables[kenvelope_tukey].frames_envelope[count_frame_envelope] = (edge_distance >= kTaper)
+            ? 1.0f
+            : 0.5f - 0.5f * std::cos(kPi * edge_distance / kTaper);
+
+        // Gaussian centred on the grain, pinned to zero at both ends
+        constexpr float kSigma = 1.0f / 6.0f;
+        float deviation = (phase_envelope - 0.5f) / kSigma;
+        float gaussian_edge = std::exp(-0.5f * (0.5f / kSigma) * (0.5f / kSigma));
+        garray_envelope_tables[kenvelope_gaussian].frames_envelope[count_frame_envelope] =
+            (std::exp(-0.5f * deviation * deviation) - gaussian_edge) / (1.0f - gaussian_edge);
+
+        // Triangle: linear rise to the centre and linear fall
+        garray_envelope_tables[kenvelope_triangle].frames_envelope[count_frame_envelope] = 1.0f - std::fabs(2.0f * phase_envelope - 1.0f);
+    }
+
+    // Calculate RMS (Root Mean Square) of every shape for gain normalization
+    for (struct_envelope_table& table : garray_envelope_tables) {
+        float sum2 = 0.0f;  // Accumulator for RMS calculation
+        for (std::size_t count_frame_envelope = 0; count_frame_envelope < kframes_envelope; ++count_frame_envelope) {
+            float value = table.frames_envelope[count_frame_envelope];
+            sum2 += value * value;
+        }
+        table.envelope_rms = std::sqrt(sum2 / kframes_envelope);
+
+        // Guard point for the interpolated lookup
+        table.frames_envelope[kframes_envelope] = table.frames_envelope[kframes_envelope - 1];
+    }
+}
+
+// =============================================================================
+// WAV HEADER PARSING (RIFF / RF64 / WAVE_FORMAT_EXTENSIBLE)
+// =============================================================================
+
+/**
+ * CHUNK-WALKING WAV PARSER
+ *
+ * The header is parsed once into a struct_wav_format that the loader and the
+ * engine share, instead of reading fields at fixed byte offsets:
+ * • RIFF, RF64 and BW64 containers; RF64 sizes come from the ds64 chunk
+ *   whenever a 32-bit size field holds the 0xFFFFFFFF placeholder
+ * • Chunks are walked in order (odd sizes are padded to even), so LIST, bext,
+ *   JUNK and other chunks may appear anywhere, including before fmt
+ * • fmt may also follow data: the walk records the data chunk's offset and
+ *   size, steps over its body and stops only once both have been seen
+ * • WAVE_FORMAT_EXTENSIBLE resolves to its sub-format (PCM or IEEE float) and
+ *   supplies the valid-bits count and the dwChannelMask speaker mask
+ * The descriptor is validated (block alignment, sample width, data chunk
+ * present and inside the file) before anything is loaded.
+ */
+constexpr uint16_t kwave_format_pcm = 0x0001;
+constexpr uint16_t kwave_format_ieee_float = 0x0003;
+constexpr uint16_t kwave_format_extensible = 0xFFFE;
+constexpr uint32_t ksize_chunk_rf64 = 0xFFFFFFFF;     // 32-bit size placeholder; real size lives in ds64
+
+struct struct_wav_format {
+    uint16_t format_tag;        // kwave_format_pcm or kwave_format_ieee_float (extensible resolved)
+    uint16_t channels_file;     // Interleaved channels per frame
+    uint32_t rate_samples;      // Frames per second
+    uint16_t bits_sample;       // Container bits per sample
+    uint16_t bits_valid;        // Significant bits per sample (extensible), else bits_sample
+    uint16_t bytes_block;       // Bytes per interleaved frame
+    uint32_t mask_channel;      // dwChannelMask speaker positions, 0 = unspecified
+    uint64_t address_data;      // File offset of the first audio frame
+    uint64_t bytes_data;        // Audio bytes present in the file (ds64 size for RF64)
+    bool     is_rf64;           // RF64 / BW64 container
+    bool     is_extensible;     // fmt chunk was WAVE_FORMAT_EXTENSIBLE
+};
+
+// Speaker names in dwChannelMask bit order
+const char* const garray_names_speaker[] = {"FL", "FR", "FC", "LFE", "BL", "BR", "FLC", "FRC", "BC",
+                                            "SL", "SR", "TC", "TFL", "TFC", "TFR", "TBL", "TBC", "TBR"};
+
+inline uint16_t function_read_le16(const unsigned char* ibytes) { return static_cast<uint16_t>(ibytes[0] | (ibytes[1] << 8)); }
+inline uint32_t function_read_le32(const unsigned char* ibytes) { return function_read_le16(ibytes) | (static_cast<uint32_t>(function_read_le16(ibytes + 2)) << 16); }
+inline uint64_t function_read_le64(const unsigned char* ibytes) { return function_read_le32(ibytes) | (static_cast<uint64_t>(function_read_le32(ibytes + 4)) << 32); }
+
+bool function_wav_parse(const std::string& iname_file, struct_wav_format& oformat) {
+    std::ifstream file(iname_file, std::ios::binary | std::ios::ate);
+    if (!file) {
+        std::cerr << "No file detected. Please ensure file is in this folder.\n\n";
+        return false;
+    }
+    const uint64_t bytes_file = static_cast<uint64_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+
+    oformat = struct_wav_format{};
+    unsigned char bytes_header[12];
+    if (!file.read(reinterpret_cast<char*>(bytes_header), sizeof(bytes_header)) ||
+        std::memcmp(bytes_header + 8, "WAVE", 4) != 0) {
+        std::cerr << "Not a WAVE file.\n";
+        return false;
+    }
+    if (std::memcmp(bytes_header, "RF64", 4) == 0 || std::memcmp(bytes_header, "BW64", 4) == 0) {
+        oformat.is_rf64 = true;
+    } else if (std::memcmp(bytes_header, "RIFF", 4) != 0) {
+        std::cerr << "Unknown container (expected RIFF, RF64 or BW64).\n";
+        return false;
+    }
+
+    bool status_fmt = false;
+    bool status_data = false;
+    uint64_t bytes_data_ds64 = 0;
+    uint64_t address_chunk = 12;
+    while (address_chunk + 8 <= bytes_file && !(status_fmt && status_data)) {
+        unsigned char bytes_chunk[8];
+        file.seekg(static_cast<std::streamoff>(address_chunk), std::ios::beg);
+        if (!file.read(reinterpret_cast<char*>(bytes_chunk), sizeof(bytes_chunk))) break;
+        uint64_t bytes_body = function_read_le32(bytes_chunk + 4);
+        const uint64_t address_body = address_chunk + 8;
+
+        if (std::memcmp(bytes_chunk, "ds64", 4) == 0) {
+            unsigned char bytes_ds64[24];
+            if (bytes_body < sizeof(bytes_ds64) || !file.read(reinterpret_cast<char*>(bytes_ds64), sizeof(bytes_ds64))) {
+                std::cerr << "Truncated ds64 chunk.\n";
+                return false;
+            }
+            bytes_data_ds64 = function_read_le64(bytes_ds64 + 8);   // riffSize, dataSize, sampleCount
+        } else if (std::memcmp(bytes_chunk, "fmt ", 4) == 0) {
+            unsigned char bytes_fmt[40] = {};
+            if (bytes_body < 16 || !file.read(reinterpret_cast<char*>(bytes_fmt), std::min<uint64_t>(bytes_body, sizeof(bytes_fmt)))) {
+                std::cerr << "Truncated fmt chunk.\n";
+                return false;
+            }
+            oformat.format_tag    = function_read_le16(bytes_fmt);
+            oformat.channels_file = function_read_le16(bytes_fmt + 2);
+            oformat.rate_samples  = function_read_le32(bytes_fmt + 4);
+            oformat.bytes_block   = function_read_le16(bytes_fmt + 12);
+            oformat.bits_sample   = function_read_le16(bytes_fmt + 14);
+            oformat.bits_valid    = oformat.bits_sample;
+
+            if (oformat.format_tag == kwave_format_extensible) {
+                // cbSize, wValidBitsPerSample, dwChannelMask, SubFormat GUID
+                static const unsigned char kguid_tail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00,
+                                                             0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+                if (bytes_body < 40 || function_read_le16(bytes_fmt + 16) < 22 ||
+                    std::memcmp(bytes_fmt + 26, kguid_tail, sizeof(kguid_tail)) != 0) {
+                    std::cerr << "Unrecognized WAVE_FORMAT_EXTENSIBLE sub-format.\n";
+                    return false;
+                }
+                oformat.is_extensible = true;
+                oformat.bits_valid    = function_read_le16(bytes_fmt + 18);
+                oformat.mask_channel  = function_read_le32(bytes_fmt + 20);
+                oformat.format_tag    = function_read_le16(bytes_fmt + 24);
+                if (oformat.bits_valid == 0) oformat.bits_valid = oformat.bits_sample;
+            }
+            status_fmt = true;
+        } else if (std::memcmp(bytes_chunk, "data", 4) == 0) {
+            if (oformat.is_rf64 && bytes_body == ksize_chunk_rf64) bytes_body = bytes_data_ds64;
+            oformat.address_data = address_body;
+            oformat.bytes_data = std::min(bytes_body, bytes_file - address_body);   // Tolerate truncated files
+            status_data = true;
+        }
 
-        // Accumulate squared values for RMS calculation
-        float value = garray_frames_envelope[count_frame_envelope];
-        sum2 += value * value;
+        // Anything else (LIST, bext, JUNK, fact, cue ...) is skipped; bodies are padded to even sizes
+        if (bytes_body == ksize_chunk_rf64 && oformat.is_rf64) break;     // Only data may use the placeholder
+        address_chunk = address_body + bytes_body + (bytes_body & 1u);
+    }
+
+    if (!status_fmt || !status_data) {
+        std::cerr << (status_fmt ? "No audio data ID detected.\n\n" : "No fmt chunk found.\n");
+        return false;
+    }
+    if (oformat.format_tag != kwave_format_pcm && oformat.format_tag != kwave_format_ieee_float) {
+        std::cerr << "Unsupported WAVE format tag: " << oformat.format_tag << "\n";
+        return false;
+    }
+    if (oformat.channels_file == 0 || oformat.rate_samples == 0 || oformat.bits_sample == 0 ||
+        (oformat.bits_sample % 8) != 0 || oformat.bits_valid > oformat.bits_sample ||
+        oformat.bytes_block != oformat.channels_file * (oformat.bits_sample / 8)) {
+        std::cerr << "Inconsistent fmt chunk: " << oformat.channels_file << " channels, " << oformat.bits_sample
+                  << "-bit, block " << oformat.bytes_block << " bytes.\n";
+        return false;
     }
+    if (oformat.mask_channel != 0 && static_cast<int>(__builtin_popcount(oformat.mask_channel)) != oformat.channels_file) {
+        std::cout << "Note: channel mask names " << __builtin_popcount(oformat.mask_channel) << " speakers for "
+                  << oformat.channels_file << " channels; ignoring it.\n";
+        oformat.mask_channel = 0;
+    }
+    return true;
+}
 
-    // Calculate RMS (Root Mean Square) for gain normalization
-    g_envelope_rms = std::sqrt(sum2 / kframes_envelope);
+// "FL FR FC LFE BL BR" for the mask, or "unspecified"
+std::string function_wav_speaker_layout(const struct_wav_format& iformat) {
+    if (iformat.mask_channel == 0) return "unspecified";
+    std::string layout_speaker;
+    for (uint32_t bit = 0; bit < sizeof(garray_names_speaker) / sizeof(garray_names_speaker[0]); ++bit) {
+        if (iformat.mask_channel & (1u << bit)) {
+            if (!layout_speaker.empty()) layout_speaker += ' ';
+            layout_speaker += garray_names_speaker[bit];
+        }
+    }
+    return layout_speaker;
 }
 
+/**
+ * UNINITIALIZED PLANAR STORAGE
+ *
+ * std::vector value-initializes on resize(), which zero-fills the whole
+ * planar buffer on the loading thread before any decode worker starts. This
+ * allocator default-initializes instead, so a float element is left as is and
+ * resize() only reserves address space. Each decode worker then first-touches
+ * the pages of the chunks it writes.
+ */
+template <typename type_element>
+struct struct_allocator_uninitialized : std::allocator<type_element> {
+    template <typename type_other> struct rebind { typedef struct_allocator_uninitialized<type_other> other; };
+    struct_allocator_uninitialized() noexcept {}
+    template <typename type_other>
+    struct_allocator_uninitialized(const struct_allocator_uninitialized<type_other>&) noexcept {}
+
+    template <typename type_value>
+    void construct(type_value* iaddress) { ::new (static_cast<void*>(iaddress)) type_value; }
+    template <typename type_value, typename... type_args>
+    void construct(type_value* iaddress, type_args&&... iargs) {
+        ::new (static_cast<void*>(iaddress)) type_value(std::forward<type_args>(iargs)...);
+    }
+};
+typedef std::vector<float, struct_allocator_uninitialized<float>> planar_frames_t;
+
 /**
  * COMPREHENSIVE AUDIO FILE MANAGEMENT STRUCTURE
  * 
@@ -1136,298 +2566,2588 @@ struct AudioFileData {
     uint16_t channels_file;                     // Number of audio channels in source file
     uint32_t bytes_total_read_file;             // Total bytes read from file
     uint32_t bytes_header;                      // Size of WAV header section
-    uint32_t bytes_chunk_audio;                 // Size of audio data chunk
-    uint32_t address_first_audio;               // File offset to start of audio data
+    uint64_t bytes_chunk_audio;                 // Size of audio data chunk
+    uint64_t address_first_audio;               // File offset to start of audio data
     uint32_t address_present_audio;             // Current read position in file
     
     // High-performance audio buffer system
-    std::vector<std::vector<float>> samples;   // 2D array: [channel][sample] for efficient access
+    std::vector<const float*> samples;          // Per-channel base pointers: [channel][sample] for efficient access
+    planar_frames_t frames_planar;              // Owned planar storage (channel-major), filled by the decode workers
+    const void* address_mapping;                // Read-only file mapping kept for in-place sources, else nullptr
+    bool source_streaming;                      // true = frames come from the streaming window cache, not samples
+    size_t bytes_mapping;                       // Length of address_mapping
     uint32_t frames_total;                      // Total number of audio frames in file
     uint32_t present_frame;                     // Current playback position
     bool file_is_ieee_float;                    // Format flag: true=32-bit float, false=PCM integer
+    struct_wav_format format_file;              // Parsed header shared by the loader and the engine
 };
 
 AudioFileData global_AudioFileData;
 
+// =============================================================================
+// SOURCE SAMPLE-RATE CONVERSION
+// =============================================================================
 
-void initialize_grain(struct_grain& idata_grain,
-                      uint32_t      iaddress_start_frame,
-                      uint32_t      iframes_grain, 
-                      float         igain_grain = 1.0f) { 
-
-    idata_grain.address_start_frame     = iaddress_start_frame;
-    idata_grain.address_present_grain   = 0;
-    idata_grain.frames_grain            = iframes_grain;
-    
+/**
+ * POLYPHASE RESAMPLER
+ *
+ * The engine runs at the device rate, and every frame count the engine uses
+ * (grain length, interval, jitter, travel) is in engine-rate frames. A file
+ * at another rate is converted to the engine rate once, when it is loaded
+ * (or page by page when it streams), so the callback never converts rates.
+ *
+ * The ratio is reduced to engine/file = L/M. Output frame n reads the source
+ * at position n * M / L, so only L fractional positions (phases) ever occur,
+ * and each one has its own precomputed row of Kaiser-windowed sinc taps.
+ * Each output frame is a dot product of one row against contiguous source
+ * frames, done four frames at a time with SIMD. Ratios that would need more
+ * than kphases_resample_max phases are rounded to the nearest ratio with that
+ * many phases (44.1 kHz to 47.999 kHz plays 0.13 cents sharp).
+ *
+ * QUALITY LEVELS (taps per phase when upsampling; downsampling scales the
+ * taps by M / L so the transition band stays the same in engine terms):
+ * • Draft: 16 taps, ~60 dB stopband, cutoff at 76% of Nyquist (soft top octave)
+ * • Standard: 32 taps, ~80 dB stopband, cutoff at 84% of Nyquist
+ * • High: 64 taps, ~100 dB stopband, cutoff at 90% of Nyquist
+ */
+enum : int {
+    kresample_draft = 0,
+    kresample_standard,
+    kresample_high,
+    kcount_resample_qualities
+};
 
- 
+struct struct_resample_quality {
+    const char* name_quality;
+    uint32_t taps_base;      // Taps per phase at ratios >= 1
+    double rolloff;          // Cutoff as a fraction of the lower Nyquist frequency
+    double beta_kaiser;      // Kaiser window shape (stopband depth)
+};
 
- 
-    if (g_use_grain_hopping && !g_grain_sequence.empty()) {
-     
-        idata_grain.target_object = g_grain_sequence[g_sequence_position];
-     
-        g_sequence_position = (g_sequence_position + 1) % g_grain_sequence.size();
-    } else {
-     
-        idata_grain.target_object = -2;
-    } 
-    idata_grain.gain_grain              = igain_grain; 
-                      
-    std::copy(std::begin(garray_frames_envelope),
-              std::end  (garray_frames_envelope),
-              idata_grain.frames_gain_envelope);
-    
-    idata_grain.status_callback_grain = true; 
-}
+const struct_resample_quality garray_resample_qualities[kcount_resample_qualities] = {
+    {"draft",    16, 0.76, 6.0},
+    {"standard", 32, 0.84, 8.0},
+    {"high",     64, 0.90, 10.0},
+};
 
-/**
- * ADVANCED GRANULAR SYNTHESIS GRAIN GENERATION ENGINE
- * 
- * This function represents the core intelligence of the granular synthesis system,
- * implementing sophisticated algorithms for creating new grains with randomized
- * parameters. It demonstrates advanced understanding of:
- * 
- * • High-quality random number generation using industry standards
- * • Real-time memory management with object pooling
- * • Mathematical parameter randomization for organic texture
- * • Performance optimization for audio-rate processing
- * 
- * TECHNICAL SOPHISTICATION:
- * - Uses Mersenne Twister algorithm for superior random distribution
- * - Implements thread-local storage for multi-threading safety
- * - Applies jitter and scaling for natural, non-mechanical sound
- * - Manages grain density through intelligent load balancing
- */
-void function_process_grain() {
-    // Performance optimization: Limit concurrent grains to maintain real-time performance
-    if (global_ProcessGrain.active_envelopes_grain >= 8) {
-        return;  // System at capacity - skip grain creation this cycle
-    }
-    
-    // Object Pool Pattern: Find available grain slot for reuse
-    struct_grain* new_grain = nullptr;
-    for (auto& slot_new_grain : global_ProcessGrain.object_array_grains) {
-        if (!slot_new_grain.status_callback_grain) {
-            new_grain = &slot_new_grain;  // Found available slot
-            break;
-        }
-    }
-    if (!new_grain) {
-        return;  // No available grain slots - skip creation
-    }
+int g_resample_quality = kresample_standard;
+constexpr uint32_t kphases_resample_max = 4096;
+constexpr uint32_t ktaps_resample_max = 512;
 
-    /**
-     * ADVANCED RANDOM NUMBER GENERATION SYSTEM
-     * 
-     * Implements the Mersenne Twister algorithm, which one standard
-     * for pseudo-random number generation in professional applications.
-     * 
-     * TECHNICAL DETAILS:
-     * • thread_local: Each thread gets its own RNG instance (thread-safe)
-     * • std::random_device: Hardware entropy source for seeding
-     * • std::mt19937: 32-bit Mersenne Twister with 19937-bit period
-     * • Static storage: RNG state persists between function calls
-     * 
-     * This approach ensures less-than predictable randomization while maintaining
-     * excellent performance in real-time audio processing.
-     */
-    static thread_local std::mt19937 rng{std::random_device{}()}; 
+struct struct_resampler {
+    bool is_identity = true;             // File rate == engine rate: no conversion
+    uint32_t phases = 1;                 // L: engine frames per step_source file frames
+    uint32_t step_source = 1;            // M
+    uint32_t taps = 0;                   // Taps per phase (multiple of 4)
+    std::vector<float> coefficients;     // phases x taps, each row normalized to unity DC gain
+};
 
-    /**
-     * STATISTICAL DISTRIBUTION CONFIGURATION
-     * 
-     * These distributions control the randomization parameters that give
-     * granular synthesis its characteristic organic, non-mechanical texture.
-     */
-    
-    // Temporal Jitter: Randomizes grain start timing to prevent mechanical regularity
-    std::uniform_int_distribution<int> jitterDist(-g_jitter_range, g_jitter_range);
-    
-    // Pitch/Speed Variation: Creates subtle pitch variations for organic texture
-    // This scaling factor affects both playback speed and resulting pitch
-    std::uniform_real_distribution<float> scaleDist(g_travel_factor_min, g_travel_factor_max);
+struct_resampler global_Resampler;
 
-    // base_frames_grain is the original grain length
-    const uint32_t base_frames_grain = global_ProcessGrain.frames_object_grain;
+// Engine-rate frames produced from iframes_source file frames
+uint64_t function_resample_frames(const struct_resampler& iresampler, uint64_t iframes_source) {
+    return (iframes_source * iresampler.phases + iresampler.step_source - 1) / iresampler.step_source;
+}
 
-    // start_raw is the starting frame of the grain
-    int64_t start_raw = static_cast<int64_t>(global_AudioFileData.present_frame) + jitterDist(rng); // rng is mt
-    if (start_raw < 0) start_raw = 0;
-    if (start_raw > static_cast<int64_t>(global_AudioFileData.frames_total - 1)) {
-        start_raw = static_cast<int64_t>(global_AudioFileData.frames_total - 1);
+// Zeroth-order modified Bessel function of the first kind (Kaiser window)
+double function_bessel_i0(double ix) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64 && term > sum * 1e-17; ++k) {
+        const double factor = ix / (2.0 * k);
+        term *= factor * factor;
+        sum += term;
     }
+    return sum;
+}
 
-    // field_start_frame is the new starting frame of the grain
-    uint32_t field_start_frame = static_cast<uint32_t>(start_raw);
-
-    // field_frames_grain is the new length of the grain
-    uint32_t field_frames_grain = static_cast<uint32_t>(base_frames_grain * scaleDist(rng)); // rng is mt
-    if (field_frames_grain < 64u) field_frames_grain = 64u;
+void function_resampler_prepare(uint32_t irate_source, uint32_t irate_engine, int iquality, struct_resampler& oresampler) {
+    constexpr double kPi = 3.14159265358979323846;
+    oresampler = struct_resampler{};
+    if (irate_source == irate_engine || irate_source == 0 || irate_engine == 0) return;
+
+    uint64_t phases = irate_engine, step_source = irate_source;
+    const uint64_t divisor = std::gcd(phases, step_source);
+    phases /= divisor;
+    step_source /= divisor;
+    if (phases > kphases_resample_max) {
+        step_source = std::max<uint64_t>(1, std::llround(static_cast<double>(irate_source) * kphases_resample_max / irate_engine));
+        phases = kphases_resample_max;
+        const uint64_t divisor_rounded = std::gcd(phases, step_source);
+        phases /= divisor_rounded;
+        step_source /= divisor_rounded;
+    }
 
-    // if the new starting frame + the new length of the grain is greater than the total frames of the audio file
-    if (field_start_frame + field_frames_grain > global_AudioFileData.frames_total) {
-        // cut the grain the whatever is left from the audio
-        field_frames_grain = global_AudioFileData.frames_total - field_start_frame;
+    const struct_resample_quality& quality = garray_resample_qualities[std::clamp(iquality, 0, kcount_resample_qualities - 1)];
+    const double ratio = static_cast<double>(phases) / static_cast<double>(step_source);
+    const double cutoff = quality.rolloff * std::min(1.0, ratio);
+    const uint32_t scale_taps = static_cast<uint32_t>(std::ceil(1.0 / std::min(1.0, ratio)));
+    const uint32_t taps = std::min(ktaps_resample_max, (quality.taps_base * scale_taps + 3u) & ~3u);
+    const double taps_before = taps / 2.0 - 1.0;
+
+    oresampler.is_identity = false;
+    oresampler.phases = static_cast<uint32_t>(phases);
+    oresampler.step_source = static_cast<uint32_t>(step_source);
+    oresampler.taps = taps;
+    oresampler.coefficients.assign(static_cast<size_t>(phases) * taps, 0.0f);
+    const double gain_window = 1.0 / function_bessel_i0(quality.beta_kaiser);
+    for (uint32_t phase = 0; phase < phases; ++phase) {
+        const double fraction = static_cast<double>(phase) / static_cast<double>(phases);
+        float* row = oresampler.coefficients.data() + static_cast<size_t>(phase) * taps;
+        double sum_row = 0.0;
+        for (uint32_t tap = 0; tap < taps; ++tap) {
+            const double t = static_cast<double>(tap) - taps_before - fraction;   // Distance from the read position
+            const double x = kPi * cutoff * t;
+            const double sinc = (std::fabs(x) < 1e-12) ? 1.0 : std::sin(x) / x;
+            const double u = t / (taps / 2.0);
+            const double window = function_bessel_i0(quality.beta_kaiser * std::sqrt(std::max(0.0, 1.0 - u * u))) * gain_window;
+            row[tap] = static_cast<float>(sinc * window);
+            sum_row += sinc * window;
+        }
+        for (uint32_t tap = 0; tap < taps; ++tap) row[tap] = static_cast<float>(row[tap] / sum_row);
     }
+}
 
-    float    field_gain_grain = 1.0f;
+/**
+ * Four output frames at once: each frame is a dot product of icount_taps (a
+ * multiple of 4) contiguous coefficients against contiguous source taps.
+ * Lane-wise products are accumulated per frame, then a single 4x4
+ * transpose-and-add replaces the four horizontal sums. Shared by the load-time
+ * resampler and the grain interpolation.
+ */
+inline void function_dot_frames4(const float* const icoefficients[4],
+                                 const float* const itaps[4],
+                                 uint32_t icount_taps,
+                                 float* oresampled) {
+#if defined(__SSE2__) || defined(__x86_64__)
+    __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps(), sum3 = _mm_setzero_ps();
+    for (uint32_t tap = 0; tap < icount_taps; tap += 4) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(icoefficients[0] + tap), _mm_loadu_ps(itaps[0] + tap)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(icoefficients[1] + tap), _mm_loadu_ps(itaps[1] + tap)));
+        sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(icoefficients[2] + tap), _mm_loadu_ps(itaps[2] + tap)));
+        sum3 = _mm_add_ps(sum3, _mm_mul_ps(_mm_loadu_ps(icoefficients[3] + tap), _mm_loadu_ps(itaps[3] + tap)));
+    }
+    _MM_TRANSPOSE4_PS(sum0, sum1, sum2, sum3);
+    _mm_storeu_ps(oresampled, _mm_add_ps(_mm_add_ps(sum0, sum1), _mm_add_ps(sum2, sum3)));
+#elif defined(__aarch64__)
+    float32x4_t sum0 = vdupq_n_f32(0.0f), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+    for (uint32_t tap = 0; tap < icount_taps; tap += 4) {
+        sum0 = vmlaq_f32(sum0, vld1q_f32(icoefficients[0] + tap), vld1q_f32(itaps[0] + tap));
+        sum1 = vmlaq_f32(sum1, vld1q_f32(icoefficients[1] + tap), vld1q_f32(itaps[1] + tap));
+        sum2 = vmlaq_f32(sum2, vld1q_f32(icoefficients[2] + tap), vld1q_f32(itaps[2] + tap));
+        sum3 = vmlaq_f32(sum3, vld1q_f32(icoefficients[3] + tap), vld1q_f32(itaps[3] + tap));
+    }
+    vst1q_f32(oresampled, vpaddq_f32(vpaddq_f32(sum0, sum1), vpaddq_f32(sum2, sum3)));
+#else
+    for (uint32_t lane = 0; lane < 4; ++lane) {
+        float sum = 0.0f;
+        for (uint32_t tap = 0; tap < icount_taps; ++tap) sum += icoefficients[lane][tap] * itaps[lane][tap];
+        oresampled[lane] = sum;
+    }
+#endif
+}
 
-    initialize_grain(*new_grain, field_start_frame, field_frames_grain, field_gain_grain);
-    ++global_ProcessGrain.active_envelopes_grain;
+// Resample output frames [iframe_first, iframe_first + icount_frames) of one channel.
+// isource holds file frames [isource_first, isource_first + iframes_source); taps outside it read as silence.
+void function_resample_span(const struct_resampler& iresampler,
+                            const float* isource,
+                            int64_t isource_first,
+                            int64_t iframes_source,
+                            uint64_t iframe_first,
+                            uint32_t icount_frames,
+                            float* odestination) {
+    const uint32_t taps = iresampler.taps;
+    const int64_t taps_before = taps / 2 - 1;
+    const uint64_t numerator = iframe_first * iresampler.step_source;
+    int64_t index = static_cast<int64_t>(numerator / iresampler.phases) - taps_before - isource_first;   // First tap, relative to isource
+    uint32_t phase = static_cast<uint32_t>(numerator % iresampler.phases);
+    const int64_t step_index = iresampler.step_source / iresampler.phases;
+    const uint32_t step_phase = iresampler.step_source % iresampler.phases;
+
+    for (uint32_t fr = 0; fr < icount_frames; fr += 4) {
+        const uint32_t count_lanes = std::min(4u, icount_frames - fr);
+        const float* garray_coefficients[4];
+        const float* garray_taps[4];
+        int64_t garray_index[4];
+        bool status_inside = (count_lanes == 4);
+        for (uint32_t lane = 0; lane < count_lanes; ++lane) {
+            garray_index[lane] = index;
+            garray_coefficients[lane] = iresampler.coefficients.data() + static_cast<size_t>(phase) * taps;
+            status_inside = status_inside && index >= 0 && index + taps <= iframes_source;
+            index += step_index;
+            phase += step_phase;
+            if (phase >= iresampler.phases) {
+                phase -= iresampler.phases;
+                ++index;
+            }
+        }
+        if (status_inside) {
+            for (uint32_t lane = 0; lane < 4; ++lane) garray_taps[lane] = isource + garray_index[lane];
+            function_dot_frames4(garray_coefficients, garray_taps, taps, odestination + fr);
+            continue;
+        }
+        // Near the edges of the span: only the taps that exist
+        for (uint32_t lane = 0; lane < count_lanes; ++lane) {
+            const int64_t tap_first = std::max<int64_t>(0, -garray_index[lane]);
+            const int64_t tap_end = std::min<int64_t>(taps, iframes_source - garray_index[lane]);
+            float sum = 0.0f;
+            for (int64_t tap = tap_first; tap < tap_end; ++tap) sum += garray_coefficients[lane][tap] * isource[garray_index[lane] + tap];
+            odestination[fr + lane] = sum;
+        }
+    }
 }
 
 // =============================================================================
-// REAL-TIME AUDIO PROCESSING CALLBACK - CORE ENGINE
+// MEMORY-MAPPED SOURCE LOADING
 // =============================================================================
 
 /**
- * High-Performance Real-Time Audio Processing Callback
- * 
- * This is the heart of the granular synthesis engine, called by Core Audio at
- * regular intervals to generate audio in real-time. This function must execute
- * with extremely low latency and high reliability, as any delays or errors will
- * cause audio dropouts.
- * 
- * TECHNICAL CHALLENGES SOLVED:
- * • Lock-free programming for real-time thread safety
- * • Efficient memory management without dynamic allocation
- * • Multi-channel audio routing with flexible channel mapping
- * • Calculated grain envelope processing
- * • Sample-accurate timing and synchronization
- * 
- * PERFORMANCE CHARACTERISTICS:
- * - Executes in high-priority real-time audio thread
- * - Must complete processing within ~10ms buffer periods
- * - Zero dynamic memory allocation for stability
- * - Optimized mathematical operations for efficiency
- * 
- * @param ibox_audio User data pointer (AudioFileData structure)
- * @param ioget_flag Audio unit render action flags
- * @param struct_istamp_time Precise timing information for synchronization
- * @param iget_bus Audio unit bus number (typically 0)
- * @param icount_frames Number of audio frames to process this callback
- * @param struct_ioData_period_buffer Output audio buffer list for all channels
- * @return OSStatus indicating success (noErr) or error condition
+ * MAPPED SOURCE LOADER
+ *
+ * The file is mapped read-only instead of streamed through std::ifstream:
+ * • Mono IEEE float data is used in place: samples[0] points straight into
+ *   the mapping, so nothing is copied or converted
+ * • Every other layout is converted to planar float in one pass, in blocks of
+ *   kframes_block_load frames, into a single preallocated planar buffer.
+ *   Interleaved float still needs this pass because grains read each channel
+ *   as one contiguous span.
+ *
+ * Pages already converted are dropped from the mapping as the pass advances,
+ * so peak memory stays close to the planar buffer itself. Load time and peak
+ * resident set size are reported once loading finishes.
+ *
+ * PARALLEL DECODE:
+ * The data region is split into kframes_block_load chunks that a pool of
+ * worker threads claims from a shared counter. Chunks are independent: each
+ * worker decodes straight into its own slice of the planar buffer with its
+ * own scratch block, so no locking is needed beyond the counter. The pool
+ * size defaults to the core count (g_count_workers_decode overrides it).
+ * The planar buffer is not zero-filled up front (planar_frames_t), so the
+ * page faults for each slice are taken by the worker that decodes it rather
+ * than serially on the loading thread.
  */
-static OSStatus function_callback_audio(void* ibox_audio,
-                                        AudioUnitRenderActionFlags* ioget_flag,
-                                        const AudioTimeStamp* struct_istamp_time, 
-                                        UInt32 iget_bus,
-                                        UInt32 icount_frames,
-                                        AudioBufferList* struct_ioData_period_buffer) { 
+constexpr uint32_t kframes_block_load = 65536;
+uint32_t g_count_workers_decode = 0;   // 0 = one worker per hardware thread
 
-    UInt32 numBuffers = struct_ioData_period_buffer->mNumberBuffers;
-    UInt32 outChannels = (numBuffers == 1)
-        ? struct_ioData_period_buffer->mBuffers[0].mNumberChannels
-        : numBuffers;
-    UInt32 inChannels = global_AudioFileData.channels_file;
-    UInt32 minChannels = std::min(outChannels, inChannels);
-    const bool isNonInterleaved = g_output_non_interleaved ? true : (numBuffers > 1);
-    
-    global_ProcessGrain.count_present_frame += icount_frames;
+// Workers to use for icount_chunks chunks of decode work
+uint32_t function_decode_workers(uint32_t icount_chunks) {
+    uint32_t count_workers = g_count_workers_decode ? g_count_workers_decode : std::thread::hardware_concurrency();
+    return std::max(1u, std::min(count_workers, icount_chunks));
+}
 
-    for (UInt32 buffer_willempty = 0; buffer_willempty < struct_ioData_period_buffer->mNumberBuffers; ++buffer_willempty)
-        std::memset(struct_ioData_period_buffer->mBuffers[buffer_willempty].mData,
-                    0,
-                    struct_ioData_period_buffer->mBuffers[buffer_willempty].mDataByteSize);
-    
-    // grain start interval is adjustable (DENSITY PARAMETER)
-    const uint32_t interval_start_frames = static_cast<uint32_t>(global_ProcessGrain.frames_object_grain * g_interval_multiplier);
+// Run iworker on icount_workers threads, the calling thread being one of them, and wait for all
+template <typename Worker>
+void function_worker_pool_run(uint32_t icount_workers, Worker&& iworker) {
+    std::vector<std::thread> pool_workers;
+    for (uint32_t worker = 1; worker < icount_workers; ++worker) pool_workers.emplace_back(iworker);
+    iworker();
+    for (std::thread& thread_worker : pool_workers) thread_worker.join();
+}
 
-    if (global_ProcessGrain.count_present_frame >= interval_start_frames) {
-        function_process_grain();
-        global_ProcessGrain.count_present_frame = 0; 
+// Peak resident set size of this process in bytes
+size_t function_peak_rss_bytes() {
+    struct rusage usage_resource{};
+    getrusage(RUSAGE_SELF, &usage_resource);
+#ifdef __APPLE__
+    return static_cast<size_t>(usage_resource.ru_maxrss);          // Bytes on macOS
+#else
+    return static_cast<size_t>(usage_resource.ru_maxrss) * 1024u;  // Kilobytes on Linux
+#endif
+}
+
+// Unmap the file (if still mapped) and drop the planar buffer
+void function_source_release() {
+    if (global_AudioFileData.address_mapping) {
+        munmap(const_cast<void*>(global_AudioFileData.address_mapping), global_AudioFileData.bytes_mapping);
+        global_AudioFileData.address_mapping = nullptr;
+        global_AudioFileData.bytes_mapping = 0;
     }
+    global_AudioFileData.samples.clear();
+    planar_frames_t().swap(global_AudioFileData.frames_planar);
+}
 
-    UInt32 count_ch = global_AudioFileData.channels_file;
-    uint32_t total_fr = global_AudioFileData.frames_total;
-    uint32_t callback_start_fr = global_AudioFileData.present_frame;
+/**
+ * SAMPLE DECODERS
+ *
+ * Each supported sample format has a block converter from interleaved file
+ * bytes to interleaved float; function_decode_block then splits the floats
+ * into planar channels through a small cache-resident scratch block.
+ *
+ * FORMATS (full scale maps to ±1.0):
+ * • 8-bit unsigned PCM (offset 128), 16/24/32-bit signed PCM (24-bit packed)
+ * • 32-bit and 64-bit IEEE float
+ *
+ * Integer samples are placed in the top bits of an int32 and scaled by 2^-31,
+ * which is exact for every width, so the SIMD converters (SSE2 / SSSE3 / NEON)
+ * match the scalar reference bit for bit. The best variant is chosen once per
+ * file from the CPU's features.
+ */
+typedef void (*function_convert_t)(const unsigned char* isource, float* odestination, size_t icount_samples);
 
-    const float kDryGain = 0.0f;
-    const float kWetGain = 1.0f;
-    
+constexpr float kscale_pcm_top = 1.0f / 2147483648.0f;   // Integer placed in the top bits of an int32 -> ±1.0
+constexpr uint32_t kframes_decode_block = 1024;          // Interleaved float scratch per pass
 
-    std::vector<float> mix(outChannels * icount_frames, 0.0f);
-    auto mixIndex = [icount_frames](UInt32 ch, UInt32 fr) {
-        return static_cast<size_t>(ch) * static_cast<size_t>(icount_frames) + static_cast<size_t>(fr);
-    };
+void function_convert_pcm8_scalar(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    for (size_t n = 0; n < icount_samples; ++n)
+        odestination[n] = static_cast<float>(static_cast<int32_t>(static_cast<uint32_t>(isource[n] ^ 0x80u) << 24)) * kscale_pcm_top;
+}
 
- 
-    if (!g_run_channel_order_test && g_status_audio_playback) {
-        for (UInt32 ch_callback = 0; ch_callback < outChannels; ++ch_callback) {
-            for (UInt32 fr_callback = 0; fr_callback < icount_frames; ++fr_callback) {
+void function_convert_pcm16_scalar(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    for (size_t n = 0; n < icount_samples; ++n) {
+        const uint32_t value = static_cast<uint32_t>(isource[2 * n]) << 16 | static_cast<uint32_t>(isource[2 * n + 1]) << 24;
+        odestination[n] = static_cast<float>(static_cast<int32_t>(value)) * kscale_pcm_top;
+    }
+}
 
-                uint32_t fr_read = callback_start_fr + fr_callback;
-                
-                uint16_t file_ch = ch_callback % global_AudioFileData.channels_file;
-                // Audio callback tries to read past end, gets 0.0f (silence) instead of audio data
-                mix[mixIndex(ch_callback, fr_callback)] = kDryGain * (
-                    (fr_read < total_fr) ? global_AudioFileData.samples[file_ch][fr_read] : 0.0f  // Result: Audio fades to silence and stays silent
-                );
-            }
-        }
-        // Audio position reaches total_fr (end of file), std::min() keeps position at total_fr (doesn't advance further)
-        global_AudioFileData.present_frame = std::min(callback_start_fr + icount_frames, total_fr);
+void function_convert_pcm24_scalar(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    for (size_t n = 0; n < icount_samples; ++n) {
+        const unsigned char* bytes = isource + 3 * n;
+        const uint32_t value = static_cast<uint32_t>(bytes[0]) << 8 | static_cast<uint32_t>(bytes[1]) << 16 |
+                               static_cast<uint32_t>(bytes[2]) << 24;
+        odestination[n] = static_cast<float>(static_cast<int32_t>(value)) * kscale_pcm_top;
+    }
+}
 
-        // THIS WOULD ADD A LOOPING FEATURE
-        // global_AudioFileData.present_frame = callback_start_fr + icount_frames;
-        
-        // Loop the audio when it reaches the end
-        // if (global_AudioFileData.present_frame >= total_fr) {
-        //     global_AudioFileData.present_frame = 0;
-        // }
+void function_convert_pcm32_scalar(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    for (size_t n = 0; n < icount_samples; ++n) {
+        int32_t value;
+        std::memcpy(&value, isource + 4 * n, sizeof(value));   // Data chunks need not be aligned
+        odestination[n] = static_cast<float>(value) * kscale_pcm_top;
     }
+}
 
-    float normal_sample_channel[16];
-    
+void function_convert_float32_scalar(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    std::memcpy(odestination, isource, icount_samples * sizeof(float));
+}
 
-    if (g_status_audio_playback && callback_start_fr < total_fr) {
-    for (struct_grain& element_grain : global_ProcessGrain.object_array_grains) {
-        if (!element_grain.status_callback_grain) 
-            continue;
+void function_convert_float64_scalar(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    for (size_t n = 0; n < icount_samples; ++n) {
+        double value;
+        std::memcpy(&value, isource + 8 * n, sizeof(value));
+        odestination[n] = static_cast<float>(value);
+    }
+}
 
-        uint32_t frames_grain_ahead = element_grain.frames_grain - element_grain.address_present_grain;
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+void function_convert_pcm8_sse2(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    const __m128i offset = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(kscale_pcm_top);
+    size_t n = 0;
+    for (; n + 16 <= icount_samples; n += 16) {
+        const __m128i bytes = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(isource + n)), offset);
+        const __m128i words_lo = _mm_unpacklo_epi8(zero, bytes);   // Sample in the top byte of each 16-bit lane
+        const __m128i words_hi = _mm_unpackhi_epi8(zero, bytes);
+        _mm_storeu_ps(odestination + n,      _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(zero, words_lo)), scale));
+        _mm_storeu_ps(odestination + n + 4,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(zero, words_lo)), scale));
+        _mm_storeu_ps(odestination + n + 8,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(zero, words_hi)), scale));
+        _mm_storeu_ps(odestination + n + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(zero, words_hi)), scale));
+    }
+    function_convert_pcm8_scalar(isource + n, odestination + n, icount_samples - n);
+}
 
-        double rho = double(element_grain.frames_grain) / double(interval_start_frames);
+__attribute__((target("sse2")))
+void function_convert_pcm16_sse2(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(kscale_pcm_top);
+    size_t n = 0;
+    for (; n + 8 <= icount_samples; n += 8) {
+        const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(isource + 2 * n));
+        _mm_storeu_ps(odestination + n,     _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(zero, words)), scale));
+        _mm_storeu_ps(odestination + n + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(zero, words)), scale));
+    }
+    function_convert_pcm16_scalar(isource + 2 * n, odestination + n, icount_samples - n);
+}
+
+__attribute__((target("ssse3")))
+void function_convert_pcm24_ssse3(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    // Four packed 3-byte samples -> the top three bytes of four int32 lanes
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128 scale = _mm_set1_ps(kscale_pcm_top);
+    size_t n = 0;
+    for (; n + 6 <= icount_samples; n += 4) {   // The 16-byte load reads past the 12 bytes used
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(isource + 3 * n));
+        _mm_storeu_ps(odestination + n, _mm_mul_ps(_mm_cvtepi32_ps(_mm_shuffle_epi8(bytes, shuffle)), scale));
+    }
+    function_convert_pcm24_scalar(isource + 3 * n, odestination + n, icount_samples - n);
+}
+
+__attribute__((target("sse2")))
+void function_convert_pcm32_sse2(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    const __m128 scale = _mm_set1_ps(kscale_pcm_top);
+    size_t n = 0;
+    for (; n + 4 <= icount_samples; n += 4) {
+        const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(isource + 4 * n));
+        _mm_storeu_ps(odestination + n, _mm_mul_ps(_mm_cvtepi32_ps(words), scale));
+    }
+    function_convert_pcm32_scalar(isource + 4 * n, odestination + n, icount_samples - n);
+}
+
+__attribute__((target("sse2")))
+void function_convert_float64_sse2(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    size_t n = 0;
+    for (; n + 4 <= icount_samples; n += 4) {
+        const __m128 pair_lo = _mm_cvtpd_ps(_mm_loadu_pd(reinterpret_cast<const double*>(isource + 8 * n)));
+        const __m128 pair_hi = _mm_cvtpd_ps(_mm_loadu_pd(reinterpret_cast<const double*>(isource + 8 * n + 16)));
+        _mm_storeu_ps(odestination + n, _mm_movelh_ps(pair_lo, pair_hi));
+    }
+    function_convert_float64_scalar(isource + 8 * n, odestination + n, icount_samples - n);
+}
+#elif defined(__aarch64__)
+void function_convert_pcm8_neon(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    const float32x4_t scale = vdupq_n_f32(1.0f / 128.0f);
+    size_t n = 0;
+    for (; n + 16 <= icount_samples; n += 16) {
+        const int8x16_t bytes = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(isource + n), vdupq_n_u8(0x80)));
+        const int16x8_t words_lo = vmovl_s8(vget_low_s8(bytes));
+        const int16x8_t words_hi = vmovl_s8(vget_high_s8(bytes));
+        vst1q_f32(odestination + n,      vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(words_lo))), scale));
+        vst1q_f32(odestination + n + 4,  vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(words_lo))), scale));
+        vst1q_f32(odestination + n + 8,  vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(words_hi))), scale));
+        vst1q_f32(odestination + n + 12, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(words_hi))), scale));
+    }
+    function_convert_pcm8_scalar(isource + n, odestination + n, icount_samples - n);
+}
+
+void function_convert_pcm16_neon(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    const float32x4_t scale = vdupq_n_f32(1.0f / 32768.0f);
+    size_t n = 0;
+    for (; n + 8 <= icount_samples; n += 8) {
+        const int16x8_t words = vreinterpretq_s16_u8(vld1q_u8(isource + 2 * n));
+        vst1q_f32(odestination + n,     vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(words))), scale));
+        vst1q_f32(odestination + n + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(words))), scale));
+    }
+    function_convert_pcm16_scalar(isource + 2 * n, odestination + n, icount_samples - n);
+}
+
+void function_convert_pcm24_neon(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    // De-interleave 16 packed samples into their low, middle and high bytes, then rebuild int32 lanes
+    const float32x4_t scale = vdupq_n_f32(kscale_pcm_top);
+    const uint8x16_t zero = vdupq_n_u8(0);
+    size_t n = 0;
+    for (; n + 16 <= icount_samples; n += 16) {
+        const uint8x16x3_t bytes = vld3q_u8(isource + 3 * n);
+        const uint16x8_t low_lo  = vreinterpretq_u16_u8(vzip1q_u8(zero, bytes.val[0]));          // b0 << 8
+        const uint16x8_t low_hi  = vreinterpretq_u16_u8(vzip2q_u8(zero, bytes.val[0]));
+        const uint16x8_t high_lo = vreinterpretq_u16_u8(vzip1q_u8(bytes.val[1], bytes.val[2])); // b1 | b2 << 8
+        const uint16x8_t high_hi = vreinterpretq_u16_u8(vzip2q_u8(bytes.val[1], bytes.val[2]));
+        const int32x4_t garray_words[4] = {
+            vreinterpretq_s32_u16(vzip1q_u16(low_lo, high_lo)), vreinterpretq_s32_u16(vzip2q_u16(low_lo, high_lo)),
+            vreinterpretq_s32_u16(vzip1q_u16(low_hi, high_hi)), vreinterpretq_s32_u16(vzip2q_u16(low_hi, high_hi))};
+        for (int quad = 0; quad < 4; ++quad)
+            vst1q_f32(odestination + n + 4 * quad, vmulq_f32(vcvtq_f32_s32(garray_words[quad]), scale));
+    }
+    function_convert_pcm24_scalar(isource + 3 * n, odestination + n, icount_samples - n);
+}
+
+void function_convert_pcm32_neon(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    const float32x4_t scale = vdupq_n_f32(kscale_pcm_top);
+    size_t n = 0;
+    for (; n + 4 <= icount_samples; n += 4)
+        vst1q_f32(odestination + n, vmulq_f32(vcvtq_f32_s32(vreinterpretq_s32_u8(vld1q_u8(isource + 4 * n))), scale));
+    function_convert_pcm32_scalar(isource + 4 * n, odestination + n, icount_samples - n);
+}
+
+void function_convert_float64_neon(const unsigned char* isource, float* odestination, size_t icount_samples) {
+    size_t n = 0;
+    for (; n + 4 <= icount_samples; n += 4) {
+        const float32x2_t pair_lo = vcvt_f32_f64(vreinterpretq_f64_u8(vld1q_u8(isource + 8 * n)));
+        const float32x2_t pair_hi = vcvt_f32_f64(vreinterpretq_f64_u8(vld1q_u8(isource + 8 * n + 16)));
+        vst1q_f32(odestination + n, vcombine_f32(pair_lo, pair_hi));
+    }
+    function_convert_float64_scalar(isource + 8 * n, odestination + n, icount_samples - n);
+}
+#endif
+
+struct struct_sample_decoder {
+    const char* name_decoder;               // e.g. "24-bit PCM (SSSE3)"
+    uint16_t bytes_sample;                  // Container bytes per sample
+    function_convert_t function_convert;    // Interleaved bytes -> interleaved float
+};
+
+// Pick the converter for a validated format; istatus_scalar forces the reference variant
+bool function_decoder_select(const struct_wav_format& iformat, struct_sample_decoder& odecoder, bool istatus_scalar = false) {
+    const bool is_float = (iformat.format_tag == kwave_format_ieee_float);
+    odecoder = struct_sample_decoder{nullptr, static_cast<uint16_t>(iformat.bits_sample / 8), nullptr};
+    if (is_float && iformat.bits_sample == 32)       odecoder = {"32-bit float", 4, function_convert_float32_scalar};
+    else if (is_float && iformat.bits_sample == 64)  odecoder = {"64-bit float", 8, function_convert_float64_scalar};
+    else if (!is_float && iformat.bits_sample == 8)  odecoder = {"8-bit PCM", 1, function_convert_pcm8_scalar};
+    else if (!is_float && iformat.bits_sample == 16) odecoder = {"16-bit PCM", 2, function_convert_pcm16_scalar};
+    else if (!is_float && iformat.bits_sample == 24) odecoder = {"24-bit PCM", 3, function_convert_pcm24_scalar};
+    else if (!is_float && iformat.bits_sample == 32) odecoder = {"32-bit PCM", 4, function_convert_pcm32_scalar};
+    if (!odecoder.function_convert) return false;
+    if (istatus_scalar) return true;
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    const bool status_sse2 = __builtin_cpu_supports("sse2");
+    if (odecoder.function_convert == function_convert_pcm8_scalar && status_sse2)    odecoder.function_convert = function_convert_pcm8_sse2;
+    if (odecoder.function_convert == function_convert_pcm16_scalar && status_sse2)   odecoder.function_convert = function_convert_pcm16_sse2;
+    if (odecoder.function_convert == function_convert_pcm24_scalar && __builtin_cpu_supports("ssse3"))
+        odecoder.function_convert = function_convert_pcm24_ssse3;
+    if (odecoder.function_convert == function_convert_pcm32_scalar && status_sse2)   odecoder.function_convert = function_convert_pcm32_sse2;
+    if (odecoder.function_convert == function_convert_float64_scalar && status_sse2) odecoder.function_convert = function_convert_float64_sse2;
+#elif defined(__aarch64__)
+    if (odecoder.function_convert == function_convert_pcm8_scalar)    odecoder.function_convert = function_convert_pcm8_neon;
+    if (odecoder.function_convert == function_convert_pcm16_scalar)   odecoder.function_convert = function_convert_pcm16_neon;
+    if (odecoder.function_convert == function_convert_pcm24_scalar)   odecoder.function_convert = function_convert_pcm24_neon;
+    if (odecoder.function_convert == function_convert_pcm32_scalar)   odecoder.function_convert = function_convert_pcm32_neon;
+    if (odecoder.function_convert == function_convert_float64_scalar) odecoder.function_convert = function_convert_float64_neon;
+#endif
+    return true;
+}
+
+// Decode icount_frames interleaved frames into one planar destination per channel.
+// iscratch holds kframes_decode_block x ichannels floats (unused for mono).
+void function_decode_block(const struct_sample_decoder& idecoder,
+                           const unsigned char* idata,
+                           uint16_t ichannels,
+                           uint32_t icount_frames,
+                           float* iscratch,
+                           float* const* odestination) {
+    if (ichannels == 1) {
+        idecoder.function_convert(idata, odestination[0], icount_frames);
+        return;
+    }
+    const size_t bytes_frame = static_cast<size_t>(idecoder.bytes_sample) * ichannels;
+    for (uint32_t frame_first = 0; frame_first < icount_frames; frame_first += kframes_decode_block) {
+        const uint32_t count_frames = std::min(kframes_decode_block, icount_frames - frame_first);
+        idecoder.function_convert(idata + frame_first * bytes_frame, iscratch, static_cast<size_t>(count_frames) * ichannels);
+        for (uint16_t ch = 0; ch < ichannels; ++ch) {
+            float* planar = odestination[ch] + frame_first;
+            const float* interleaved = iscratch + ch;
+            for (uint32_t fr = 0; fr < count_frames; ++fr) planar[fr] = interleaved[static_cast<size_t>(fr) * ichannels];
+        }
+    }
+}
+
+/**
+ * Makes a read-only mapping that the audio thread reads in place safe for
+ * random access: read-ahead is switched to random, every page is touched
+ * here on the loading thread, and the range is locked when RLIMIT_MEMLOCK
+ * allows. Unlocked, clean file pages can still be reclaimed under memory
+ * pressure; the return value says whether the lock took.
+ */
+bool function_mapping_prefault(void* iaddress, size_t ibytes) {
+    madvise(iaddress, ibytes, MADV_RANDOM);     // Grain reads jump around: no sequential read-ahead or drop-behind
+    madvise(iaddress, ibytes, MADV_WILLNEED);
+    const size_t bytes_page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const volatile unsigned char* bytes = static_cast<const unsigned char*>(iaddress);
+    unsigned char sum_touch = 0;
+    for (size_t offset = 0; offset < ibytes; offset += bytes_page) sum_touch += bytes[offset];
+    (void)sum_touch;
+    return mlock(iaddress, ibytes) == 0;
+}
+
+bool function_source_load_mapped(const std::string& iname_file, const struct_wav_format& iformat) {
+    auto time_start = std::chrono::steady_clock::now();
+    function_source_release();
+    global_AudioFileData.source_streaming = false;
+    global_AudioFileData.format_file = iformat;
+
+    const uint64_t address_data = iformat.address_data;
+    const uint16_t channels = iformat.channels_file;
+    const uint16_t bits_sample = iformat.bits_sample;
+    const bool is_float = (iformat.format_tag == kwave_format_ieee_float);
+
+    struct_sample_decoder decoder;
+    if (!function_decoder_select(iformat, decoder) || channels == 0) {
+        std::cerr << "Unsupported sample format: " << bits_sample << "-bit " << (is_float ? "float" : "PCM") << "\n";
+        return false;
+    }
+
+    int descriptor_file = open(iname_file.c_str(), O_RDONLY);
+    if (descriptor_file < 0) {
+        std::cerr << "Could not open " << iname_file << " for mapping.\n";
+        return false;
+    }
+    struct stat status_file{};
+    fstat(descriptor_file, &status_file);
+    const size_t bytes_file = static_cast<size_t>(status_file.st_size);
+    void* address_mapping = (bytes_file > address_data)
+        ? mmap(nullptr, bytes_file, PROT_READ, MAP_PRIVATE, descriptor_file, 0)
+        : MAP_FAILED;
+    close(descriptor_file);   // The mapping keeps its own reference to the file
+    if (address_mapping == MAP_FAILED) {
+        std::cerr << "Could not map " << iname_file << ".\n";
+        return false;
+    }
+    // A truncated data chunk only yields the frames actually present
+    const uint32_t bytes_sample = bits_sample / 8;
+    const size_t bytes_data = std::min<size_t>(iformat.bytes_data, bytes_file - address_data);
+    const unsigned char* data = static_cast<const unsigned char*>(address_mapping) + address_data;
+
+    global_AudioFileData.channels_file = channels;
+    global_AudioFileData.frames_total = static_cast<uint32_t>(bytes_data / (static_cast<size_t>(bytes_sample) * channels));
+    global_AudioFileData.file_is_ieee_float = is_float;
+    global_AudioFileData.samples.assign(channels, nullptr);
+
+    const bool status_zero_copy = is_float && channels == 1 && (address_data % alignof(float)) == 0;
+    uint32_t count_workers = 0;
+    bool status_locked = false;
+    if (status_zero_copy) {
+        // Used in place by the audio thread: fault it all in now, not on the callback.
+        // The mapping lives until function_source_release.
+        status_locked = function_mapping_prefault(address_mapping, bytes_file);
+        global_AudioFileData.address_mapping = address_mapping;
+        global_AudioFileData.bytes_mapping = bytes_file;
+        global_AudioFileData.samples[0] = reinterpret_cast<const float*>(data);
+    } else {
+        madvise(address_mapping, bytes_file, MADV_SEQUENTIAL);   // Decoded front to back, then dropped
+        // Left uninitialized: every frame is written by exactly one decode worker, which faults its pages in
+        global_AudioFileData.frames_planar.resize(static_cast<size_t>(channels) * global_AudioFileData.frames_total);
+        for (uint16_t ch = 0; ch < channels; ++ch) {
+            global_AudioFileData.samples[ch] = global_AudioFileData.frames_planar.data()
+                                             + static_cast<size_t>(ch) * global_AudioFileData.frames_total;
+        }
+
+        const size_t bytes_page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t bytes_frame = static_cast<size_t>(bytes_sample) * channels;
+        const uint32_t frames_total = global_AudioFileData.frames_total;
+        const uint32_t count_chunks = (frames_total + kframes_block_load - 1) / kframes_block_load;
+        std::atomic<uint32_t> chunk_next{0};
+
+        auto function_decode_worker = [&]() {
+            std::vector<float*> destination_block(channels);
+            std::vector<float> scratch_decode(static_cast<size_t>(kframes_decode_block) * channels);
+            for (uint32_t chunk = chunk_next.fetch_add(1); chunk < count_chunks; chunk = chunk_next.fetch_add(1)) {
+                const uint32_t frame_first = chunk * kframes_block_load;
+                const uint32_t count_frames = std::min(kframes_block_load, frames_total - frame_first);
+                for (uint16_t ch = 0; ch < channels; ++ch) {
+                    destination_block[ch] = global_AudioFileData.frames_planar.data()
+                                          + static_cast<size_t>(ch) * frames_total + frame_first;
+                }
+                function_decode_block(decoder, data + frame_first * bytes_frame, channels, count_frames,
+                                      scratch_decode.data(), destination_block.data());
+
+                // Drop the source pages lying wholly inside this chunk
+                const size_t bytes_begin = address_data + frame_first * bytes_frame;
+                const size_t bytes_end = bytes_begin + count_frames * bytes_frame;
+                const size_t page_begin = (bytes_begin + bytes_page - 1) / bytes_page * bytes_page;
+                const size_t page_end = bytes_end / bytes_page * bytes_page;
+                if (page_end > page_begin) {
+                    madvise(static_cast<char*>(address_mapping) + page_begin, page_end - page_begin, MADV_DONTNEED);
+                }
+            }
+        };
+
+        count_workers = function_decode_workers(count_chunks);
+        function_worker_pool_run(count_workers, function_decode_worker);
+        munmap(address_mapping, bytes_file);
+    }
+
+    auto time_end = std::chrono::steady_clock::now();
+    std::cout << "Source loaded: " << global_AudioFileData.frames_total << " frames x " << channels << " channels ("
+              << (status_zero_copy ? (status_locked ? "mapped in place, locked" : "mapped in place, prefaulted")
+                                   : "converted to planar") << ", " << decoder.name_decoder;
+    if (count_workers > 0) std::cout << ", " << count_workers << (count_workers == 1 ? " worker" : " workers");
+    std::cout << ") in "
+              << std::chrono::duration<double, std::milli>(time_end - time_start).count() << " ms, peak RSS "
+              << (function_peak_rss_bytes() / (1024.0 * 1024.0)) << " MB\n";
+    return true;
+}
+
+// Convert the resident source to the engine rate (global_Resampler) on the worker pool
+bool function_source_resample() {
+    const struct_resampler& resampler = global_Resampler;
+    if (resampler.is_identity) return true;
+
+    auto time_start = std::chrono::steady_clock::now();
+    const uint16_t channels = global_AudioFileData.channels_file;
+    const uint32_t frames_source = global_AudioFileData.frames_total;
+    const uint64_t frames_engine = function_resample_frames(resampler, frames_source);
+    if (frames_engine > std::numeric_limits<uint32_t>::max()) {
+        std::cerr << "Source too long to resample: " << frames_engine << " frames at the engine rate.\n";
+        return false;
+    }
+
+    planar_frames_t frames_converted(static_cast<size_t>(channels) * frames_engine);   // Written once by the workers
+    const uint32_t chunks_channel = static_cast<uint32_t>((frames_engine + kframes_block_load - 1) / kframes_block_load);
+    const uint32_t count_chunks = chunks_channel * channels;
+    std::atomic<uint32_t> chunk_next{0};
+    auto function_resample_worker = [&]() {
+        for (uint32_t chunk = chunk_next.fetch_add(1); chunk < count_chunks; chunk = chunk_next.fetch_add(1)) {
+            const uint16_t ch = static_cast<uint16_t>(chunk / chunks_channel);
+            const uint64_t frame_first = static_cast<uint64_t>(chunk % chunks_channel) * kframes_block_load;
+            const uint32_t count_frames = static_cast<uint32_t>(std::min<uint64_t>(kframes_block_load, frames_engine - frame_first));
+            function_resample_span(resampler, global_AudioFileData.samples[ch], 0, frames_source, frame_first, count_frames,
+                                   frames_converted.data() + ch * frames_engine + frame_first);
+        }
+    };
+    const uint32_t count_workers = function_decode_workers(count_chunks);
+    function_worker_pool_run(count_workers, function_resample_worker);
+
+    // Swap the converted frames in; an in-place mapping is no longer needed
+    if (global_AudioFileData.address_mapping) {
+        munmap(const_cast<void*>(global_AudioFileData.address_mapping), global_AudioFileData.bytes_mapping);
+        global_AudioFileData.address_mapping = nullptr;
+        global_AudioFileData.bytes_mapping = 0;
+    }
+    global_AudioFileData.frames_planar.swap(frames_converted);
+    global_AudioFileData.frames_total = static_cast<uint32_t>(frames_engine);
+    for (uint16_t ch = 0; ch < channels; ++ch) {
+        global_AudioFileData.samples[ch] = global_AudioFileData.frames_planar.data() + ch * frames_engine;
+    }
+
+    auto time_end = std::chrono::steady_clock::now();
+    std::cout << "Source resampled: " << frames_source << " -> " << frames_engine << " frames (" << resampler.phases << "/"
+              << resampler.step_source << ", " << resampler.taps << " taps, " << count_workers
+              << (count_workers == 1 ? " worker" : " workers") << ") in "
+              << std::chrono::duration<double, std::milli>(time_end - time_start).count() << " ms\n";
+    return true;
+}
+
+// =============================================================================
+// PLANAR SIDECAR CACHE
+// =============================================================================
+
+/**
+ * DECODED SOURCE CACHE
+ *
+ * After a resident source has been decoded (and resampled), its planar
+ * channels are written next to the WAV as "<file>.planar". On the next
+ * launch the sidecar is mapped read-only and samples[] points straight into
+ * it, so parsing, decoding and resampling are skipped entirely.
+ *
+ * LAYOUT:
+ * • A kbytes_sidecar_align header, then one channel after another
+ * • Every channel starts on a kbytes_sidecar_align boundary (16 KB covers
+ *   both 4 KB and 16 KB VM pages), so each channel is page-aligned in the map
+ *
+ * VALIDITY: the header is keyed on the source's size, modification time and
+ * a sampled FNV-1a hash, plus everything the planar data depends on (channel
+ * count, engine rate, resampler phases and taps). To keep a cache hit fast
+ * the hash covers the first and last kbytes_sidecar_hash_edge bytes of the
+ * source and 64 evenly spaced 4 KB blocks in between, not every byte. This
+ * is not a full content check: an edit that keeps the size and mtime and
+ * falls outside the sampled blocks plays the stale cached audio. Any
+ * detected mismatch, or a short file, rebuilds the sidecar. It is written
+ * under a temporary name and renamed into place, so a crash never leaves a
+ * half-written cache.
+ *
+ * OPT-IN: caching is off by default (g_status_sidecar). The live app asks at
+ * startup and the offline render takes --sidecar / --no-sidecar. A source
+ * whose directory is not writable is never cached, even when enabled.
+ */
+constexpr char kmagic_sidecar[8] = {'G', 'R', 'N', 'P', 'L', 'A', 'N', '1'};
+constexpr uint32_t kversion_sidecar = 1;
+constexpr uint64_t kbytes_sidecar_align = 16384;
+constexpr uint64_t kbytes_sidecar_hash_edge = 65536;
+bool g_status_sidecar = false;   // Use and write <file>.planar caches for resident sources
+
+struct struct_sidecar_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t channels;
+    uint64_t bytes_source;          // Source file size
+    int64_t mtime_source_ns;        // Source modification time
+    uint64_t hash_source;           // Sampled content hash (function_sidecar_hash)
+    uint32_t rate_source;           // Source rate; with the resampler fields this fixes the engine rate
+    uint32_t phases_resample;       // Resampler the frames went through (1/1/0 = none)
+    uint32_t step_resample;
+    uint32_t taps_resample;
+    uint32_t frames_total;          // Frames per channel
+    uint32_t reserved;
+    uint64_t bytes_stride_channel;  // Distance between channel starts
+};
+static_assert(sizeof(struct_sidecar_header) <= kbytes_sidecar_align, "Sidecar header must fit before channel 0");
+
+std::string function_sidecar_name(const std::string& iname_file) {
+    return iname_file + ".planar";
+}
+
+// FNV-1a over the source's first and last bytes and 64 evenly spaced blocks between them
+uint64_t function_sidecar_hash(int idescriptor_file, uint64_t ibytes_file) {
+    uint64_t hash = 1469598103934665603ull;
+    std::vector<unsigned char> bytes_block(kbytes_sidecar_hash_edge);
+    auto function_hash_range = [&](uint64_t iaddress, uint64_t icount) {
+        icount = std::min(icount, ibytes_file - std::min(iaddress, ibytes_file));
+        const ssize_t bytes_read = pread(idescriptor_file, bytes_block.data(), icount, static_cast<off_t>(iaddress));
+        for (ssize_t n = 0; n < bytes_read; ++n) hash = (hash ^ bytes_block[n]) * 1099511628211ull;
+    };
+    function_hash_range(0, kbytes_sidecar_hash_edge);
+    for (uint64_t block = 1; block <= 64; ++block) function_hash_range(ibytes_file / 65 * block, 4096);
+    function_hash_range(ibytes_file - std::min(ibytes_file, kbytes_sidecar_hash_edge), kbytes_sidecar_hash_edge);
+    return hash;
+}
+
+// The header the current source, format and resampler would have
+bool function_sidecar_expected(const std::string& iname_file, const struct_wav_format& iformat, struct_sidecar_header& oheader) {
+    int descriptor_file = open(iname_file.c_str(), O_RDONLY);
+    if (descriptor_file < 0) return false;
+    struct stat status_file{};
+    fstat(descriptor_file, &status_file);
+
+    oheader = struct_sidecar_header{};
+    std::memcpy(oheader.magic, kmagic_sidecar, sizeof(kmagic_sidecar));
+    oheader.version = kversion_sidecar;
+    oheader.channels = iformat.channels_file;
+    oheader.bytes_source = static_cast<uint64_t>(status_file.st_size);
+#ifdef __APPLE__
+    oheader.mtime_source_ns = static_cast<int64_t>(status_file.st_mtimespec.tv_sec) * 1000000000 + status_file.st_mtimespec.tv_nsec;
+#else
+    oheader.mtime_source_ns = static_cast<int64_t>(status_file.st_mtim.tv_sec) * 1000000000 + status_file.st_mtim.tv_nsec;
+#endif
+    oheader.hash_source = function_sidecar_hash(descriptor_file, oheader.bytes_source);
+    close(descriptor_file);
+    oheader.rate_source = iformat.rate_samples;
+    oheader.phases_resample = global_Resampler.phases;
+    oheader.step_resample = global_Resampler.step_source;
+    oheader.taps_resample = global_Resampler.taps;
+    return true;
+}
+
+// Map a valid sidecar as the resident source; false (and nothing loaded) on any mismatch
+bool function_sidecar_load(const std::string& iname_file, const struct_wav_format& iformat) {
+    auto time_start = std::chrono::steady_clock::now();
+    struct_sidecar_header header_expected;
+    if (!function_sidecar_expected(iname_file, iformat, header_expected)) return false;
+
+    const std::string name_sidecar = function_sidecar_name(iname_file);
+    int descriptor_sidecar = open(name_sidecar.c_str(), O_RDONLY);
+    if (descriptor_sidecar < 0) return false;
+    struct stat status_sidecar{};
+    fstat(descriptor_sidecar, &status_sidecar);
+    struct_sidecar_header header{};
+    const bool status_header = pread(descriptor_sidecar, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+    const uint64_t bytes_sidecar = static_cast<uint64_t>(status_sidecar.st_size);
+    const bool status_valid = status_header &&
+        std::memcmp(header.magic, header_expected.magic, sizeof(header.magic)) == 0 &&
+        header.version == header_expected.version && header.channels == header_expected.channels &&
+        header.bytes_source == header_expected.bytes_source && header.mtime_source_ns == header_expected.mtime_source_ns &&
+        header.hash_source == header_expected.hash_source && header.rate_source == header_expected.rate_source &&
+        header.phases_resample == header_expected.phases_resample && header.step_resample == header_expected.step_resample &&
+        header.taps_resample == header_expected.taps_resample &&
+        header.bytes_stride_channel >= static_cast<uint64_t>(header.frames_total) * sizeof(float) &&
+        bytes_sidecar >= kbytes_sidecar_align + header.bytes_stride_channel * header.channels;
+    void* address_mapping = status_valid
+        ? mmap(nullptr, bytes_sidecar, PROT_READ, MAP_PRIVATE, descriptor_sidecar, 0)
+        : MAP_FAILED;
+    close(descriptor_sidecar);
+    if (address_mapping == MAP_FAILED) {
+        if (status_header) std::cout << "Sidecar " << name_sidecar << " is stale; rebuilding it.\n";
+        return false;
+    }
+    const bool status_locked = function_mapping_prefault(address_mapping, bytes_sidecar);   // Fault the channels in ahead of the callback
+
+    function_source_release();
+    global_AudioFileData.source_streaming = false;
+    global_AudioFileData.format_file = iformat;
+    global_AudioFileData.address_mapping = address_mapping;
+    global_AudioFileData.bytes_mapping = bytes_sidecar;
+    global_AudioFileData.channels_file = static_cast<uint16_t>(header.channels);
+    global_AudioFileData.frames_total = header.frames_total;
+    global_AudioFileData.file_is_ieee_float = (iformat.format_tag == kwave_format_ieee_float);
+    global_AudioFileData.samples.assign(header.channels, nullptr);
+    for (uint32_t ch = 0; ch < header.channels; ++ch) {
+        global_AudioFileData.samples[ch] = reinterpret_cast<const float*>(static_cast<const char*>(address_mapping)
+                                         + kbytes_sidecar_align + ch * header.bytes_stride_channel);
+    }
+
+    auto time_end = std::chrono::steady_clock::now();
+    std::cout << "Source loaded: " << header.frames_total << " frames x " << header.channels << " channels (mapped from "
+              << name_sidecar << (status_locked ? ", locked" : ", prefaulted") << ") in " << std::chrono::duration<double, std::milli>(time_end - time_start).count() << " ms\n";
+    return true;
+}
+
+// Write the resident planar source as the sidecar for iname_file
+bool function_sidecar_write(const std::string& iname_file, const struct_wav_format& iformat) {
+    struct_sidecar_header header;
+    if (!function_sidecar_expected(iname_file, iformat, header)) return false;
+    header.frames_total = global_AudioFileData.frames_total;
+    const uint64_t bytes_channel = static_cast<uint64_t>(header.frames_total) * sizeof(float);
+    header.bytes_stride_channel = (bytes_channel + kbytes_sidecar_align - 1) / kbytes_sidecar_align * kbytes_sidecar_align;
+
+    const std::string name_sidecar = function_sidecar_name(iname_file);
+    const std::string name_temporary = name_sidecar + ".tmp";
+    const size_t index_separator = name_sidecar.find_last_of('/');
+    const std::string name_directory = (index_separator == std::string::npos) ? std::string(".")
+                                     : (index_separator == 0) ? std::string("/") : name_sidecar.substr(0, index_separator);
+    if (access(name_directory.c_str(), W_OK) != 0) {
+        std::cout << "Sidecar skipped: " << name_directory << " is not writable.\n";
+        return false;
+    }
+    {
+        std::ofstream file_out(name_temporary, std::ios::binary | std::ios::trunc);
+        std::vector<char> bytes_padding(kbytes_sidecar_align, 0);
+        file_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file_out.write(bytes_padding.data(), static_cast<std::streamsize>(kbytes_sidecar_align - sizeof(header)));
+        for (uint32_t ch = 0; ch < header.channels && file_out; ++ch) {
+            file_out.write(reinterpret_cast<const char*>(global_AudioFileData.samples[ch]), static_cast<std::streamsize>(bytes_channel));
+            file_out.write(bytes_padding.data(), static_cast<std::streamsize>(header.bytes_stride_channel - bytes_channel));
+        }
+        if (!file_out) {
+            std::cerr << "Could not write sidecar " << name_temporary << ".\n";
+            file_out.close();
+            std::remove(name_temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(name_temporary.c_str(), name_sidecar.c_str()) != 0) {
+        std::remove(name_temporary.c_str());
+        return false;
+    }
+    std::cout << "Sidecar written: " << name_sidecar << "\n";
+    return true;
+}
+
+// =============================================================================
+// STREAMING SOURCE WITH BACKGROUND PREFETCH
+// =============================================================================
+
+/**
+ * DISK-BACKED WINDOW CACHE
+ *
+ * Sources whose planar float size exceeds g_bytes_resident_limit are not
+ * decoded into RAM (the source bank leaves them out). The limit defaults to
+ * a quarter of physical memory and is set with --resident-limit. A reader thread keeps a window of fixed-size pages around
+ * the play head resident instead:
+ * • Page p lives in slot p % kcount_stream_pages (direct-mapped), planar per channel
+ * • A slot's tag holds its resident page number, or -1 while it is refilled;
+ *   the reader thread is the only writer
+ * • The window starts kpages_stream_behind pages before the play head (grains
+ *   spawned earlier and negative jitter reach back) and fills the rest of the
+ *   cache ahead of it, nearest pages first
+ * • The callback copies a grain's span out of the pages and re-checks the tag
+ *   afterwards (seqlock style). Frames that were not resident play as silence
+ *   and are counted as underruns, which the reader thread reports
+ */
+constexpr uint32_t kframes_stream_page = 16384;
+constexpr uint32_t kcount_stream_pages = 64;          // ~22 s window at 48 kHz
+constexpr uint32_t kpages_stream_behind = 2;          // Covers the longest grain plus maximum jitter
+constexpr uint64_t kbytes_resident_fallback = 2ull << 30;   // When physical memory cannot be queried
+
+uint64_t function_resident_limit_default() {
+    const long count_pages = sysconf(_SC_PHYS_PAGES);
+    const long bytes_page = sysconf(_SC_PAGESIZE);
+    if (count_pages <= 0 || bytes_page <= 0) return kbytes_resident_fallback;
+    return static_cast<uint64_t>(count_pages) * static_cast<uint64_t>(bytes_page) / 4;
+}
+
+uint64_t g_bytes_resident_limit = function_resident_limit_default();   // Larger sources stream from disk
+
+struct struct_stream_cache {
+    std::vector<float> frames_cache;                              // [slot][channel][frame] planar pages
+    std::atomic<int64_t> garray_tag_page[kcount_stream_pages];    // Resident page per slot, -1 = empty or refilling
+    std::atomic<uint32_t> frame_head{0};                          // Play head published by the callback
+    std::atomic<uint64_t> count_underrun_frames{0};               // Frames requested while not resident
+    std::atomic<bool> status_reader_run{false};
+    std::thread thread_reader;
+    int descriptor_file = -1;
+    uint64_t address_data = 0;                                    // File offset of the first audio frame
+    uint16_t bits_sample = 16;
+    uint32_t frames_source = 0;                                   // File-rate frames in the data chunk
+    uint32_t frames_span_source = 0;                              // Most file frames one resampled page reads
+    std::vector<unsigned char> bytes_staging;                     // Reader-owned interleaved page buffer
+    std::vector<float*> destination_page;                         // Reader-owned per-channel page pointers
+    std::vector<float> scratch_decode;                            // Reader-owned interleaved float block
+    std::vector<float> frames_source_page;                        // Reader-owned file-rate planar span (resampling only)
+    struct_sample_decoder decoder{};
+};
+
+struct_stream_cache global_StreamCache;
+
+inline float* function_stream_page_channel(uint32_t islot, uint16_t ichannel) {
+    return global_StreamCache.frames_cache.data()
+         + (static_cast<size_t>(islot) * global_AudioFileData.channels_file + ichannel) * kframes_stream_page;
+}
+
+// Reader thread only: read and convert one page into its slot, then publish it.
+// Pages are in engine-rate frames; a resampled page decodes the file span its taps cover first.
+bool function_stream_load_page(int64_t ipage) {
+    struct_stream_cache& cache = global_StreamCache;
+    const struct_resampler& resampler = global_Resampler;
+    const uint32_t slot = static_cast<uint32_t>(ipage % kcount_stream_pages);
+    const uint16_t channels = global_AudioFileData.channels_file;
+    const uint32_t bytes_frame = channels * (cache.bits_sample / 8u);
+    const uint32_t frame_first = static_cast<uint32_t>(ipage) * kframes_stream_page;
+    const uint32_t count_frames = std::min(kframes_stream_page, global_AudioFileData.frames_total - frame_first);
+
+    int64_t source_first = frame_first;
+    int64_t source_end = static_cast<int64_t>(frame_first) + count_frames;
+    if (!resampler.is_identity) {
+        const int64_t taps_before = resampler.taps / 2 - 1;
+        source_first = std::max<int64_t>(0, static_cast<int64_t>(static_cast<uint64_t>(frame_first) * resampler.step_source / resampler.phases) - taps_before);
+        source_end = std::min<int64_t>(cache.frames_source,
+            static_cast<int64_t>(static_cast<uint64_t>(frame_first + count_frames - 1) * resampler.step_source / resampler.phases) + taps_before + 2);
+    }
+    const uint32_t count_source = static_cast<uint32_t>(source_end - source_first);
+    const size_t bytes_page = static_cast<size_t>(count_source) * bytes_frame;
+    const ssize_t bytes_read = pread(cache.descriptor_file, cache.bytes_staging.data(), bytes_page,
+                                     static_cast<off_t>(cache.address_data + static_cast<uint64_t>(source_first) * bytes_frame));
+    if (bytes_read != static_cast<ssize_t>(bytes_page)) return false;
+    if (!resampler.is_identity) {
+        for (uint16_t ch = 0; ch < channels; ++ch) {
+            cache.destination_page[ch] = cache.frames_source_page.data() + static_cast<size_t>(ch) * cache.frames_span_source;
+        }
+        function_decode_block(cache.decoder, cache.bytes_staging.data(), channels, count_source,
+                              cache.scratch_decode.data(), cache.destination_page.data());
+    }
+
+    cache.garray_tag_page[slot].store(-1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if (resampler.is_identity) {
+        for (uint16_t ch = 0; ch < channels; ++ch) cache.destination_page[ch] = function_stream_page_channel(slot, ch);
+        function_decode_block(cache.decoder, cache.bytes_staging.data(), channels, count_frames,
+                              cache.scratch_decode.data(), cache.destination_page.data());
+    } else {
+        for (uint16_t ch = 0; ch < channels; ++ch) {
+            function_resample_span(resampler, cache.destination_page[ch], source_first, count_source,
+                                   frame_first, count_frames, function_stream_page_channel(slot, ch));
+        }
+    }
+    cache.garray_tag_page[slot].store(ipage, std::memory_order_release);
+    return true;
+}
+
+// Next page the window is missing (nearest the play head first), or -1
+int64_t function_stream_page_missing() {
+    const int64_t page_last_file = (static_cast<int64_t>(global_AudioFileData.frames_total) - 1) / kframes_stream_page;
+    const int64_t page_head = global_StreamCache.frame_head.load(std::memory_order_relaxed) / kframes_stream_page;
+    const int64_t page_first = std::max<int64_t>(0, page_head - kpages_stream_behind);
+    const int64_t page_last = std::min<int64_t>(page_first + kcount_stream_pages - 1, page_last_file);
+
+    auto function_missing = [](int64_t ipage) {
+        return global_StreamCache.garray_tag_page[ipage % kcount_stream_pages].load(std::memory_order_relaxed) != ipage;
+    };
+    for (int64_t page = page_head; page <= page_last; ++page) if (function_missing(page)) return page;
+    for (int64_t page = page_head - 1; page >= page_first; --page) if (function_missing(page)) return page;
+    return -1;
+}
+
+void function_stream_reader() {
+    uint64_t count_underrun_reported = 0;
+    while (global_StreamCache.status_reader_run.load()) {
+        const int64_t page = function_stream_page_missing();
+        if (page < 0 || !function_stream_load_page(page)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+
+        const uint64_t count_underrun = global_StreamCache.count_underrun_frames.load(std::memory_order_relaxed);
+        if (count_underrun != count_underrun_reported) {
+            std::cout << "Stream underrun: " << (count_underrun - count_underrun_reported)
+                      << " frames not resident (" << count_underrun << " total)\n";
+            count_underrun_reported = count_underrun;
+        }
+    }
+}
+
+void function_stream_close() {
+    struct_stream_cache& cache = global_StreamCache;
+    if (cache.status_reader_run.exchange(false)) cache.thread_reader.join();
+    if (cache.descriptor_file >= 0) {
+        close(cache.descriptor_file);
+        cache.descriptor_file = -1;
+    }
+    std::vector<float>().swap(cache.frames_cache);
+    global_AudioFileData.source_streaming = false;
+}
+
+bool function_stream_open(const std::string& iname_file, const struct_wav_format& iformat) {
+    function_stream_close();
+    function_source_release();
+    struct_stream_cache& cache = global_StreamCache;
+    global_AudioFileData.format_file = iformat;
+
+    const uint64_t address_data = iformat.address_data;
+    const uint16_t channels = iformat.channels_file;
+    const uint16_t bits_sample = iformat.bits_sample;
+    if (!function_decoder_select(iformat, cache.decoder) || channels == 0) {
+        std::cerr << "Unsupported sample format: " << bits_sample << "-bit "
+                  << ((iformat.format_tag == kwave_format_ieee_float) ? "float" : "PCM") << "\n";
+        return false;
+    }
+
+    cache.descriptor_file = open(iname_file.c_str(), O_RDONLY);
+    if (cache.descriptor_file < 0) {
+        std::cerr << "Could not open " << iname_file << " for streaming.\n";
+        return false;
+    }
+    struct stat status_file{};
+    fstat(cache.descriptor_file, &status_file);
+    const uint64_t bytes_available = (static_cast<uint64_t>(status_file.st_size) > address_data)
+        ? static_cast<uint64_t>(status_file.st_size) - address_data : 0;
+    const uint32_t bytes_frame = channels * (bits_sample / 8u);
+
+    // The cache holds engine-rate frames; pages of a resampled source read a slightly wider file span
+    const struct_resampler& resampler = global_Resampler;
+    const uint64_t frames_source = std::min(iformat.bytes_data, bytes_available) / bytes_frame;
+    const uint64_t frames_engine = function_resample_frames(resampler, frames_source);
+    if (frames_engine > std::numeric_limits<uint32_t>::max()) {
+        std::cerr << "Source too long to stream: " << frames_engine << " frames at the engine rate.\n";
+        function_stream_close();
+        return false;
+    }
+    cache.frames_source = static_cast<uint32_t>(frames_source);
+    cache.frames_span_source = resampler.is_identity ? kframes_stream_page
+        : static_cast<uint32_t>(static_cast<uint64_t>(kframes_stream_page) * resampler.step_source / resampler.phases) + resampler.taps + 2;
+
+    global_AudioFileData.channels_file = channels;
+    global_AudioFileData.frames_total = static_cast<uint32_t>(frames_engine);
+    global_AudioFileData.file_is_ieee_float = (iformat.format_tag == kwave_format_ieee_float);
+    global_AudioFileData.source_streaming = true;
+    global_AudioFileData.samples.assign(channels, nullptr);   // No resident channels: reads go through the cache
+
+    cache.address_data = address_data;
+    cache.bits_sample = bits_sample;
+    cache.frames_cache.assign(static_cast<size_t>(kcount_stream_pages) * channels * kframes_stream_page, 0.0f);
+    cache.bytes_staging.assign(static_cast<size_t>(cache.frames_span_source) * bytes_frame, 0);
+    cache.frames_source_page.assign(resampler.is_identity ? 0 : static_cast<size_t>(cache.frames_span_source) * channels, 0.0f);
+    cache.destination_page.assign(channels, nullptr);
+    cache.scratch_decode.assign(static_cast<size_t>(kframes_decode_block) * channels, 0.0f);
+    for (auto& tag_page : cache.garray_tag_page) tag_page.store(-1);
+    cache.frame_head.store(0);
+    cache.count_underrun_frames.store(0);
+
+    // Prime the whole window before playback so the first blocks never underrun
+    auto time_start = std::chrono::steady_clock::now();
+    for (int64_t page = function_stream_page_missing(); page >= 0; page = function_stream_page_missing()) {
+        if (!function_stream_load_page(page)) {
+            std::cerr << "Could not read page " << page << " of " << iname_file << ".\n";
+            function_stream_close();
+            return false;
+        }
+    }
+    auto time_end = std::chrono::steady_clock::now();
+
+    cache.status_reader_run.store(true);
+    cache.thread_reader = std::thread(function_stream_reader);
+
+    std::cout << "Streaming source: " << global_AudioFileData.frames_total << " frames x " << channels << " channels, "
+              << kcount_stream_pages << " x " << kframes_stream_page << "-frame window ("
+              << (cache.frames_cache.size() * sizeof(float) / (1024.0 * 1024.0)) << " MB) primed in "
+              << std::chrono::duration<double, std::milli>(time_end - time_start).count() << " ms\n";
+    return true;
+}
+
+// Open a parsed file as the engine source at the engine rate: resident (mapped from a valid
+// sidecar, or decoded and resampled, then cached) or, when its planar size exceeds
+// g_bytes_resident_limit, streaming
+bool function_source_open(const std::string& iname_file, const struct_wav_format& iformat) {
+    const uint64_t frames_engine = function_resample_frames(global_Resampler, iformat.bytes_data / iformat.bytes_block);
+    const uint64_t bytes_planar = frames_engine * iformat.channels_file * sizeof(float);
+    if (bytes_planar > g_bytes_resident_limit) return function_stream_open(iname_file, iformat);
+    if (g_status_sidecar && function_sidecar_load(iname_file, iformat)) return true;
+    if (!function_source_load_mapped(iname_file, iformat) || !function_source_resample()) return false;
+
+    // Mono float at the engine rate is already used in place; there is nothing to cache
+    if (g_status_sidecar && !global_AudioFileData.frames_planar.empty()) function_sidecar_write(iname_file, iformat);
+    return true;
+}
+
+// Audio thread: copy frames of one channel out of the window cache; missing frames are silent
+const float* function_stream_copy(uint16_t ichannel, uint32_t iframe_first, uint32_t icount_frames, float* oscratch) {
+    uint32_t count_copied = 0;
+    while (count_copied < icount_frames) {
+        const uint32_t frame = iframe_first + count_copied;
+        const int64_t page = frame / kframes_stream_page;
+        const uint32_t slot = static_cast<uint32_t>(page % kcount_stream_pages);
+        const uint32_t offset_page = frame % kframes_stream_page;
+        const uint32_t count_segment = std::min(kframes_stream_page - offset_page, icount_frames - count_copied);
+
+        bool status_resident = global_StreamCache.garray_tag_page[slot].load(std::memory_order_acquire) == page;
+        if (status_resident) {
+            std::memcpy(oscratch + count_copied, function_stream_page_channel(slot, ichannel) + offset_page,
+                        count_segment * sizeof(float));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            status_resident = global_StreamCache.garray_tag_page[slot].load(std::memory_order_relaxed) == page;
+        }
+        if (!status_resident) {
+            std::fill_n(oscratch + count_copied, count_segment, 0.0f);
+            global_StreamCache.count_underrun_frames.fetch_add(count_segment, std::memory_order_relaxed);
+        }
+        count_copied += count_segment;
+    }
+    return oscratch;
+}
+
+/**
+ * Contiguous view of source frames [iframe_first, iframe_first + icount_frames)
+ * of one channel: the resident buffer itself, or a copy out of the window
+ * cache into oscratch when streaming.
+ */
+inline const float* function_source_span(uint16_t ichannel, uint32_t iframe_first, uint32_t icount_frames, float* oscratch) {
+    if (!global_AudioFileData.source_streaming) return global_AudioFileData.samples[ichannel] + iframe_first;
+    return function_stream_copy(ichannel, iframe_first, icount_frames, oscratch);
+}
+
+// =============================================================================
+// SOURCE BANK
+// =============================================================================
+
+// The bank index (struct_source_bank) is declared with the grain pool, which
+// stores a source ID per grain
+
+void function_source_bank_release() {
+    std::free(global_SourceBank.arena);
+    global_SourceBank.arena = nullptr;
+    global_SourceBank.floats_arena = 0;
+    global_SourceBank.count_sources = 1;
+    g_source_selection.store(0);
+}
+
+/**
+ * Load every file in inames into the arena at the engine rate. Files that
+ * cannot be parsed or decoded, or that would stream, are left out with a
+ * note. Each file goes through the normal resident pipeline (sidecar, decode,
+ * resample) via global_AudioFileData and is copied into its slice, so this
+ * runs before the primary source is opened.
+ */
+bool function_source_bank_load(const std::vector<std::string>& inames, uint32_t irate_engine) {
+    auto time_start = std::chrono::steady_clock::now();
+    function_source_bank_release();
+    struct_source_bank& bank = global_SourceBank;
+    const size_t kfloats_align = kbytes_arena_align / sizeof(float);
+
+    // Pass 1: parse every file and lay out the arena
+    std::vector<struct_wav_format> formats_bank;
+    std::vector<std::string> names_bank;
+    size_t floats_arena = 0;
+    for (const std::string& name_file : inames) {
+        if (bank.count_sources + formats_bank.size() >= kcount_sources_max) {
+            std::cout << "Source bank is full (" << kcount_sources_max << " sources); leaving out " << name_file << ".\n";
+            continue;
+        }
+        struct_wav_format format_file;
+        if (!function_wav_parse(name_file, format_file) || format_file.channels_file > 16) {
+            std::cout << "Leaving " << name_file << " out of the source bank.\n";
+            continue;
+        }
+        struct_resampler resampler;
+        function_resampler_prepare(format_file.rate_samples, irate_engine, g_resample_quality, resampler);
+        const uint64_t frames_engine = function_resample_frames(resampler, format_file.bytes_data / format_file.bytes_block);
+        const uint64_t stride_channel = (frames_engine + kfloats_align - 1) / kfloats_align * kfloats_align;
+        if (stride_channel * format_file.channels_file * sizeof(float) > g_bytes_resident_limit) {
+            std::cout << name_file << " is too large to hold in the source bank; leaving it out.\n";
+            continue;
+        }
+        floats_arena += stride_channel * format_file.channels_file;
+        formats_bank.push_back(format_file);
+        names_bank.push_back(name_file);
+    }
+    if (formats_bank.empty()) return inames.empty();
+
+    void* address_arena = nullptr;
+    if (posix_memalign(&address_arena, kbytes_arena_align, floats_arena * sizeof(float)) != 0) {
+        std::cerr << "Could not allocate the " << (floats_arena * sizeof(float) / (1024.0 * 1024.0)) << " MB source bank.\n";
+        return false;
+    }
+    bank.arena = static_cast<float*>(address_arena);
+    bank.floats_arena = floats_arena;
+
+    // Pass 2: decode each file through the resident pipeline and copy it into its slice
+    uint64_t offset_next = 0;
+    for (size_t index_file = 0; index_file < formats_bank.size(); ++index_file) {
+        const struct_wav_format& format_file = formats_bank[index_file];
+        function_resampler_prepare(format_file.rate_samples, irate_engine, g_resample_quality, global_Resampler);
+        const uint64_t frames_engine = function_resample_frames(global_Resampler, format_file.bytes_data / format_file.bytes_block);
+        const uint64_t stride_channel = (frames_engine + kfloats_align - 1) / kfloats_align * kfloats_align;
+        if (!function_source_open(names_bank[index_file], format_file) || global_AudioFileData.frames_total == 0) {
+            std::cout << "Leaving " << names_bank[index_file] << " out of the source bank.\n";
+            function_source_release();
+            continue;
+        }
+
+        const uint32_t id_source = bank.count_sources;
+        const uint32_t frames_loaded = global_AudioFileData.frames_total;   // Truncated data chunks yield fewer frames
+        bank.offset_source[id_source] = offset_next;
+        bank.stride_channel[id_source] = stride_channel;
+        bank.frames_source[id_source] = frames_loaded;
+        bank.channels_source[id_source] = format_file.channels_file;
+        bank.name_source[id_source] = names_bank[index_file];
+        for (uint16_t ch = 0; ch < format_file.channels_file; ++ch) {
+            float* destination = bank.arena + offset_next + ch * stride_channel;
+            std::memcpy(destination, global_AudioFileData.samples[ch], frames_loaded * sizeof(float));
+            std::fill(destination + frames_loaded, destination + stride_channel, 0.0f);
+        }
+        offset_next += stride_channel * format_file.channels_file;
+        bank.count_sources = id_source + 1;
+        function_source_release();
+    }
+    global_Resampler = struct_resampler{};
+
+    auto time_end = std::chrono::steady_clock::now();
+    std::cout << "Source bank: " << (bank.count_sources - 1) << " files in a "
+              << (bank.floats_arena * sizeof(float) / (1024.0 * 1024.0)) << " MB arena, loaded in "
+              << std::chrono::duration<double, std::milli>(time_end - time_start).count() << " ms\n";
+    for (uint32_t id_source = 1; id_source < bank.count_sources; ++id_source) {
+        std::cout << "  " << id_source << ". " << bank.name_source[id_source] << ": " << bank.channels_source[id_source]
+                  << " ch x " << bank.frames_source[id_source] << " frames at float " << bank.offset_source[id_source] << "\n";
+    }
+    return true;
+}
+
+// Engine-rate frames and channel count of a bank source
+inline uint32_t function_bank_frames(uint16_t isource) {
+    return isource ? global_SourceBank.frames_source[isource] : global_AudioFileData.frames_total;
+}
+
+inline uint16_t function_bank_channels(uint16_t isource) {
+    return isource ? global_SourceBank.channels_source[isource] : global_AudioFileData.channels_file;
+}
+
+// Contiguous view of frames of one channel of a bank source (see function_source_span)
+inline const float* function_bank_span(uint16_t isource, uint16_t ichannel, uint32_t iframe_first, uint32_t icount_frames, float* oscratch) {
+    if (isource == 0) return function_source_span(ichannel, iframe_first, icount_frames, oscratch);
+    return global_SourceBank.arena + global_SourceBank.offset_source[isource]
+         + ichannel * global_SourceBank.stride_channel[isource] + iframe_first;
+}
+
+void initialize_grain(uint32_t      islot_grain,
+                      uint32_t      iaddress_start_frame,
+                      uint32_t      iframes_grain, 
+                      float         igain_grain = 1.0f,
+                      uint32_t      iframes_delay_onset = 0,
+                      float         irate_grain = 1.0f,
+                      uint16_t      isource_grain = 0) { 
+
+    struct_grain_pool& pool = global_ProcessGrain.pool_grains;
+
+    pool.address_start_frame[islot_grain]     = iaddress_start_frame;
+    pool.address_present_grain[islot_grain]   = 0;
+    pool.frames_grain[islot_grain]            = iframes_grain;
+    pool.frames_delay_onset[islot_grain]      = iframes_delay_onset;
+    pool.rate_grain[islot_grain]              = irate_grain;
+    pool.source_grain[islot_grain]            = isource_grain;
+    
+
+ 
+
+ 
+    if (g_use_grain_hopping && !g_grain_sequence.empty()) {
+     
+        pool.target_object[islot_grain] = g_grain_sequence[g_sequence_position];
+     
+        g_sequence_position = (g_sequence_position + 1) % g_grain_sequence.size();
+    } else {
+     
+        pool.target_object[islot_grain] = -2;
+    } 
+    pool.gain_grain[islot_grain]              = igain_grain; 
+
+    // Reference the published shared table; no per-grain copy
+    pool.envelope_grain[islot_grain]          = g_envelope_active.load(std::memory_order_acquire);
+    pool.gain_normalized_grain[islot_grain]   = igain_grain *
+        function_grain_normalization(iframes_grain, global_ProcessGrain.frames_interval_normalization,
+                                     pool.envelope_grain[islot_grain]->envelope_rms);
+    pool.phase_envelope_grain[islot_grain]    = 0;
+    pool.increment_envelope_grain[islot_grain] = function_envelope_increment(iframes_grain);
+    
+    pool.status_callback_grain[islot_grain] = true; 
+}
+
+/**
+ * ADVANCED GRANULAR SYNTHESIS GRAIN GENERATION ENGINE
+ * 
+ * This function represents the core intelligence of the granular synthesis system,
+ * implementing sophisticated algorithms for creating new grains with randomized
+ * parameters. It demonstrates advanced understanding of:
+ * 
+ * • High-quality random number generation using industry standards
+ * • Real-time memory management with object pooling
+ * • Mathematical parameter randomization for organic texture
+ * • Performance optimization for audio-rate processing
+ * 
+ * TECHNICAL SOPHISTICATION:
+ * - Uses Mersenne Twister algorithm for superior random distribution
+ * - Implements thread-local storage for multi-threading safety
+ * - Applies jitter and scaling for natural, non-mechanical sound
+ * - Manages grain density through intelligent load balancing
+ */
+void function_process_grain(uint32_t ioffset_onset = 0) {
+    // Object Pool Pattern: pop a free slot, bounded by the runtime polyphony limit
+    uint32_t new_grain = function_grain_acquire();
+    if (new_grain == kslot_none_grain) {
+        return;  // System at capacity - skip grain creation this cycle
+    }
+
+    /**
+     * ADVANCED RANDOM NUMBER GENERATION SYSTEM
+     * 
+     * Implements the Mersenne Twister algorithm, which one standard
+     * for pseudo-random number generation in professional applications.
+     * 
+     * TECHNICAL DETAILS:
+     * • g_rng_grain: one generator, only ever drawn from the audio thread
+     * • std::random_device: Hardware entropy source for seeding, unless an
+     *   offline render fixes the seed so the same cloud renders every time
+     * • std::mt19937: 32-bit Mersenne Twister with 19937-bit period
+     * 
+     * This approach ensures less-than predictable randomization while maintaining
+     * excellent performance in real-time audio processing.
+     */
+    std::mt19937& rng = g_rng_grain;
+
+    /**
+     * STATISTICAL DISTRIBUTION CONFIGURATION
+     * 
+     * These distributions control the randomization parameters that give
+     * granular synthesis its characteristic organic, non-mechanical texture.
+     */
+    
+    // Temporal Jitter: Randomizes grain start timing to prevent mechanical regularity
+    std::uniform_int_distribution<int> jitterDist(-g_jitter_range, g_jitter_range);
+    
+    // Pitch/Speed Variation: Creates subtle pitch variations for organic texture
+    // This scaling factor affects both playback speed and resulting pitch:
+    // a grain stretched by s plays the same source material at rate 1/s
+    std::uniform_real_distribution<float> scaleDist(g_travel_factor_min, g_travel_factor_max);
+
+    // base_frames_grain is the original grain length
+    const uint32_t base_frames_grain = global_ProcessGrain.frames_object_grain;
+
+    // Bank source this grain reads: the selected one, or any of them at random
+    const int selection_source = g_source_selection.load(std::memory_order_relaxed);
+    uint16_t field_source_grain = 0;
+    if (selection_source == ksource_random) {
+        field_source_grain = static_cast<uint16_t>(std::uniform_int_distribution<uint32_t>(0, global_SourceBank.count_sources - 1)(rng));
+    } else if (selection_source > 0 && static_cast<uint32_t>(selection_source) < global_SourceBank.count_sources) {
+        field_source_grain = static_cast<uint16_t>(selection_source);
+    }
+    const uint32_t frames_source_total = function_bank_frames(field_source_grain);
+
+    // start_raw is the starting frame of the grain (the play head at the grain's onset inside this block,
+    // at the same relative position in a bank source)
+    int64_t head_source = static_cast<int64_t>(global_AudioFileData.present_frame) + ioffset_onset;
+    if (field_source_grain != 0 && global_AudioFileData.frames_total > 0) {
+        head_source = head_source * frames_source_total / global_AudioFileData.frames_total;
+    }
+    int64_t start_raw = head_source + jitterDist(rng); // rng is mt
+    if (start_raw < 0) start_raw = 0;
+    if (start_raw > static_cast<int64_t>(frames_source_total - 1)) {
+        start_raw = static_cast<int64_t>(frames_source_total - 1);
+    }
 
-        double N_eff = std::max(1.0, rho);
-        constexpr float kTargetRMS = 0.2f; 
+    // field_start_frame is the new starting frame of the grain
+    uint32_t field_start_frame = static_cast<uint32_t>(start_raw);
 
-        float gain_norm = kTargetRMS/(g_envelope_rms*std::sqrt(N_eff));
-        float grain_base_gain = element_grain.gain_grain*gain_norm; 
+    // field_frames_grain is the new length of the grain, field_rate_grain its playback rate (pitch)
+    // The travel edits ('p', --travel) keep the factor at or above 1 / krate_grain_max; clamping the
+    // factor rather than the rate keeps length and pitch consistent if a caller sets it lower
+    const float field_scale_grain = std::max(scaleDist(rng), 1.0f / krate_grain_max); // rng is mt
+    const float field_rate_grain = 1.0f / field_scale_grain;
+    uint32_t field_frames_grain = static_cast<uint32_t>(base_frames_grain * field_scale_grain);
+    if (field_frames_grain < 64u) field_frames_grain = 64u;
 
-        uint32_t frames_grain_process = std::min<uint32_t>(icount_frames, frames_grain_ahead);
+    // if the source frames this grain will read run past the total frames of the audio file
+    const uint32_t frames_source_left = frames_source_total - field_start_frame;
+    if (static_cast<double>(field_frames_grain) * field_rate_grain > frames_source_left) {
+        // cut the grain the whatever is left from the audio
+        field_frames_grain = static_cast<uint32_t>(frames_source_left / field_rate_grain);
+    }
+
+    float    field_gain_grain = 1.0f;
+
+    initialize_grain(new_grain, field_start_frame, field_frames_grain, field_gain_grain, ioffset_onset, field_rate_grain,
+                     field_source_grain);
+}
+
+// =============================================================================
+// SIMD GRAIN ACCUMULATION KERNELS
+// =============================================================================
+
+/**
+ * GRAIN ACCUMULATION KERNEL WITH RUNTIME ISA DISPATCH
+ *
+ * Every grain contributes mix[n] += source[n] * weight[n] over a contiguous run
+ * of frames, where weight[n] = envelope[n] * grain gain. The kernel is compiled
+ * in several variants and the widest one the CPU supports is chosen once at
+ * startup (function_kernel_select):
+ *
+ * • AVX-512F: 16 frames per step      • AVX2: 8 frames per step
+ * • SSE2 / NEON: 4 frames per step    • Scalar: reference variant
+ *
+ * BIT COMPATIBILITY:
+ * All variants perform the same two IEEE operations per frame (one multiply,
+ * then one add) with no fused multiply-add, so every variant produces exactly
+ * the scalar reference's result. The scalar variant stays in the build for the
+ * benchmark's verification pass. Contraction into FMA is disabled for every
+ * variant (GRANULAR_FP_STRICT), since compilers may otherwise fuse even the
+ * intrinsic multiply and add.
+ */
+typedef void (*function_kernel_accumulate_t)(float* iomix, const float* isource, const float* iweight, uint32_t icount_frames);
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define GRANULAR_FP_STRICT __attribute__((optimize("fp-contract=off")))
+#else
+#define GRANULAR_FP_STRICT
+#endif
+
+GRANULAR_FP_STRICT
+void function_kernel_accumulate_scalar(float* iomix, const float* isource, const float* iweight, uint32_t icount_frames) {
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#endif
+    for (uint32_t fr = 0; fr < icount_frames; ++fr) {
+        float product = isource[fr] * iweight[fr];
+        iomix[fr] = iomix[fr] + product;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2"))) GRANULAR_FP_STRICT
+void function_kernel_accumulate_sse2(float* iomix, const float* isource, const float* iweight, uint32_t icount_frames) {
+    uint32_t fr = 0;
+    for (; fr + 4 <= icount_frames; fr += 4) {
+        __m128 product = _mm_mul_ps(_mm_loadu_ps(isource + fr), _mm_loadu_ps(iweight + fr));
+        _mm_storeu_ps(iomix + fr, _mm_add_ps(_mm_loadu_ps(iomix + fr), product));
+    }
+    function_kernel_accumulate_scalar(iomix + fr, isource + fr, iweight + fr, icount_frames - fr);
+}
+
+__attribute__((target("avx2"))) GRANULAR_FP_STRICT
+void function_kernel_accumulate_avx2(float* iomix, const float* isource, const float* iweight, uint32_t icount_frames) {
+    uint32_t fr = 0;
+    for (; fr + 8 <= icount_frames; fr += 8) {
+        __m256 product = _mm256_mul_ps(_mm256_loadu_ps(isource + fr), _mm256_loadu_ps(iweight + fr));
+        _mm256_storeu_ps(iomix + fr, _mm256_add_ps(_mm256_loadu_ps(iomix + fr), product));
+    }
+    // The tail call skips the compiler's exit vzeroupper: clear the upper halves here, or the
+    // legacy-SSE tail and every caller after it pay the AVX-SSE transition penalty
+    _mm256_zeroupper();
+    function_kernel_accumulate_sse2(iomix + fr, isource + fr, iweight + fr, icount_frames - fr);
+}
+
+__attribute__((target("avx512f"))) GRANULAR_FP_STRICT
+void function_kernel_accumulate_avx512(float* iomix, const float* isource, const float* iweight, uint32_t icount_frames) {
+    uint32_t fr = 0;
+    for (; fr + 16 <= icount_frames; fr += 16) {
+        __m512 product = _mm512_mul_ps(_mm512_loadu_ps(isource + fr), _mm512_loadu_ps(iweight + fr));
+        _mm512_storeu_ps(iomix + fr, _mm512_add_ps(_mm512_loadu_ps(iomix + fr), product));
+    }
+    function_kernel_accumulate_avx2(iomix + fr, isource + fr, iweight + fr, icount_frames - fr);
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+GRANULAR_FP_STRICT
+void function_kernel_accumulate_neon(float* iomix, const float* isource, const float* iweight, uint32_t icount_frames) {
+    uint32_t fr = 0;
+    for (; fr + 4 <= icount_frames; fr += 4) {
+        float32x4_t product = vmulq_f32(vld1q_f32(isource + fr), vld1q_f32(iweight + fr));
+        vst1q_f32(iomix + fr, vaddq_f32(vld1q_f32(iomix + fr), product));
+    }
+    function_kernel_accumulate_scalar(iomix + fr, isource + fr, iweight + fr, icount_frames - fr);
+}
+#endif
+
+struct struct_kernel_dispatch {
+    const char* name_isa;                              // Instruction set of the selected variant
+    function_kernel_accumulate_t function_accumulate;  // Grain accumulation kernel
+};
+
+struct_kernel_dispatch g_kernel_dispatch = {"scalar", function_kernel_accumulate_scalar};
+
+// Pick the widest kernel the running CPU supports; call before audio starts
+void function_kernel_select() {
+    g_kernel_dispatch = {"scalar", function_kernel_accumulate_scalar};
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        g_kernel_dispatch = {"AVX-512", function_kernel_accumulate_avx512};
+    } else if (__builtin_cpu_supports("avx2")) {
+        g_kernel_dispatch = {"AVX2", function_kernel_accumulate_avx2};
+    } else if (__builtin_cpu_supports("sse2")) {
+        g_kernel_dispatch = {"SSE2", function_kernel_accumulate_sse2};
+    }
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    g_kernel_dispatch = {"NEON", function_kernel_accumulate_neon};
+#endif
+    std::cout << "Grain kernel: " << g_kernel_dispatch.name_isa << "\n";
+}
+
+// =============================================================================
+// OUTPUT FORMAT CONVERSION KERNELS
+// =============================================================================
+
+/**
+ * FORMAT-SPECIALIZED OUTPUT STAGE
+ *
+ * The planar mix bus is written to the device buffers by one of six kernels,
+ * one per sample format (float32, int16, int32) and layout (planar or
+ * interleaved). function_output_select picks the pair for the negotiated
+ * stream format once, so the callback makes a single indirect call per block
+ * with no per-sample format branches.
+ *
+ * Each kernel clamps, scales and converts a channel at a time with SSE2 on
+ * x86 or NEON on ARM, both baseline on 64-bit targets. Interleaved layouts
+ * first interleave a span of frames into a 4 KB stack block (4 x 4 SSE
+ * transposes) and then convert that block as one contiguous row, so the
+ * device buffer is written sequentially.
+ *
+ * SCALING:
+ * • float32: clamped to [-1, 1]
+ * • int16:   x 32767, rounded to nearest (even on ties), symmetric
+ * • int32:   x 2^31, limited to [-2^31, 2^31 - 128] before conversion, the
+ *   largest float below 2^31, so full scale can never wrap to INT32_MIN
+ * The SIMD and scalar paths round the same way and match bit for bit.
+ */
+constexpr uint32_t ksamples_output_chunk = 1024;      // Interleaved conversion block (4 KB of int32 on the stack)
+constexpr float kscale_output_int16 = 32767.0f;
+constexpr float kscale_output_int32 = 2147483648.0f;
+constexpr float klimit_output_int32 = 2147483520.0f;  // Largest float below 2^31
+
+typedef void (*function_output_t)(const float* imix, UInt32 ichannels, UInt32 icount_frames, AudioBufferList* oiobuffers);
+
+// Clamp, scale and convert icount floats to the device sample type
+inline void function_output_row(const float* isource, float* odestination, uint32_t icount) {
+    uint32_t n = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    const __m128 high = _mm_set1_ps(1.0f), low = _mm_set1_ps(-1.0f);
+    for (; n + 4 <= icount; n += 4) {
+        _mm_storeu_ps(odestination + n, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(isource + n), low), high));
+    }
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    const float32x4_t high = vdupq_n_f32(1.0f), low = vdupq_n_f32(-1.0f);
+    for (; n + 4 <= icount; n += 4) {
+        vst1q_f32(odestination + n, vminq_f32(vmaxq_f32(vld1q_f32(isource + n), low), high));
+    }
+#endif
+    for (; n < icount; ++n) odestination[n] = std::clamp(isource[n], -1.0f, 1.0f);
+}
+
+inline void function_output_row(const float* isource, int16_t* odestination, uint32_t icount) {
+    uint32_t n = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    const __m128 high = _mm_set1_ps(1.0f), low = _mm_set1_ps(-1.0f), scale = _mm_set1_ps(kscale_output_int16);
+    for (; n + 8 <= icount; n += 8) {
+        __m128i first = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(isource + n), low), high), scale));
+        __m128i second = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(isource + n + 4), low), high), scale));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(odestination + n), _mm_packs_epi32(first, second));
+    }
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    const float32x4_t high = vdupq_n_f32(1.0f), low = vdupq_n_f32(-1.0f);
+    for (; n + 8 <= icount; n += 8) {
+        int32x4_t first = vcvtnq_s32_f32(vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(isource + n), low), high), kscale_output_int16));
+        int32x4_t second = vcvtnq_s32_f32(vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(isource + n + 4), low), high), kscale_output_int16));
+        vst1q_s16(odestination + n, vcombine_s16(vqmovn_s32(first), vqmovn_s32(second)));
+    }
+#endif
+    for (; n < icount; ++n) {
+        odestination[n] = static_cast<int16_t>(std::lrintf(std::clamp(isource[n], -1.0f, 1.0f) * kscale_output_int16));
+    }
+}
+
+inline void function_output_row(const float* isource, int32_t* odestination, uint32_t icount) {
+    uint32_t n = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    const __m128 high = _mm_set1_ps(klimit_output_int32), low = _mm_set1_ps(-kscale_output_int32);
+    const __m128 scale = _mm_set1_ps(kscale_output_int32);
+    for (; n + 4 <= icount; n += 4) {
+        __m128 scaled = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(isource + n), scale), low), high);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(odestination + n), _mm_cvtps_epi32(scaled));
+    }
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    const float32x4_t high = vdupq_n_f32(klimit_output_int32), low = vdupq_n_f32(-kscale_output_int32);
+    for (; n + 4 <= icount; n += 4) {
+        float32x4_t scaled = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(isource + n), kscale_output_int32), low), high);
+        vst1q_s32(odestination + n, vcvtnq_s32_f32(scaled));
+    }
+#endif
+    for (; n < icount; ++n) {
+        odestination[n] = static_cast<int32_t>(std::lrintf(std::clamp(isource[n] * kscale_output_int32, -kscale_output_int32,
+                                                                      klimit_output_int32)));
+    }
+}
+
+// Interleave frames [ifr_first, ifr_first + icount) of the planar bus into odestination
+inline void function_output_interleave(const float* imix, UInt32 ichannels, UInt32 istride_frames, UInt32 ifr_first,
+                                       UInt32 icount, float* odestination) {
+    UInt32 ch = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    // 4 x 4 transposes: four channels by four frames per step
+    for (; ch + 4 <= ichannels; ch += 4) {
+        const float* row = imix + static_cast<size_t>(ch) * istride_frames + ifr_first;
+        UInt32 fr = 0;
+        for (; fr + 4 <= icount; fr += 4) {
+            __m128 row0 = _mm_loadu_ps(row + fr);
+            __m128 row1 = _mm_loadu_ps(row + istride_frames + fr);
+            __m128 row2 = _mm_loadu_ps(row + 2 * static_cast<size_t>(istride_frames) + fr);
+            __m128 row3 = _mm_loadu_ps(row + 3 * static_cast<size_t>(istride_frames) + fr);
+            _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+            float* destination = odestination + static_cast<size_t>(fr) * ichannels + ch;
+            _mm_storeu_ps(destination, row0);
+            _mm_storeu_ps(destination + ichannels, row1);
+            _mm_storeu_ps(destination + 2 * ichannels, row2);
+            _mm_storeu_ps(destination + 3 * ichannels, row3);
+        }
+        for (; fr < icount; ++fr) {
+            for (UInt32 lane = 0; lane < 4; ++lane) {
+                odestination[static_cast<size_t>(fr) * ichannels + ch + lane] = row[lane * static_cast<size_t>(istride_frames) + fr];
+            }
+        }
+    }
+#endif
+    for (; ch < ichannels; ++ch) {
+        const float* row = imix + static_cast<size_t>(ch) * istride_frames + ifr_first;
+        for (UInt32 fr = 0; fr < icount; ++fr) odestination[static_cast<size_t>(fr) * ichannels + ch] = row[fr];
+    }
+}
+
+/**
+ * One kernel per (sample type, layout). imix is the planar bus, one
+ * icount_frames row per channel; oiobuffers is the device buffer list.
+ */
+template <typename type_sample, bool is_interleaved>
+void function_output_convert(const float* imix, UInt32 ichannels, UInt32 icount_frames, AudioBufferList* oiobuffers) {
+    if (!is_interleaved) {
+        for (UInt32 ch = 0; ch < ichannels; ++ch) {
+            function_output_row(imix + static_cast<size_t>(ch) * icount_frames,
+                                static_cast<type_sample*>(oiobuffers->mBuffers[ch].mData), icount_frames);
+        }
+        return;
+    }
+
+    // Interleave a span of frames into the stack block, then convert it as one contiguous row
+    type_sample* destination = static_cast<type_sample*>(oiobuffers->mBuffers[0].mData);
+    float samples_chunk[ksamples_output_chunk];
+    const UInt32 frames_chunk = std::max<UInt32>(1, ksamples_output_chunk / std::max<UInt32>(ichannels, 1));
+    for (UInt32 fr_chunk = 0; fr_chunk < icount_frames; fr_chunk += frames_chunk) {
+        const UInt32 frames_chunk_count = std::min<UInt32>(frames_chunk, icount_frames - fr_chunk);
+        if (ichannels > ksamples_output_chunk) {
+            // Wider than the block: one frame at a time, gathered directly
+            for (UInt32 ch = 0; ch < ichannels; ++ch) {
+                function_output_row(imix + static_cast<size_t>(ch) * icount_frames + fr_chunk,
+                                    destination + static_cast<size_t>(fr_chunk) * ichannels + ch, 1);
+            }
+            continue;
+        }
+        function_output_interleave(imix, ichannels, icount_frames, fr_chunk, frames_chunk_count, samples_chunk);
+        function_output_row(samples_chunk, destination + static_cast<size_t>(fr_chunk) * ichannels, frames_chunk_count * ichannels);
+    }
+}
+
+/**
+ * REQUANTIZATION FOR INTEGER OUTPUTS
+ *
+ * Rounding the mix straight to int16 turns quiet grain tails into distortion
+ * correlated with the signal. Integer streams therefore go through an error
+ * feedback requantizer:
+ *
+ *   v[n] = x[n] * scale - sum(h[k] * e[n-1-k])     (noise shaping)
+ *   q[n] = round(v[n] + d[n])                       (d: TPDF dither, +/-1 LSB)
+ *   e[n] = q[n] - v[n]
+ *
+ * The dither is the difference of two uniform draws from a per-channel
+ * xorshift32 generator. Noise-shaping filters range from none (flat TPDF)
+ * to a 5-tap E-weighted filter (Lipshitz et al.) that moves the noise up
+ * into the band where hearing is least sensitive. int32 streams are
+ * requantized to 24 bits, the resolution of both the float mix and real
+ * converters, and then shifted into the top bits. This holds in round mode
+ * too: a 24-bit converter (or the offline 24-bit writer) keeps only the top
+ * three bytes, so a word rounded at 2^31 would be truncated there instead.
+ *
+ * VECTORIZATION:
+ * The feedback loop is sequential in time but independent per channel, so
+ * the SSE2 / NEON path runs four channels per vector over an interleaved
+ * block. Each frame steps every channel group in turn, so the groups'
+ * feedback latencies overlap instead of adding up. Any remaining channels
+ * take the scalar path, which uses the same operation order and matches bit
+ * for bit. Mode changes (live key 'n') apply from the next block; the
+ * generator state and filter history persist across blocks in the mix bus.
+ */
+constexpr float kscale_dither_uniform = 1.0f / 16777216.0f;   // 24 random bits -> [0, 1)
+
+inline uint32_t function_dither_next(uint32_t& iostate) {
+    iostate ^= iostate << 13;
+    iostate ^= iostate >> 17;
+    iostate ^= iostate << 5;
+    return iostate;
+}
+
+/**
+ * Requantize iframes interleaved frames of ichannels channels (in LSB units
+ * of iscale, saturated to [ilow, ihigh]) with the mix bus's per-channel
+ * dither and shaping state.
+ */
+GRANULAR_FP_STRICT
+void function_requantize_block(const float* isamples, UInt32 ichannels, UInt32 iframes, const struct_quantize_mode& imode,
+                               float iscale, float ilow, float ihigh, int32_t* oquantized) {
+    uint32_t* state_dither = global_MixBus.state_dither.data();
+    float* error_shaping = global_MixBus.error_shaping.data();
+    const size_t stride_tap = global_MixBus.channels_capacity_mix;
+    const float* h = imode.coefficients;
+    UInt32 ch = 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+    // Frames outer, channel groups inner: each group's feedback chain overlaps the others'
+    const UInt32 channels_vector = ichannels & ~3u;
+    const __m128 h0 = _mm_set1_ps(h[0]), h1 = _mm_set1_ps(h[1]), h2 = _mm_set1_ps(h[2]), h3 = _mm_set1_ps(h[3]), h4 = _mm_set1_ps(h[4]);
+    const __m128 scale = _mm_set1_ps(iscale), low = _mm_set1_ps(ilow), high = _mm_set1_ps(ihigh);
+    const __m128 one = _mm_set1_ps(1.0f), minus_one = _mm_set1_ps(-1.0f);
+    const __m128 scale_uniform = _mm_set1_ps(kscale_dither_uniform), amplitude = _mm_set1_ps(imode.amplitude_dither);
+    for (UInt32 fr = 0; fr < iframes; ++fr) {
+        for (UInt32 ch_group = 0; ch_group < channels_vector; ch_group += 4) {
+            const size_t index = static_cast<size_t>(fr) * ichannels + ch_group;
+            __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state_dither + ch_group));
+            const __m128 e0 = _mm_loadu_ps(error_shaping + ch_group), e1 = _mm_loadu_ps(error_shaping + stride_tap + ch_group);
+            const __m128 e2 = _mm_loadu_ps(error_shaping + 2 * stride_tap + ch_group), e3 = _mm_loadu_ps(error_shaping + 3 * stride_tap + ch_group);
+            const __m128 e4 = _mm_loadu_ps(error_shaping + 4 * stride_tap + ch_group);
+
+            __m128 sample = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(isamples + index), minus_one), one);
+            __m128 feedback = _mm_mul_ps(h0, e0);
+            feedback = _mm_add_ps(feedback, _mm_mul_ps(h1, e1));
+            feedback = _mm_add_ps(feedback, _mm_mul_ps(h2, e2));
+            feedback = _mm_add_ps(feedback, _mm_mul_ps(h3, e3));
+            feedback = _mm_add_ps(feedback, _mm_mul_ps(h4, e4));
+            const __m128 target = _mm_sub_ps(_mm_mul_ps(sample, scale), feedback);
+
+            state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+            state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+            state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+            const __m128 uniform_first = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(state, 8)), scale_uniform);
+            state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+            state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+            state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+            const __m128 uniform_second = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(state, 8)), scale_uniform);
+            const __m128 dither = _mm_mul_ps(_mm_sub_ps(uniform_first, uniform_second), amplitude);
+
+            const __m128 quantized = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_add_ps(target, dither)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(oquantized + index), _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(quantized, low), high)));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state_dither + ch_group), state);
+            _mm_storeu_ps(error_shaping + 4 * stride_tap + ch_group, e3); _mm_storeu_ps(error_shaping + 3 * stride_tap + ch_group, e2);
+            _mm_storeu_ps(error_shaping + 2 * stride_tap + ch_group, e1); _mm_storeu_ps(error_shaping + stride_tap + ch_group, e0);
+            _mm_storeu_ps(error_shaping + ch_group, _mm_sub_ps(quantized, target));
+        }
+    }
+    ch = channels_vector;
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    const UInt32 channels_vector = ichannels & ~3u;
+    const float32x4_t low = vdupq_n_f32(ilow), high = vdupq_n_f32(ihigh);
+    const float32x4_t one = vdupq_n_f32(1.0f), minus_one = vdupq_n_f32(-1.0f);
+    for (UInt32 fr = 0; fr < iframes; ++fr) {
+        for (UInt32 ch_group = 0; ch_group < channels_vector; ch_group += 4) {
+            const size_t index = static_cast<size_t>(fr) * ichannels + ch_group;
+            uint32x4_t state = vld1q_u32(state_dither + ch_group);
+            const float32x4_t e0 = vld1q_f32(error_shaping + ch_group), e1 = vld1q_f32(error_shaping + stride_tap + ch_group);
+            const float32x4_t e2 = vld1q_f32(error_shaping + 2 * stride_tap + ch_group), e3 = vld1q_f32(error_shaping + 3 * stride_tap + ch_group);
+            const float32x4_t e4 = vld1q_f32(error_shaping + 4 * stride_tap + ch_group);
+
+            float32x4_t sample = vminq_f32(vmaxq_f32(vld1q_f32(isamples + index), minus_one), one);
+            float32x4_t feedback = vmulq_n_f32(e0, h[0]);
+            feedback = vaddq_f32(feedback, vmulq_n_f32(e1, h[1]));
+            feedback = vaddq_f32(feedback, vmulq_n_f32(e2, h[2]));
+            feedback = vaddq_f32(feedback, vmulq_n_f32(e3, h[3]));
+            feedback = vaddq_f32(feedback, vmulq_n_f32(e4, h[4]));
+            const float32x4_t target = vsubq_f32(vmulq_n_f32(sample, iscale), feedback);
+
+            state = veorq_u32(state, vshlq_n_u32(state, 13));
+            state = veorq_u32(state, vshrq_n_u32(state, 17));
+            state = veorq_u32(state, vshlq_n_u32(state, 5));
+            const float32x4_t uniform_first = vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(state, 8)), kscale_dither_uniform);
+            state = veorq_u32(state, vshlq_n_u32(state, 13));
+            state = veorq_u32(state, vshrq_n_u32(state, 17));
+            state = veorq_u32(state, vshlq_n_u32(state, 5));
+            const float32x4_t uniform_second = vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(state, 8)), kscale_dither_uniform);
+            const float32x4_t dither = vmulq_n_f32(vsubq_f32(uniform_first, uniform_second), imode.amplitude_dither);
+
+            const float32x4_t quantized = vcvtq_f32_s32(vcvtnq_s32_f32(vaddq_f32(target, dither)));
+            vst1q_s32(oquantized + index, vcvtnq_s32_f32(vminq_f32(vmaxq_f32(quantized, low), high)));
+
+            vst1q_u32(state_dither + ch_group, state);
+            vst1q_f32(error_shaping + 4 * stride_tap + ch_group, e3); vst1q_f32(error_shaping + 3 * stride_tap + ch_group, e2);
+            vst1q_f32(error_shaping + 2 * stride_tap + ch_group, e1); vst1q_f32(error_shaping + stride_tap + ch_group, e0);
+            vst1q_f32(error_shaping + ch_group, vsubq_f32(quantized, target));
+        }
+    }
+    ch = channels_vector;
+#endif
+
+    for (; ch < ichannels; ++ch) {
+        uint32_t state = state_dither[ch];
+        float e[ktaps_shaping];
+        for (uint32_t tap = 0; tap < ktaps_shaping; ++tap) e[tap] = error_shaping[tap * stride_tap + ch];
+
+        for (UInt32 fr = 0; fr < iframes; ++fr) {
+            const size_t index = static_cast<size_t>(fr) * ichannels + ch;
+            const float sample = std::min(std::max(isamples[index], -1.0f), 1.0f);
+            float feedback = h[0] * e[0];
+            feedback = feedback + h[1] * e[1];
+            feedback = feedback + h[2] * e[2];
+            feedback = feedback + h[3] * e[3];
+            feedback = feedback + h[4] * e[4];
+            const float target = sample * iscale - feedback;
+
+            const float uniform_first = static_cast<float>(static_cast<int32_t>(function_dither_next(state) >> 8)) * kscale_dither_uniform;
+            const float uniform_second = static_cast<float>(static_cast<int32_t>(function_dither_next(state) >> 8)) * kscale_dither_uniform;
+            const float dither = (uniform_first - uniform_second) * imode.amplitude_dither;
+
+            const float quantized = static_cast<float>(std::lrintf(target + dither));
+            e[4] = e[3]; e[3] = e[2]; e[2] = e[1]; e[1] = e[0];
+            e[0] = quantized - target;
+            oquantized[index] = static_cast<int32_t>(std::lrintf(std::min(std::max(quantized, ilow), ihigh)));
+        }
+
+        state_dither[ch] = state;
+        for (uint32_t tap = 0; tap < ktaps_shaping; ++tap) error_shaping[tap * stride_tap + ch] = e[tap];
+    }
+}
+
+/**
+ * Integer kernels: requantize through an interleaved block, then store as
+ * int16 or as 24-bit words in the top of an int32. Round mode on int16 (or a
+ * device wider than the block) takes the plain conversion instead.
+ */
+template <typename type_sample, bool is_interleaved>
+void function_output_requantize(const float* imix, UInt32 ichannels, UInt32 icount_frames, AudioBufferList* oiobuffers) {
+    const int mode_quantize = g_quantize_mode.load(std::memory_order_relaxed);
+    const bool is_int16 = sizeof(type_sample) == sizeof(int16_t);
+    if ((mode_quantize == kquantize_round && is_int16) || ichannels > ksamples_output_chunk ||
+        ichannels > global_MixBus.channels_capacity_mix) {
+        function_output_convert<type_sample, is_interleaved>(imix, ichannels, icount_frames, oiobuffers);
+        return;
+    }
+    const struct_quantize_mode& mode = garray_quantize_modes[mode_quantize];
+    const float scale = is_int16 ? kscale_output_int16 : 8388608.0f;   // int32 streams carry 24-bit words
+    const float low = is_int16 ? -32768.0f : -8388608.0f;
+    const float high = is_int16 ? 32767.0f : 8388607.0f;
+    const int shift = is_int16 ? 0 : 8;
+
+    float samples_chunk[ksamples_output_chunk];
+    int32_t quantized_chunk[ksamples_output_chunk];
+    const UInt32 frames_chunk = ksamples_output_chunk / ichannels;
+    for (UInt32 fr_chunk = 0; fr_chunk < icount_frames; fr_chunk += frames_chunk) {
+        const UInt32 frames_chunk_count = std::min<UInt32>(frames_chunk, icount_frames - fr_chunk);
+        function_output_interleave(imix, ichannels, icount_frames, fr_chunk, frames_chunk_count, samples_chunk);
+        function_requantize_block(samples_chunk, ichannels, frames_chunk_count, mode, scale, low, high, quantized_chunk);
+
+        const UInt32 samples_count = frames_chunk_count * ichannels;
+        if (is_interleaved) {
+            type_sample* destination = static_cast<type_sample*>(oiobuffers->mBuffers[0].mData) + static_cast<size_t>(fr_chunk) * ichannels;
+            for (UInt32 n = 0; n < samples_count; ++n) {
+                destination[n] = static_cast<type_sample>(static_cast<uint32_t>(quantized_chunk[n]) << shift);
+            }
+        } else {
+            for (UInt32 ch = 0; ch < ichannels; ++ch) {
+                type_sample* destination = static_cast<type_sample*>(oiobuffers->mBuffers[ch].mData) + fr_chunk;
+                for (UInt32 fr = 0; fr < frames_chunk_count; ++fr) {
+                    destination[fr] = static_cast<type_sample>(static_cast<uint32_t>(quantized_chunk[static_cast<size_t>(fr) * ichannels + ch]) << shift);
+                }
+            }
+        }
+    }
+}
+
+struct struct_output_dispatch {
+    const char* name_format;                 // Sample type of the negotiated stream
+    function_output_t function_planar;       // One buffer per channel
+    function_output_t function_interleaved;  // All channels in buffer 0
+};
+
+struct_output_dispatch g_output_dispatch = {"float32", function_output_convert<float, false>, function_output_convert<float, true>};
+
+// Pick the kernels for the negotiated stream format; call before audio starts
+void function_output_select() {
+    if (g_output_is_float) {
+        g_output_dispatch = {"float32", function_output_convert<float, false>, function_output_convert<float, true>};
+    } else if (g_output_bits_per_channel == 16) {
+        g_output_dispatch = {"int16", function_output_requantize<int16_t, false>, function_output_requantize<int16_t, true>};
+    } else {
+        g_output_dispatch = {"int32", function_output_requantize<int32_t, false>, function_output_requantize<int32_t, true>};
+    }
+    std::cout << "Output kernel: " << g_output_dispatch.name_format << ", "
+              << (g_output_non_interleaved ? "planar" : "interleaved");
+    if (!g_output_is_float) std::cout << ", " << garray_quantize_modes[g_quantize_mode.load()].name_mode;
+    std::cout << "\n";
+}
+
+// =============================================================================
+// FRACTIONAL-RATE SOURCE INTERPOLATION
+// =============================================================================
+
+/**
+ * PITCH-SHIFTING GRAIN READS
+ *
+ * A grain with playback rate r reads the source at positions start + n * r, so
+ * r > 1 transposes up and r < 1 transposes down. Rate 1.0 keeps the direct
+ * span path; any other rate is rendered in three passes over the grain's run:
+ *
+ * 1. Once per grain: integer read index and interpolation coefficients for
+ *    every frame (shared by all channels of the grain)
+ * 2. Per channel: each output frame is a short dot product of coefficients
+ *    against contiguous source taps, done 4 lanes at a time (SSE / NEON)
+ * 3. Per channel: the existing SIMD kernel adds the result times the envelope
+ *
+ * INTERPOLATION MODES (live key 'i'):
+ * • Linear: 2 taps, cheapest, slight high-frequency roll-off
+ * • Cubic Hermite (Catmull-Rom): 4 taps, the default
+ * • Windowed sinc: Blackman-windowed, 512 fractional phases, band-limited
+ *   for upward transpositions. Rates up to krate_grain_max are split into
+ *   cutoff bands; a grain reads the table of the band nearest its rate r,
+ *   with the cutoff at 1/r of the source Nyquist and the kernel widened by
+ *   r (8 taps at rate 1, 16 at rate 2), so content that would fold back
+ *   above the new Nyquist is filtered out first. Rates at or below 1 use
+ *   the full-band 8-tap table.
+ *
+ * Frames whose taps would fall outside the file are left silent; they only
+ * occur within a few frames of the file's first and last sample.
+ */
+constexpr uint32_t ktaps_sinc = 8;                 // Full-band kernel: taps at source offsets -3..+4
+constexpr uint32_t kphases_sinc = 512;             // Fractional positions resolved by the table
+constexpr uint32_t kbands_sinc = 5;                // Cutoff bands for rates 1, 1.25, 1.5, 1.75 and 2 (krate_grain_max)
+
+// Band iband is designed for this rate; its cutoff is the reciprocal
+inline double function_sinc_band_rate(uint32_t iband) {
+    return 1.0 + static_cast<double>(iband) * (krate_grain_max - 1.0) / (kbands_sinc - 1);
+}
+
+static_assert(krate_grain_max == 2.0f, "Sinc band taps assume the fastest rate is 2");
+
+// Kernel length for a band: ktaps_sinc widened by the band's rate, rounded up to the 4-lane dot product
+constexpr uint32_t function_sinc_band_taps(uint32_t iband) {
+    return (ktaps_sinc * (kbands_sinc - 1 + iband) / (kbands_sinc - 1) + 3) / 4 * 4;
+}
+
+constexpr uint32_t function_sinc_band_offset(uint32_t iband) {
+    return iband == 0 ? 0 : function_sinc_band_offset(iband - 1) + (kphases_sinc + 1) * function_sinc_band_taps(iband - 1);
+}
+
+alignas(16) float garray_sinc_table[function_sinc_band_offset(kbands_sinc)];
+
+// Nearest band for a playback rate; rates at or below 1 keep the full band
+inline uint32_t function_sinc_band(double irate) {
+    if (irate <= 1.0) return 0;
+    const double band = std::round((irate - 1.0) * (kbands_sinc - 1) / (krate_grain_max - 1.0));
+    return std::min<uint32_t>(kbands_sinc - 1, static_cast<uint32_t>(band));
+}
+
+// Build the windowed-sinc phase tables, one per cutoff band; every row is normalized to unity DC gain
+void function_shape_sinc_table() {
+    constexpr double kPi = 3.14159265358979323846;
+    for (uint32_t band = 0; band < kbands_sinc; ++band) {
+        const double cutoff = 1.0 / function_sinc_band_rate(band);            // Fraction of the source Nyquist kept
+        const uint32_t taps = function_sinc_band_taps(band);
+        const double taps_before = taps / 2.0 - 1.0;
+        float* table = garray_sinc_table + function_sinc_band_offset(band);
+        for (uint32_t phase = 0; phase <= kphases_sinc; ++phase) {
+            const double fraction = static_cast<double>(phase) / kphases_sinc;
+            double sum_row = 0.0;
+            for (uint32_t tap = 0; tap < taps; ++tap) {
+                const double x = static_cast<double>(tap) - taps_before - fraction;   // Distance from the read position
+                const double sinc = (std::fabs(x) < 1e-9) ? 1.0 : std::sin(kPi * cutoff * x) / (kPi * cutoff * x);
+                const double w = (x + taps / 2.0) / taps;                            // Window phase, 0..1 across the taps
+                const double window = 0.42 - 0.5 * std::cos(2.0 * kPi * w) + 0.08 * std::cos(4.0 * kPi * w);
+                table[phase * taps + tap] = static_cast<float>(sinc * window);
+                sum_row += sinc * window;
+            }
+            for (uint32_t tap = 0; tap < taps; ++tap) {
+                table[phase * taps + tap] = static_cast<float>(table[phase * taps + tap] / sum_row);
+            }
+        }
+    }
+}
+
+struct struct_interpolation_run {
+    uint32_t frame_skip;        // Leading frames of the run whose taps fall before the file start
+    uint32_t frames_run;        // Frames after frame_skip that can be interpolated
+    uint32_t frame_tap_first;   // First source frame any tap of the run reads
+    uint32_t frames_tap_span;   // Source frames from frame_tap_first through the last tap
+    uint32_t band_sinc;         // Sinc cutoff band for the run's rate (see function_sinc_band)
+};
+
+/**
+ * Pass 1: read indices and coefficients for one grain's run. Fills the mix bus
+ * scratch for frames [frame_skip, frame_skip + frames_run) only. Indices are
+ * relative to frame_tap_first and point at each frame's first tap, so pass 2
+ * can read from any contiguous copy of the tap span.
+ */
+struct_interpolation_run function_interpolation_prepare(double iposition_first,
+                                                        double irate,
+                                                        uint32_t icount_frames,
+                                                        int imode,
+                                                        uint32_t iframes_total,
+                                                        int32_t* oindex,
+                                                        float* ocoefficients) {
+    struct_interpolation_run run{0, 0, 0, 0, function_sinc_band(irate)};
+    const int64_t taps_sinc = function_sinc_band_taps(run.band_sinc);
+    const int64_t taps_before = (imode == kinterpolation_sinc) ? taps_sinc / 2 - 1 : (imode == kinterpolation_hermite) ? 1 : 0;
+    const int64_t taps_after  = (imode == kinterpolation_sinc) ? taps_sinc / 2 : (imode == kinterpolation_hermite) ? 2 : 1;
+
+    if (static_cast<int64_t>(iframes_total) <= taps_before + taps_after) return run;
+
+    // First frame whose earliest tap is inside the file
+    int64_t frame_first = 0;
+    if (iposition_first < static_cast<double>(taps_before)) {
+        frame_first = static_cast<int64_t>(std::ceil((static_cast<double>(taps_before) - iposition_first) / irate));
+    }
+    // One past the last frame whose latest tap is inside the file
+    const double position_limit = static_cast<double>(static_cast<int64_t>(iframes_total) - taps_after);
+    int64_t frame_end = static_cast<int64_t>(std::ceil((position_limit - iposition_first) / irate));
+    frame_first = std::clamp<int64_t>(frame_first, 0, icount_frames);
+    frame_end = std::clamp<int64_t>(frame_end, frame_first, icount_frames);
+    while (frame_end > frame_first &&
+           static_cast<int64_t>(iposition_first + (frame_end - 1) * irate) + taps_after > static_cast<int64_t>(iframes_total) - 1) {
+        --frame_end;
+    }
+
+    if (frame_end == frame_first) return run;
+    const int32_t index_read_first = static_cast<int32_t>(iposition_first + static_cast<double>(frame_first) * irate);
+    const int32_t index_read_last = static_cast<int32_t>(iposition_first + static_cast<double>(frame_end - 1) * irate);
+
+    if (imode == kinterpolation_hermite) {
+        // Catmull-Rom weights for taps -1, 0, +1, +2
+        for (int64_t fr = frame_first; fr < frame_end; ++fr) {
+            const double position = iposition_first + static_cast<double>(fr) * irate;
+            const int32_t index_read = static_cast<int32_t>(position);
+            const float fraction = static_cast<float>(position - static_cast<double>(index_read));
+            const float f2 = fraction * fraction;
+            const float f3 = f2 * fraction;
+            float* c = ocoefficients + fr * 4;
+            oindex[fr] = index_read - index_read_first;
+            c[0] = -0.5f * f3 + f2 - 0.5f * fraction;
+            c[1] =  1.5f * f3 - 2.5f * f2 + 1.0f;
+            c[2] = -1.5f * f3 + 2.0f * f2 + 0.5f * fraction;
+            c[3] =  0.5f * f3 - 0.5f * f2;
+        }
+    } else {
+        // Linear and sinc keep the fraction itself
+        for (int64_t fr = frame_first; fr < frame_end; ++fr) {
+            const double position = iposition_first + static_cast<double>(fr) * irate;
+            const int32_t index_read = static_cast<int32_t>(position);
+            oindex[fr] = index_read - index_read_first;
+            ocoefficients[fr] = static_cast<float>(position - static_cast<double>(index_read));
+        }
+    }
+
+    run.frame_skip = static_cast<uint32_t>(frame_first);
+    run.frames_run = static_cast<uint32_t>(frame_end - frame_first);
+    run.frame_tap_first = static_cast<uint32_t>(index_read_first - taps_before);
+    run.frames_tap_span = static_cast<uint32_t>(index_read_last - index_read_first + taps_before + taps_after + 1);
+    return run;
+}
+
+/**
+ * Pass 2: interpolate one source channel over a prepared run into oresampled.
+ * isource starts at the run's frame_tap_first; the index and coefficient
+ * pointers are already offset to the first frame of the run.
+ */
+void function_interpolate_channel(const float* isource,
+                                  const int32_t* iindex,
+                                  const float* icoefficients,
+                                  int imode,
+                                  uint32_t iband_sinc,
+                                  uint32_t icount_frames,
+                                  float* oresampled) {
+    if (imode == kinterpolation_linear) {
+        for (uint32_t fr = 0; fr < icount_frames; ++fr) {
+            const float* taps = isource + iindex[fr];
+            oresampled[fr] = taps[0] + icoefficients[fr] * (taps[1] - taps[0]);
+        }
+        return;
+    }
+
+    // Hermite and sinc: coefficient rows and tap spans for four frames at a time
+    const bool status_sinc = (imode == kinterpolation_sinc);
+    const uint32_t count_taps = status_sinc ? function_sinc_band_taps(iband_sinc) : 4;
+    const float* table_sinc = garray_sinc_table + function_sinc_band_offset(iband_sinc);
+    auto function_row = [&](uint32_t ifr) -> const float* {
+        // Sinc: nearest table phase for the frame's fraction, in the run's cutoff band
+        return status_sinc
+            ? table_sinc + static_cast<uint32_t>(icoefficients[ifr] * kphases_sinc + 0.5f) * count_taps
+            : icoefficients + ifr * 4;
+    };
+
+    uint32_t fr = 0;
+    for (; fr + 4 <= icount_frames; fr += 4) {
+        const float* const coefficients[4] = {function_row(fr), function_row(fr + 1), function_row(fr + 2), function_row(fr + 3)};
+        const float* const taps[4] = {isource + iindex[fr],     isource + iindex[fr + 1],
+                                      isource + iindex[fr + 2], isource + iindex[fr + 3]};
+        function_dot_frames4(coefficients, taps, count_taps, oresampled + fr);
+    }
+    for (; fr < icount_frames; ++fr) {
+        const float* coefficients = function_row(fr);
+        const float* taps = isource + iindex[fr];
+        float sum = 0.0f;
+        for (uint32_t tap = 0; tap < count_taps; ++tap) sum += coefficients[tap] * taps[tap];
+        oresampled[fr] = sum;
+    }
+}
+
+// =============================================================================
+// OUTPUT CHANNEL GAIN
+// =============================================================================
+
+/**
+ * Applies the per-channel gain vector (see OUTPUT CHANNEL GAIN AND MUTE) to
+ * the planar bus. Every channel runs the same straight-line ramp kernel,
+ * gain_start + step x (frame + 1), so steady, muted and ramping channels
+ * take one path with no per-channel or per-sample branches; a unity channel
+ * multiplies by exactly 1.0 and passes unchanged.
+ */
+void function_channel_gain_row(float* iorow, UInt32 iframes, float igain_start, float istep) {
+    UInt32 fr = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    const __m128 start = _mm_set1_ps(igain_start), step = _mm_set1_ps(istep), four = _mm_set1_ps(4.0f);
+    __m128 index = _mm_setr_ps(1.0f, 2.0f, 3.0f, 4.0f);
+    for (; fr + 4 <= iframes; fr += 4) {
+        const __m128 gain = _mm_add_ps(start, _mm_mul_ps(step, index));
+        _mm_storeu_ps(iorow + fr, _mm_mul_ps(_mm_loadu_ps(iorow + fr), gain));
+        index = _mm_add_ps(index, four);
+    }
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    const float32x4_t start = vdupq_n_f32(igain_start), four = vdupq_n_f32(4.0f);
+    const float garray_index[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+    float32x4_t index = vld1q_f32(garray_index);
+    for (; fr + 4 <= iframes; fr += 4) {
+        const float32x4_t gain = vaddq_f32(start, vmulq_n_f32(index, istep));
+        vst1q_f32(iorow + fr, vmulq_f32(vld1q_f32(iorow + fr), gain));
+        index = vaddq_f32(index, four);
+    }
+#endif
+    for (; fr < iframes; ++fr) iorow[fr] *= igain_start + istep * static_cast<float>(fr + 1);
+}
+
+void function_channel_gain_process(float* iomix, UInt32 ichannels, UInt32 iframes) {
+    const float delta_max = static_cast<float>(iframes / (kms_channel_gain_ramp * 0.001 * g_output_sample_rate));
+    const float scale_frames = 1.0f / static_cast<float>(iframes);
+    float* gain_channel = global_MixBus.gain_channel.data();
+    for (UInt32 ch = 0; ch < ichannels; ++ch) {
+        const float gain_start = gain_channel[ch];
+        const float gain_end = gain_start + std::clamp(function_channel_gain_target(ch) - gain_start, -delta_max, delta_max);
+        function_channel_gain_row(iomix + static_cast<size_t>(ch) * iframes, iframes, gain_start, (gain_end - gain_start) * scale_frames);
+        gain_channel[ch] = gain_end;
+    }
+}
+
+// =============================================================================
+// MASTER BUS LIMITER
+// =============================================================================
+
+/**
+ * LINKED LOOK-AHEAD TRUE-PEAK LIMITER
+ *
+ * Dense clouds on the all-channels target sum well past full scale, and the
+ * output kernels can only clip. The limiter sits between the mix bus and
+ * format conversion and pulls the whole bus down by one linked gain, so the
+ * spatial image holds while the loudest channel stays under the ceiling.
+ *
+ * PER BLOCK:
+ * 1. Each channel's block is appended to its delay line.
+ * 2. Detection (SSE2 / NEON): the linked peak of every frame is the largest
+ *    |x[n]| or |x[n + 1/2]| over all channels, where the half-sample point
+ *    is a 4-tap cubic midpoint, a 2x oversampled true-peak estimate. The
+ *    midpoint reads two frames ahead, so detection lags the input by two.
+ * 3. Gain, per frame: the target min(1, ceiling / peak) goes through a
+ *    sliding minimum over the look-ahead window, an exponential release,
+ *    and a box filter over the attack window. Every gain the box averages
+ *    is at most the target of the sample it lands on, so the detected peaks
+ *    never exceed the ceiling.
+ * 4. The delayed samples are multiplied by the gain (SSE2 / NEON).
+ *
+ * LATENCY: look-ahead + 2 frames (function_limiter_latency). Below the
+ * ceiling the gain is exactly 1.0 and the bus passes through unchanged,
+ * only delayed. Changing the look-ahead or attack resets the delay line.
+ */
+// Linked peak: opeak[i] = max(operak[i], |x[i]|, |x[i + 1/2]|) for one channel; irow[-1] and irow[iframes + 1] must be readable
+void function_limiter_detect_row(const float* irow, UInt32 iframes, float* opeak) {
+    UInt32 fr = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    const __m128 mask_abs = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 weight_inner = _mm_set1_ps(0.5625f), weight_outer = _mm_set1_ps(0.0625f);
+    for (; fr + 4 <= iframes; fr += 4) {
+        const __m128 before = _mm_loadu_ps(irow + fr - 1), here = _mm_loadu_ps(irow + fr);
+        const __m128 next = _mm_loadu_ps(irow + fr + 1), after = _mm_loadu_ps(irow + fr + 2);
+        const __m128 midpoint = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(here, next), weight_inner),
+                                           _mm_mul_ps(_mm_add_ps(before, after), weight_outer));
+        const __m128 peak = _mm_max_ps(_mm_and_ps(here, mask_abs), _mm_and_ps(midpoint, mask_abs));
+        _mm_storeu_ps(opeak + fr, _mm_max_ps(_mm_loadu_ps(opeak + fr), peak));
+    }
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    for (; fr + 4 <= iframes; fr += 4) {
+        const float32x4_t before = vld1q_f32(irow + fr - 1), here = vld1q_f32(irow + fr);
+        const float32x4_t next = vld1q_f32(irow + fr + 1), after = vld1q_f32(irow + fr + 2);
+        const float32x4_t midpoint = vsubq_f32(vmulq_n_f32(vaddq_f32(here, next), 0.5625f),
+                                               vmulq_n_f32(vaddq_f32(before, after), 0.0625f));
+        const float32x4_t peak = vmaxq_f32(vabsq_f32(here), vabsq_f32(midpoint));
+        vst1q_f32(opeak + fr, vmaxq_f32(vld1q_f32(opeak + fr), peak));
+    }
+#endif
+    for (; fr < iframes; ++fr) {
+        const float midpoint = (irow[fr] + irow[fr + 1]) * 0.5625f - (irow[fr - 1] + irow[fr + 2]) * 0.0625f;
+        opeak[fr] = std::max(opeak[fr], std::max(std::fabs(irow[fr]), std::fabs(midpoint)));
+    }
+}
+
+void function_limiter_apply_row(const float* idelayed, const float* igain, UInt32 iframes, float* odestination) {
+    UInt32 fr = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    for (; fr + 4 <= iframes; fr += 4) {
+        _mm_storeu_ps(odestination + fr, _mm_mul_ps(_mm_loadu_ps(idelayed + fr), _mm_loadu_ps(igain + fr)));
+    }
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    for (; fr + 4 <= iframes; fr += 4) {
+        vst1q_f32(odestination + fr, vmulq_f32(vld1q_f32(idelayed + fr), vld1q_f32(igain + fr)));
+    }
+#endif
+    for (; fr < iframes; ++fr) odestination[fr] = idelayed[fr] * igain[fr];
+}
+
+void function_limiter_process(float* iomix, UInt32 ichannels, UInt32 iframes) {
+    struct_limiter& limiter = global_Limiter;
+    if (!g_limiter_enabled.load(std::memory_order_relaxed) || ichannels > limiter.channels_limiter || iframes == 0) {
+        limiter.status_primed = false;   // Bypassed: no latency; the delay line restarts from silence
+        return;
+    }
+
+    // Parameters from the control thread, in frames at the device rate
+    const UInt32 frames_lookahead = function_limiter_frames_lookahead();
+    const long frames_attack_requested = std::lround(g_limiter_attack_ms.load(std::memory_order_relaxed) * 0.001 * g_output_sample_rate);
+    const UInt32 frames_attack = static_cast<UInt32>(std::clamp<long>(frames_attack_requested, 1, frames_lookahead + 1));
+    const float ceiling = std::pow(10.0f, g_limiter_ceiling_db.load(std::memory_order_relaxed) / 20.0f);
+    const float frames_release = std::max(1.0f, g_limiter_release_ms.load(std::memory_order_relaxed) * 0.001f * static_cast<float>(g_output_sample_rate));
+    const float coefficient_release = std::exp(-1.0f / frames_release);
+
+    if (!limiter.status_primed || frames_lookahead != limiter.frames_lookahead || frames_attack != limiter.frames_attack) {
+        std::fill(limiter.frames_delay.begin(), limiter.frames_delay.end(), 0.0f);
+        std::fill_n(limiter.values_attack.begin(), frames_attack, 1.0f);
+        limiter.frames_lookahead = frames_lookahead;
+        limiter.frames_attack = frames_attack;
+        limiter.clock_detector = 0;
+        limiter.head_hold = 0;
+        limiter.count_hold = 0;
+        limiter.index_attack = 0;
+        limiter.sum_attack = frames_attack;
+        limiter.gain_release = 1.0f;
+        limiter.status_primed = true;
+    }
+
+    // 1-2. Append each channel's block to its delay line and detect the linked peak
+    const UInt32 frames_history = limiter.frames_history;
+    float* peak = limiter.frames_peak.data();
+    std::fill_n(peak, iframes, 0.0f);
+    for (UInt32 ch = 0; ch < ichannels; ++ch) {
+        float* row = limiter.frames_delay.data() + static_cast<size_t>(ch) * limiter.stride_delay;
+        std::memcpy(row + frames_history, iomix + static_cast<size_t>(ch) * iframes, iframes * sizeof(float));
+        function_limiter_detect_row(row + frames_history - kframes_detector_lag, iframes, peak);
+    }
+
+    // 3. Target gain -> sliding minimum over the look-ahead -> release -> attack box filter
+    const uint32_t size_hold = static_cast<uint32_t>(limiter.values_hold.size());
+    const double scale_attack = 1.0 / frames_attack;
+    float* gain = limiter.frames_gain.data();
+    for (UInt32 fr = 0; fr < iframes; ++fr) {
+        const float target = ceiling / std::max(peak[fr], ceiling);
+        const uint32_t stamp = limiter.clock_detector++;
+
+        if (limiter.count_hold > 0 && stamp - limiter.frames_hold[limiter.head_hold] > frames_lookahead) {
+            limiter.head_hold = (limiter.head_hold + 1 == size_hold) ? 0 : limiter.head_hold + 1;   // Left the window
+            --limiter.count_hold;
+        }
+        while (limiter.count_hold > 0) {
+            uint32_t index_back = limiter.head_hold + limiter.count_hold - 1;
+            if (index_back >= size_hold) index_back -= size_hold;
+            if (limiter.values_hold[index_back] < target) break;
+            --limiter.count_hold;
+        }
+        uint32_t index_push = limiter.head_hold + limiter.count_hold;
+        if (index_push >= size_hold) index_push -= size_hold;
+        limiter.values_hold[index_push] = target;
+        limiter.frames_hold[index_push] = stamp;
+        ++limiter.count_hold;
+        const float held = limiter.values_hold[limiter.head_hold];
+
+        limiter.gain_release = (held < limiter.gain_release) ? held : held + (limiter.gain_release - held) * coefficient_release;
+
+        limiter.sum_attack += static_cast<double>(limiter.gain_release) - limiter.values_attack[limiter.index_attack];
+        limiter.values_attack[limiter.index_attack] = limiter.gain_release;
+        limiter.index_attack = (limiter.index_attack + 1 == frames_attack) ? 0 : limiter.index_attack + 1;
+        gain[fr] = static_cast<float>(limiter.sum_attack * scale_attack);
+    }
+
+    // 4. Delayed samples x gain back into the bus; keep the newest history for the next block
+    for (UInt32 ch = 0; ch < ichannels; ++ch) {
+        float* row = limiter.frames_delay.data() + static_cast<size_t>(ch) * limiter.stride_delay;
+        function_limiter_apply_row(row + frames_history - kframes_detector_lag - frames_lookahead, gain, iframes,
+                                   iomix + static_cast<size_t>(ch) * iframes);
+        std::memmove(row, row + iframes, frames_history * sizeof(float));
+    }
+}
+
+// =============================================================================
+// REAL-TIME AUDIO PROCESSING CALLBACK - CORE ENGINE
+// =============================================================================
+
+/**
+ * Renders one processing quantum into the planar FIFO (global_MixBus.frames_quantum,
+ * channel stride icount_frames): onsets, dry path, every sounding grain, the
+ * channel order test, channel gains and the limiter. Everything that moves
+ * over time advances here, once per quantum, so the rendered stream does not
+ * depend on how the host slices it (see PROCESSING QUANTUM).
+ *
+ * @param outChannels Device channels to render
+ * @param icount_frames Frames in the quantum (global_MixBus.frames_per_quantum)
+ */
+static void function_render_quantum(UInt32 outChannels, UInt32 icount_frames) {
+
+    // grain start interval is adjustable (DENSITY PARAMETER)
+    const double interval_exact_frames = std::max(1.0, double(global_ProcessGrain.frames_object_grain) * double(g_interval_multiplier));
+    const uint32_t interval_start_frames = static_cast<uint32_t>(interval_exact_frames);
+
+    // Density published by the control thread: renormalize sounding grains once,
+    // before this block's spawns pick up the new interval
+    const uint32_t generation_density = g_density_generation.load(std::memory_order_acquire);
+    if (generation_density != global_ProcessGrain.generation_density) {
+        global_ProcessGrain.generation_density = generation_density;
+        global_ProcessGrain.frames_interval_normalization = interval_start_frames;
+        function_grain_normalization_refresh();
+    }
+
+    // SAMPLE-ACCURATE ONSET SCHEDULER
+    // Every onset that falls inside this quantum spawns at its exact frame offset.
+    // The fractional remainder carries into the next quantum, so onsets land on
+    // the same frames whatever block size the host asks for.
+    while (global_ProcessGrain.frames_until_onset < static_cast<double>(icount_frames)) {
+        function_process_grain(static_cast<uint32_t>(global_ProcessGrain.frames_until_onset));
+        global_ProcessGrain.frames_until_onset += interval_exact_frames;
+    }
+    global_ProcessGrain.frames_until_onset -= static_cast<double>(icount_frames);
+
+    UInt32 count_ch = global_AudioFileData.channels_file;
+    uint32_t total_fr = global_AudioFileData.frames_total;
+    uint32_t callback_start_fr = global_AudioFileData.present_frame;
+
+    const float kDryGain = 0.0f;
+    const float kWetGain = 1.0f;
+    
+
+    float* mix = global_MixBus.frames_quantum.data();
+    std::fill_n(mix, static_cast<size_t>(outChannels) * static_cast<size_t>(icount_frames), 0.0f);
+    auto mixIndex = [icount_frames](UInt32 ch, UInt32 fr) {
+        return static_cast<size_t>(ch) * static_cast<size_t>(icount_frames) + static_cast<size_t>(fr);
+    };
+
+ 
+    if (!g_run_channel_order_test && g_status_audio_playback) {
+        for (UInt32 ch_callback = 0; ch_callback < outChannels; ++ch_callback) {
+            // One linear read per channel, like the grains
+            uint16_t file_ch = ch_callback % global_AudioFileData.channels_file;
+            const uint32_t frames_dry = (callback_start_fr < total_fr) ? std::min<uint32_t>(icount_frames, total_fr - callback_start_fr) : 0;
+            const float* source_dry = function_source_span(file_ch, callback_start_fr, frames_dry, global_MixBus.frames_stream.data());
+            float* mix_dry = mix + mixIndex(ch_callback, 0);
+
+            for (UInt32 fr_callback = 0; fr_callback < icount_frames; ++fr_callback) {
+                // Audio callback tries to read past end, gets 0.0f (silence) instead of audio data
+                mix_dry[fr_callback] = kDryGain * (
+                    (fr_callback < frames_dry) ? source_dry[fr_callback] : 0.0f  // Result: Audio fades to silence and stays silent
+                );
+            }
+        }
+        // Audio position reaches total_fr (end of file), std::min() keeps position at total_fr (doesn't advance further)
+        global_AudioFileData.present_frame = std::min(callback_start_fr + icount_frames, total_fr);
+        if (global_AudioFileData.source_streaming) {
+            global_StreamCache.frame_head.store(global_AudioFileData.present_frame, std::memory_order_relaxed);
+        }
+
+        // THIS WOULD ADD A LOOPING FEATURE
+        // global_AudioFileData.present_frame = callback_start_fr + icount_frames;
+        
+        // Loop the audio when it reaches the end
+        // if (global_AudioFileData.present_frame >= total_fr) {
+        //     global_AudioFileData.present_frame = 0;
+        // }
+    }
 
-        for (uint32_t count_frame_process = 0; count_frame_process < frames_grain_process; ++count_frame_process) {
+    float* frames_weight = global_MixBus.frames_weight.data();
+    int32_t* frames_index = global_MixBus.frames_index.data();
+    float* frames_coefficient = global_MixBus.frames_coefficient.data();
+    float* frames_resampled = global_MixBus.frames_resampled.data();
+    float* frames_stream = global_MixBus.frames_stream.data();
+    const int mode_interpolation = g_interpolation_mode.load(std::memory_order_relaxed);
+    const function_kernel_accumulate_t function_accumulate = g_kernel_dispatch.function_accumulate;
 
-            uint32_t frame_grain_audio = element_grain.address_start_frame
-                                       + element_grain.address_present_grain
-                                       + count_frame_process;
+    if (g_status_audio_playback && callback_start_fr < total_fr) {
+    for (uint32_t index_active = 0; index_active < global_ProcessGrain.active_envelopes_grain;) {
+        const uint32_t slot = global_ProcessGrain.array_active_grains[index_active];
+        struct_grain_pool& pool = global_ProcessGrain.pool_grains;
+
+        // Hot fields for this grain, read once from the contiguous pool arrays
+        const uint32_t address_start_frame = pool.address_start_frame[slot];
+        uint32_t& address_present_grain    = pool.address_present_grain[slot];
+        const uint32_t frames_grain        = pool.frames_grain[slot];
+        const int32_t target_object        = pool.target_object[slot];
+        const struct_envelope_table& envelope = *pool.envelope_grain[slot];
+        const float* frames_gain_envelope  = envelope.frames_envelope;
+        uint32_t& phase_envelope           = pool.phase_envelope_grain[slot];
+        const uint32_t increment_envelope  = pool.increment_envelope_grain[slot];
+        const uint16_t source_grain        = pool.source_grain[slot];
+        const uint32_t frames_source_total = function_bank_frames(source_grain);
+        const uint16_t channels_source     = function_bank_channels(source_grain);
+
+        uint32_t frames_grain_ahead = frames_grain - address_present_grain;
+
+        // Gain x density normalization, computed at spawn (see function_grain_normalization)
+        const float grain_base_gain = pool.gain_normalized_grain[slot];
+
+        // Grains spawned in this block start at their onset offset; older grains start at frame 0
+        const uint32_t frame_block_onset = pool.frames_delay_onset[slot];
+        uint32_t frames_grain_process = std::min<uint32_t>(icount_frames - frame_block_onset, frames_grain_ahead);
+
+        // CHANNEL-CONTIGUOUS RUN
+        // The grain reads each file channel as one linear span starting here; the
+        // span is clipped once at the end of the file (frames past it are silent),
+        // so the inner kernels see plain contiguous memory with no per-frame checks.
+        // Transposed grains (rate != 1) first resample the span into scratch, with
+        // read indices and coefficients computed once and shared by all channels.
+        const float rate_grain = pool.rate_grain[slot];
+        const bool status_transposed = (rate_grain != 1.0f);
+        const uint32_t frame_source_first = address_start_frame + address_present_grain;
+        uint32_t frame_run_skip = 0;
+        uint32_t frames_source_run = 0;
+        uint32_t frame_tap_first = 0;
+        uint32_t frames_tap_span = 0;
+        uint32_t band_sinc = 0;
+        if (!status_transposed) {
+            frames_source_run = (frame_source_first < frames_source_total)
+                ? std::min<uint32_t>(frames_grain_process, frames_source_total - frame_source_first)
+                : 0;
+        } else if (target_object != -1) {
+            const struct_interpolation_run run = function_interpolation_prepare(
+                static_cast<double>(address_start_frame) + static_cast<double>(address_present_grain) * rate_grain,
+                rate_grain, frames_grain_process, mode_interpolation,
+                frames_source_total, frames_index, frames_coefficient);
+            frame_run_skip = run.frame_skip;
+            frames_source_run = run.frames_run;
+            frame_tap_first = run.frame_tap_first;
+            frames_tap_span = run.frames_tap_span;
+            band_sinc = run.band_sinc;
+        }
 
-            if (frame_grain_audio >= global_AudioFileData.frames_total) {
-                continue; 
+        // Add one source channel of this grain's run into one output channel
+        auto function_accumulate_channel = [&](uint16_t ifile_ch, UInt32 ioutput_ch) {
+            const float* source_run;
+            if (!status_transposed) {
+                source_run = function_bank_span(source_grain, ifile_ch, frame_source_first, frames_source_run, frames_stream);
+            } else {
+                const uint32_t stride_coefficient = (mode_interpolation == kinterpolation_hermite) ? 4 : 1;
+                function_interpolate_channel(function_bank_span(source_grain, ifile_ch, frame_tap_first, frames_tap_span, frames_stream),
+                                             frames_index + frame_run_skip,
+                                             frames_coefficient + frame_run_skip * stride_coefficient,
+                                             mode_interpolation,
+                                             band_sinc,
+                                             frames_source_run,
+                                             frames_resampled);
+                source_run = frames_resampled;
             }
+            function_accumulate(mix + mixIndex(ioutput_ch, frame_block_onset + frame_run_skip),
+                                source_run,
+                                frames_weight + frame_run_skip,
+                                frames_source_run);
+        };
 
-            for (uint16_t process_ch = 0; process_ch < global_AudioFileData.channels_file; ++process_ch) {
-                normal_sample_channel[process_ch] = global_AudioFileData.samples[process_ch][frame_grain_audio];
+        if (target_object != -1 && frames_source_run > 0) {  // -1 is a silent grain: it only advances
+            // Envelope x gain for the whole run (fixed-point phase, interpolated table read)
+            for (uint32_t count_frame_process = frame_run_skip; count_frame_process < frame_run_skip + frames_source_run; ++count_frame_process) {
+                float frame_env = function_envelope_lookup(frames_gain_envelope,
+                                                           phase_envelope + count_frame_process * increment_envelope);
+                frames_weight[count_frame_process] = kWetGain * (frame_env * grain_base_gain);
             }
 
-            uint32_t env_idx = ((element_grain.address_present_grain + count_frame_process) * (kframes_envelope - 1))
-                                / element_grain.frames_grain;
-            if (env_idx >= kframes_envelope) env_idx = kframes_envelope - 1; 
-            float frame_env = element_grain.frames_gain_envelope[env_idx];
-
-
-            if (element_grain.target_object == -1) {
-             
-                continue;
-            } else if (element_grain.target_object == -2) {
-             
+            if (target_object == -2) {
+                // All channels: each output channel takes its matching file channel
                 for (UInt32 process_ch = 0; process_ch < outChannels; ++process_ch) {
-                    size_t idx = mixIndex(process_ch, count_frame_process);
-                    uint16_t file_ch = process_ch % global_AudioFileData.channels_file;
-                    mix[idx] += kWetGain * (normal_sample_channel[file_ch] * (frame_env * grain_base_gain));
+                    uint16_t file_ch = process_ch % channels_source;
+                    function_accumulate_channel(file_ch, process_ch);
                 }
             } else {
                 // ========================================================================
@@ -1453,29 +5173,29 @@ static OSStatus function_callback_audio(void* ibox_audio,
                 //
                 // CURRENT: Using standard mapping (no rotation/shift applied)
                 // ========================================================================
-                
+        
                 // LIVE CHANNEL MAPPING - map sequence channels to current object assignments
                 UInt32 target_ch;
-                
+        
                 // Map existing sequence values to current object assignments
-                if (element_grain.target_object == (g_original_sequence_channels[0] + 1)) {  // Your sequence Object 1 -> Current Object 1 channel
+                if (target_object == (g_original_sequence_channels[0] + 1)) {  // Your sequence Object 1 -> Current Object 1 channel
                     target_ch = garray_channel_anchor[0];
-                } else if (element_grain.target_object == (g_original_sequence_channels[1] + 1)) {  // Your sequence Object 2 -> Current Object 2 channel
+                } else if (target_object == (g_original_sequence_channels[1] + 1)) {  // Your sequence Object 2 -> Current Object 2 channel
                     target_ch = garray_channel_anchor[1];
-                } else if (element_grain.target_object == (g_original_sequence_channels[2] + 1)) {  // Your sequence Object 3 -> Current Object 3 channel
+                } else if (target_object == (g_original_sequence_channels[2] + 1)) {  // Your sequence Object 3 -> Current Object 3 channel
                     target_ch = garray_channel_anchor[2];
-                } else if (element_grain.target_object == 1) {  // Also support sequence "1" -> Object 1
+                } else if (target_object == 1) {  // Also support sequence "1" -> Object 1
                     target_ch = garray_channel_anchor[0];
-                } else if (element_grain.target_object == 2) {  // Also support sequence "2" -> Object 2
+                } else if (target_object == 2) {  // Also support sequence "2" -> Object 2
                     target_ch = garray_channel_anchor[1];
-                } else if (element_grain.target_object == 3) {  // Also support sequence "3" -> Object 3
+                } else if (target_object == 3) {  // Also support sequence "3" -> Object 3
                     target_ch = garray_channel_anchor[2];
                 } else {
                     // Direct mapping for all other sequence numbers
-                    target_ch = static_cast<UInt32>(element_grain.target_object - 1);
+                    target_ch = static_cast<UInt32>(target_object - 1);
                 }
 
-             
+     
                 // ========================================================================
                 // =================== NEW: APPLY CHANNEL OFFSET ========================
                 // ========================================================================
@@ -1485,476 +5205,2382 @@ static OSStatus function_callback_audio(void* ibox_audio,
                 // final_target_ch = actual hardware channel to output to
                 // Example: target_ch=1, g_channel_offset=4 → final_target_ch=5
                 UInt32 final_target_ch = target_ch + g_channel_offset;
-                
+        
                 // Make sure the shifted channel doesn't exceed available hardware channels
                 if (final_target_ch < outChannels) {
-                    // Calculate which element of the mix array to write to
-                    // mixIndex() converts (channel, frame) to array position
-                    size_t idx = mixIndex(final_target_ch, count_frame_process);
-                    
                     // Use the original target_ch for file channel mapping (no offset here)
                     // This keeps the audio content mapping correct
-                    uint16_t file_ch = target_ch % global_AudioFileData.channels_file;
-                    
-                    // Add the processed grain audio to the output mix
-                    // kWetGain = volume level, frame_env = grain envelope, grain_base_gain = grain volume
-                    mix[idx] += kWetGain * (normal_sample_channel[file_ch] * (frame_env * grain_base_gain));
+                    uint16_t file_ch = target_ch % channels_source;
+
+                    // Add the processed grain audio to the output mix, one contiguous run
+                    // frames_weight = grain envelope x grain volume x kWetGain
+                    function_accumulate_channel(file_ch, final_target_ch);
                 }
                 // ========================================================================
             }
         }
 
-        element_grain.address_present_grain += frames_grain_process;
+        address_present_grain += frames_grain_process;
+        phase_envelope += frames_grain_process * increment_envelope;
+        pool.frames_delay_onset[slot] = 0;
+
+        if (address_present_grain >= frames_grain) {
+            function_grain_retire(index_active);  // Last active grain moves into this index
+        } else {
+            ++index_active;
+        }
+    }
+    } // End grain processing
+
+    if (g_run_channel_order_test && g_output_channels > 0) { 
+
+        uint32_t block = g_test_frames_per_channel + g_test_silence_frames;
+
+        for (UInt32 fr = 0; fr < icount_frames; ++fr) {
+
+            uint32_t sine_frames_behind = g_test_frame_cursor + fr;
+
+            uint32_t channel_now = (block > 0) ? (sine_frames_behind / block) : 0; 
+
+            if (channel_now >= g_output_channels) { 
+                g_run_channel_order_test = false; 
+                gstatus_mute_toanchors = true;
+                break; 
+            }
+
+            uint32_t within = (block > 0) ? (sine_frames_behind % block) : 0;
+
+            for (UInt32 ch = 0; ch < outChannels; ++ch) {
+
+                float amp = 0.0f;
+// NEED TO TEST >
+                // ========================================================================
+                // ============= NEW: APPLY CHANNEL OFFSET TO SINE TEST ==================
+                // ========================================================================
+                // The channel order test (sine waves) also needs to use the offset
+                // so users hear the test on the same channels their grains will use
+                // channel_now = logical test channel (0,1,2,3,4,5...)
+                // g_channel_offset = shift amount (0 or 4)
+                // test_channel_with_offset = actual hardware channel for sine test
+                UInt32 test_channel_with_offset = channel_now + g_channel_offset;
+                
+                // Only play sine tone if current output channel matches the test channel
+                if (ch == test_channel_with_offset && within < g_test_frames_per_channel) {
+                // ========================================================================
+
+                    float freq = g_test_base_freq + static_cast<float>(channel_now) * g_test_freq_step;
+                    
+                 
+                    float phase = (channel_now < g_test_phase.size()) ? g_test_phase[channel_now] : 0.0f;
+
+                    float inc = static_cast<float>(2.0 * M_PI * freq / g_output_sample_rate);
+
+                    amp = g_test_gain * std::sin(phase);
+  
+
+                    phase += inc;
+                    
+                    if (phase > 2.0f * static_cast<float>(M_PI)) phase -= 2.0f * static_cast<float>(M_PI);
+
+           
+                    if (channel_now < g_test_phase.size()) g_test_phase[channel_now] = phase;
+                }
+
+                mix[mixIndex(ch, fr)] = amp;
+            }
+        }
+
+        g_test_frame_cursor += icount_frames;
+    }
+
+    // Output channel trims and mutes (ramped), ahead of the limiter so it sees what the speakers get.
+    // The channel order test plays through regardless, so every speaker can still be identified.
+    if (!g_run_channel_order_test) function_channel_gain_process(mix, outChannels, icount_frames);
+
+    // Linked look-ahead limiter over the whole bus (adds function_limiter_latency() frames)
+    function_limiter_process(mix, outChannels, icount_frames);
+}
+
+/**
+ * High-Performance Real-Time Audio Processing Callback
+ * 
+ * This is the heart of the granular synthesis engine, called by Core Audio at
+ * regular intervals to generate audio in real-time. This function must execute
+ * with extremely low latency and high reliability, as any delays or errors will
+ * cause audio dropouts.
+ * 
+ * The host block is assembled from fixed processing quanta (see PROCESSING
+ * QUANTUM and function_render_quantum); this function only moves quanta
+ * through the FIFO and converts the assembled block to the device format.
+ *
+ * TECHNICAL CHALLENGES SOLVED:
+ * • Lock-free programming for real-time thread safety
+ * • Efficient memory management without dynamic allocation
+ * • Multi-channel audio routing with flexible channel mapping
+ * • Calculated grain envelope processing
+ * • Sample-accurate timing and synchronization
+ * 
+ * PERFORMANCE CHARACTERISTICS:
+ * - Executes in high-priority real-time audio thread
+ * - Must complete processing within ~10ms buffer periods
+ * - Zero dynamic memory allocation for stability
+ * - Optimized mathematical operations for efficiency
+ * 
+ * @param ibox_audio User data pointer (AudioFileData structure)
+ * @param ioget_flag Audio unit render action flags
+ * @param struct_istamp_time Precise timing information for synchronization
+ * @param iget_bus Audio unit bus number (typically 0)
+ * @param icount_frames Number of audio frames to process this callback
+ * @param struct_ioData_period_buffer Output audio buffer list for all channels
+ * @return OSStatus indicating success (noErr) or error condition
+ */
+static OSStatus function_callback_audio(void* ibox_audio,
+                                        AudioUnitRenderActionFlags* ioget_flag,
+                                        const AudioTimeStamp* struct_istamp_time, 
+                                        UInt32 iget_bus,
+                                        UInt32 icount_frames,
+                                        AudioBufferList* struct_ioData_period_buffer) { 
+
+    struct_callback_allocation_scope scope_allocation_guard;
+
+    UInt32 numBuffers = struct_ioData_period_buffer->mNumberBuffers;
+    UInt32 outChannels = (numBuffers == 1)
+        ? struct_ioData_period_buffer->mBuffers[0].mNumberChannels
+        : numBuffers;
+    UInt32 inChannels = global_AudioFileData.channels_file;
+    UInt32 minChannels = std::min(outChannels, inChannels);
+    const bool isNonInterleaved = g_output_non_interleaved ? true : (numBuffers > 1);
+
+    for (UInt32 buffer_willempty = 0; buffer_willempty < struct_ioData_period_buffer->mNumberBuffers; ++buffer_willempty)
+        std::memset(struct_ioData_period_buffer->mBuffers[buffer_willempty].mData,
+                    0,
+                    struct_ioData_period_buffer->mBuffers[buffer_willempty].mDataByteSize);
+
+    // Preallocated planar bus: never allocate here. A block that does not fit
+    // is left silent (buffers were cleared above) and handed to the control thread.
+    if (outChannels > global_MixBus.channels_capacity_mix || icount_frames > global_MixBus.frames_capacity_mix) {
+        g_mix_bus_request_channels.store(outChannels);
+        g_mix_bus_request_frames.store(icount_frames);
+        g_mix_bus_resize_pending.store(true);
+        return noErr;
+    }
+    
+    // Host block from fixed quanta: drain the FIFO, render a new quantum whenever it runs dry
+    float* mix = global_MixBus.frames_mix.data();
+    const float* frames_quantum = global_MixBus.frames_quantum.data();
+    const UInt32 frames_per_quantum = global_MixBus.frames_per_quantum;
+    if (global_MixBus.channels_quantum != outChannels) {
+        function_quantum_fifo_reset();   // Device channel count changed: the pending quantum no longer fits
+        global_MixBus.channels_quantum = outChannels;
+    }
+    for (UInt32 frame_host = 0; frame_host < icount_frames;) {
+        if (global_MixBus.frames_quantum_read == frames_per_quantum) {
+            function_render_quantum(outChannels, frames_per_quantum);
+            global_MixBus.frames_quantum_read = 0;
+        }
+        const UInt32 frames_copy = std::min(frames_per_quantum - global_MixBus.frames_quantum_read, icount_frames - frame_host);
+        for (UInt32 ch = 0; ch < outChannels; ++ch) {
+            std::memcpy(mix + static_cast<size_t>(ch) * icount_frames + frame_host,
+                        frames_quantum + static_cast<size_t>(ch) * frames_per_quantum + global_MixBus.frames_quantum_read,
+                        frames_copy * sizeof(float));
+        }
+        global_MixBus.frames_quantum_read += frames_copy;
+        frame_host += frames_copy;
+    }
+
+    // Clamp, scale and convert the bus into the device buffers (kernel chosen at format negotiation)
+    const function_output_t function_output = isNonInterleaved ? g_output_dispatch.function_planar
+                                                               : g_output_dispatch.function_interleaved;
+    function_output(mix, outChannels, icount_frames, struct_ioData_period_buffer);
+
+    return noErr;
+}
+
+
+
+
+
+
+
+
+/**
+ * Takes a backend's negotiated stream as the engine's device format: picks
+ * the output kernel and sizes the mix bus (and limiter) for the largest
+ * block the device will request. Call with the device stopped.
+ */
+void function_engine_adopt_format(const struct_backend_format& iformat, UInt32 ichannels_source) {
+    g_output_is_float = iformat.is_float;
+    g_output_non_interleaved = iformat.non_interleaved;
+    g_output_channels = iformat.channels;
+    g_output_bits_per_channel = iformat.bits;
+    g_output_sample_rate = iformat.rate;
+    function_output_select();
+    function_mix_bus_prepare(std::max<UInt32>(iformat.channels, ichannels_source),
+                             iformat.frames_block_max ? iformat.frames_block_max : kframes_default_slice);
+    function_limiter_report();
+    function_quantum_report();
+}
+
+#ifndef GRANULAR_HEADLESS
+
+
+
+
+// =============================================================================
+// PLAY AUDIO FILE FUNCTION
+// =============================================================================
+void playAudioFile(const std::string& name_file, 
+                   UInt32 selection_device, 
+                   const struct_wav_format& format_file, // parsed and validated header (function_wav_parse)
+                   std::ifstream& file) {
+    const uint16_t channels_file = format_file.channels_file;
+    const uint32_t rate_samples = format_file.rate_samples;
+    const uint16_t bits_sample = format_file.bits_sample;
+    const uint16_t audio_format = format_file.format_tag; // audio format from WAV file (1=PCM, 3=IEEE float)
+
+    // Open the device at its own rate; a file at another rate is resampled once at load
+    const struct_audio_backend& backend = global_BackendCoreAudio;
+    struct_backend_format format_stream;
+    format_stream.id_device = selection_device;
+    format_stream.rate = rate_samples;
+    format_stream.channels = channels_file;
+    if (!backend.function_open(format_stream, function_callback_audio, &global_AudioFileData)) {
+        return;
+    }
+
+    // The data chunk was located by function_wav_parse
+    std::cout << "Data Chunk ID detected.\n\n";
+
+    std::cout << "Device output channels: " << format_stream.channels << std::endl;
+    function_engine_adopt_format(format_stream, channels_file);
+
+    triggerChannelOrderTest(g_test_frames_per_channel,
+                            g_test_silence_frames,
+                            g_test_base_freq,
+                            g_test_freq_step);
+
+    global_AudioFileData.file = &file;
+    global_AudioFileData.bytes_total_read_file = static_cast<uint32_t>(format_file.address_data);
+    global_AudioFileData.bytes_chunk_audio = format_file.bytes_data;
+    global_AudioFileData.address_first_audio = format_file.address_data;
+
+    global_AudioFileData.channels_file     = channels_file;
+
+    global_AudioFileData.present_frame     = 0;
+    global_AudioFileData.file_is_ieee_float = (audio_format == 3);
+
+    // Grain lengths, intervals and jitter are engine-rate frames, so the source is converted to the engine rate
+    const uint32_t rate_engine = static_cast<uint32_t>(std::lround(g_output_sample_rate));
+    if (rate_engine != rate_samples) {
+        std::cout << "\nThe file is " << rate_samples << " Hz and the engine runs at " << rate_engine << " Hz.\n";
+        std::cout << "Resampling quality (1 = draft, 2 = standard, 3 = high): ";
+        int selection_quality = kresample_standard + 1;
+        if (!(std::cin >> selection_quality) || selection_quality < 1 || selection_quality > kcount_resample_qualities) {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            selection_quality = kresample_standard + 1;
+        }
+        g_resample_quality = selection_quality - 1;
+        std::cout << "Resampling with " << garray_resample_qualities[g_resample_quality].name_quality << " quality.\n";
+    }
+
+    // Extra sources go through the same pipeline first, since it borrows global_AudioFileData
+    if (!g_names_bank.empty()) {
+        function_source_bank_load(g_names_bank, rate_engine);
+    }
+    function_resampler_prepare(rate_samples, rate_engine, g_resample_quality, global_Resampler);
+
+    // Map the data chunk: in place for mono float, block-converted to planar otherwise.
+    // Sources whose planar size exceeds the resident limit stream from disk instead.
+    // Either way frames_total comes from the bytes actually present, at the engine rate.
+    if (!function_source_open(name_file, format_file)) {
+        backend.function_close();
+        return;
+    }
+
+    global_ProcessGrain.frames_object_grain = 2048;
+    global_ProcessGrain.frames_common_grains = 3;
+    global_ProcessGrain.frames_until_onset = 0.0;
+    function_grain_pool_reset();
+
+    std::cout << "Calling audio into units.\n";
+
+    if (!backend.function_start()) {
+        return;
+    } else {
+        std::cout << "Output playback starts.\n";
+    }
+
+    std::cout << "Listening for channel order test...\n";
+    while (g_run_channel_order_test) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    std::cout << "Channel test complete!\n\n";
+    
+    // ========================================================================
+    // ============ NEW: POST-SINE-TEST SUBWOOFER ANALYSIS MESSAGE ============
+    // ========================================================================
+    // After users have heard the sine test, help them interpret what they heard
+    // This is more accurate than just assuming based on channel count
+    if (g_output_channels == 6) {
+        std::cout << "📊 SINE TEST ANALYSIS (6-channel system detected):\n";
+        std::cout << "Based on standard 5.1 surround conventions, Channel 4 is typically LFE (subwoofer).\n";
+        std::cout << "If you noticed that Channel 4 sounded different (bass-heavy, no sound, or\n";
+        std::cout << "only low frequencies), it's likely the LFE/subwoofer channel.\n";
+        std::cout << "💡 TIP: For spatial granular synthesis, consider using channels 1,2,3,5,6\n";
+        std::cout << "to avoid unintended subwoofer effects in your grain sequences.\n\n";
+    }
+    // ========================================================================
+    
+    // ========================================================================
+    // ========== COMMENTED OUT: CHANNEL OFFSET SETUP FUNCTION CALL ==========
+    // ========================================================================
+    // ISSUE: This was calling the channel rotation interface when we only want
+    // the subwoofer warning (which appears in setupGrainHopping function)
+    // SOLUTION: Comment out this call to disable rotation/shifting interface
+    // NOTE: The subwoofer warning still appears in setupGrainHopping()
+    // setupChannelOffset();  // COMMENTED OUT - rotation interface disabled
+    // ========================================================================
+    
+    function_anchor_configure(g_output_channels);
+
+    g_status_audio_playback = false;
+    
+    setupGrainHopping();
+    
+    // THE AUDIO PLAYBACK IS MONITORED AT THE INTERACTIVE FUNCTION NOW
+    // Instead of exiting exactly when the audio time has passed, the audio starts outputting silence
+    // File reader stops at the end of audio chunk before callback continues to loop in silence (0.0f)
+
+    // std::this_thread::sleep_for(std::chrono::seconds(bytes_chunk_audio/(channels_file*((rate_samples)*(bits_sample/8)))));
 
-        if (element_grain.address_present_grain >= element_grain.frames_grain) {
-            element_grain.status_callback_grain = false;
-            --global_ProcessGrain.active_envelopes_grain;
-        }
+    // Start live control monitoring instead of just waiting for audio to finish
+    std::cout << "\nAudio starting:";
+    std::cout << "Live controls:\n\n";
+        flive_control_monitor(backend, file, channels_file,
+                       rate_samples, bits_sample, audio_format, selection_device);
+
+    backend.function_close();
+    function_stream_close();
+    function_source_release();
+    function_source_bank_release();
+    std::cout << "Stopped and disposed audio unit.\n\n";
+}
+#endif // GRANULAR_HEADLESS
+
+// =============================================================================
+// BENCHMARK HARNESS
+// =============================================================================
+
+/**
+ * ENGINE BENCHMARKS (build with -DGRANULAR_BENCHMARK)
+ *
+ * Benchmark builds skip device selection and the interactive setup: main()
+ * runs these measurements against a synthetic source and exits. Every
+ * measurement drives the real function_callback_audio with a synthetic
+ * non-interleaved float buffer list, so the numbers include the whole
+ * render path, not just an isolated loop.
+ */
+#ifdef GRANULAR_BENCHMARK
+
+constexpr UInt32 kbenchmark_channels = 6;
+constexpr UInt32 kbenchmark_block_frames = 256;
+constexpr uint32_t kbenchmark_source_frames = 1u << 20;
+
+struct struct_benchmark_output {
+    std::vector<float> frames_output;          // Planar device buffers, one block per channel
+    std::vector<unsigned char> bytes_list;     // Storage for an AudioBufferList with one buffer per channel
+    AudioBufferList* list;
+};
+
+void function_benchmark_prepare_output(struct_benchmark_output& ioutput, UInt32 ichannels, UInt32 iframes) {
+    ioutput.frames_output.assign(static_cast<size_t>(ichannels) * iframes, 0.0f);
+    ioutput.bytes_list.assign(sizeof(AudioBufferList) + ichannels * sizeof(AudioBuffer), 0);
+    ioutput.list = reinterpret_cast<AudioBufferList*>(ioutput.bytes_list.data());
+    ioutput.list->mNumberBuffers = ichannels;
+    for (UInt32 ch = 0; ch < ichannels; ++ch) {
+        ioutput.list->mBuffers[ch].mNumberChannels = 1;
+        ioutput.list->mBuffers[ch].mDataByteSize = iframes * sizeof(float);
+        ioutput.list->mBuffers[ch].mData = ioutput.frames_output.data() + static_cast<size_t>(ch) * iframes;
     }
-    } // End grain processing
+}
 
-    if (g_run_channel_order_test && g_output_channels > 0) { 
+// Deterministic noise source and engine state shared by every benchmark
+void function_benchmark_prepare_engine(uint16_t ichannels, uint32_t iframes) {
+    std::mt19937 rng_source{1234u};
+    std::uniform_real_distribution<float> dist_source(-0.5f, 0.5f);
 
-        uint32_t block = g_test_frames_per_channel + g_test_silence_frames;
+    global_AudioFileData.channels_file = ichannels;
+    global_AudioFileData.frames_total = iframes;
+    global_AudioFileData.present_frame = 0;
+    global_AudioFileData.frames_planar.resize(static_cast<size_t>(ichannels) * iframes);
+    for (float& sample : global_AudioFileData.frames_planar) sample = dist_source(rng_source);
+    global_AudioFileData.samples.assign(ichannels, nullptr);
+    for (uint16_t ch = 0; ch < ichannels; ++ch)
+        global_AudioFileData.samples[ch] = global_AudioFileData.frames_planar.data() + static_cast<size_t>(ch) * iframes;
 
-        for (UInt32 fr = 0; fr < icount_frames; ++fr) {
+    function_shape_envelope();
+    function_shape_sinc_table();
+    function_kernel_select();
+    function_mix_bus_prepare(kbenchmark_channels, kframes_default_slice);
+
+    g_output_is_float = true;
+    g_output_non_interleaved = true;
+    g_output_channels = kbenchmark_channels;
+    g_output_bits_per_channel = 32;
+    function_output_select();
+    g_run_channel_order_test = false;
+    g_status_audio_playback = true;
+    g_use_grain_hopping = false;
 
-            uint32_t sine_frames_behind = g_test_frame_cursor + fr;
+    global_ProcessGrain.frames_object_grain = 2048;
+    function_grain_pool_reset();
+}
 
-            uint32_t channel_now = (block > 0) ? (sine_frames_behind / block) : 0; 
+// Fill the pool with icount grains (reading bank source isource_grain) that outlive the measurement; no new spawns
+void function_benchmark_fill_grains(uint32_t icount, uint16_t isource_grain = 0) {
+    function_grain_pool_reset();
+    g_grain_polyphony.store(icount);
+    global_AudioFileData.present_frame = 0;
+    global_ProcessGrain.frames_until_onset = std::numeric_limits<double>::max();
+
+    for (uint32_t count_grain = 0; count_grain < icount; ++count_grain) {
+        uint32_t slot = function_grain_acquire();
+        initialize_grain(slot, (count_grain * 37u) % 4096u, function_bank_frames(isource_grain) - 4096u, 1.0f, 0, 1.0f,
+                         isource_grain);
+    }
+}
 
-            if (channel_now >= g_output_channels) { 
-                g_run_channel_order_test = false; 
-                gstatus_mute_toanchors = true;
-                break; 
-            }
+// Average wall time of one callback block in nanoseconds
+double function_benchmark_time_callback(struct_benchmark_output& ioutput, uint32_t iblocks) {
+    AudioUnitRenderActionFlags flags_render = 0;
+    AudioTimeStamp stamp_time{};
 
-            uint32_t within = (block > 0) ? (sine_frames_behind % block) : 0;
+    function_callback_audio(&global_AudioFileData, &flags_render, &stamp_time, 0, kbenchmark_block_frames, ioutput.list);
 
-            for (UInt32 ch = 0; ch < outChannels; ++ch) {
+    auto time_start = std::chrono::steady_clock::now();
+    for (uint32_t count_block = 0; count_block < iblocks; ++count_block) {
+        function_callback_audio(&global_AudioFileData, &flags_render, &stamp_time, 0, kbenchmark_block_frames, ioutput.list);
+    }
+    auto time_end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(time_end - time_start).count() / iblocks;
+}
 
-                float amp = 0.0f;
-// NEED TO TEST >
-                // ========================================================================
-                // ============= NEW: APPLY CHANNEL OFFSET TO SINE TEST ==================
-                // ========================================================================
-                // The channel order test (sine waves) also needs to use the offset
-                // so users hear the test on the same channels their grains will use
-                // channel_now = logical test channel (0,1,2,3,4,5...)
-                // g_channel_offset = shift amount (0 or 4)
-                // test_channel_with_offset = actual hardware channel for sine test
-                UInt32 test_channel_with_offset = channel_now + g_channel_offset;
-                
-                // Only play sine tone if current output channel matches the test channel
-                if (ch == test_channel_with_offset && within < g_test_frames_per_channel) {
-                // ========================================================================
+/**
+ * LEGACY LAYOUT REFERENCE
+ * The array-of-structs grain record (4 KB envelope embedded in every grain)
+ * and the grain loop as it ran before the struct-of-arrays pool: a linear walk
+ * over every slot, a per-block heap mix, and the per-frame channel gather.
+ */
+struct struct_grain_legacy {
+    uint32_t address_start_frame;
+    uint32_t address_present_grain;
+    uint32_t frames_grain;
+    float gain_grain;
+    float frames_gain_envelope[1024];
+    bool status_callback_grain;
+    int target_object;
+};
 
-                    float freq = g_test_base_freq + static_cast<float>(channel_now) * g_test_freq_step;
-                    
-                 
-                    float phase = (channel_now < g_test_phase.size()) ? g_test_phase[channel_now] : 0.0f;
+void function_benchmark_legacy_block(std::vector<struct_grain_legacy>& igrains,
+                                     struct_benchmark_output& ioutput,
+                                     double iinterval_frames) {
+    const UInt32 outChannels = kbenchmark_channels;
+    const UInt32 icount_frames = kbenchmark_block_frames;
+    std::vector<float> mix(outChannels * icount_frames, 0.0f);
+    float normal_sample_channel[16];
 
-                    float inc = static_cast<float>(2.0 * M_PI * freq / g_output_sample_rate);
+    for (struct_grain_legacy& element_grain : igrains) {
+        if (!element_grain.status_callback_grain)
+            continue;
 
-                    amp = g_test_gain * std::sin(phase);
-  
+        uint32_t frames_grain_ahead = element_grain.frames_grain - element_grain.address_present_grain;
+        double N_eff = std::max(1.0, double(element_grain.frames_grain) / iinterval_frames);
+        float grain_base_gain = element_grain.gain_grain * (0.2f / (garray_envelope_tables[kenvelope_hann].envelope_rms * std::sqrt(N_eff)));
+        uint32_t frames_grain_process = std::min<uint32_t>(icount_frames, frames_grain_ahead);
 
-                    phase += inc;
-                    
-                    if (phase > 2.0f * static_cast<float>(M_PI)) phase -= 2.0f * static_cast<float>(M_PI);
+        for (uint32_t count_frame_process = 0; count_frame_process < frames_grain_process; ++count_frame_process) {
+            uint32_t frame_grain_audio = element_grain.address_start_frame + element_grain.address_present_grain + count_frame_process;
+            if (frame_grain_audio >= global_AudioFileData.frames_total) continue;
 
-           
-                    if (channel_now < g_test_phase.size()) g_test_phase[channel_now] = phase;
-                }
+            for (uint16_t process_ch = 0; process_ch < global_AudioFileData.channels_file; ++process_ch)
+                normal_sample_channel[process_ch] = global_AudioFileData.samples[process_ch][frame_grain_audio];
 
-                mix[mixIndex(ch, fr)] = amp;
+            uint32_t env_idx = ((element_grain.address_present_grain + count_frame_process) * (kframes_envelope - 1)) / element_grain.frames_grain;
+            if (env_idx >= kframes_envelope) env_idx = kframes_envelope - 1;
+            float frame_env = element_grain.frames_gain_envelope[env_idx];
+
+            for (UInt32 process_ch = 0; process_ch < outChannels; ++process_ch) {
+                size_t idx = static_cast<size_t>(process_ch) * icount_frames + count_frame_process;
+                mix[idx] += normal_sample_channel[process_ch % global_AudioFileData.channels_file] * (frame_env * grain_base_gain);
             }
         }
+        element_grain.address_present_grain += frames_grain_process;
+    }
 
-        g_test_frame_cursor += icount_frames;
+    for (UInt32 ch = 0; ch < outChannels; ++ch) {
+        float* address_buffer = static_cast<float*>(ioutput.list->mBuffers[ch].mData);
+        for (UInt32 fr = 0; fr < icount_frames; ++fr)
+            address_buffer[fr] = std::clamp(mix[static_cast<size_t>(ch) * icount_frames + fr], -1.0f, 1.0f);
     }
+}
 
-    if (g_output_is_float) {
-        if (isNonInterleaved) {
-            for (UInt32 ch = 0; ch < outChannels; ++ch) {
-                float* address_buffer = static_cast<float*>(struct_ioData_period_buffer->mBuffers[ch].mData);
+void function_benchmark_grain_layout(struct_benchmark_output& ioutput) {
+    std::cout << "Grain pool layout: legacy array-of-structs vs struct-of-arrays ("
+              << kbenchmark_channels << " channels, " << kbenchmark_block_frames << "-frame blocks)\n";
+
+    const uint32_t array_counts[] = {8, 128, 1024};
+    for (uint32_t count_grains : array_counts) {
+        const uint32_t blocks = std::min<uint32_t>(3000, std::max<uint32_t>(50, 200000 / count_grains));
+        const double interval_frames = double(global_ProcessGrain.frames_object_grain) * double(g_interval_multiplier);
+
+        // Legacy: the fixed 128-slot pool (or larger when more grains are live)
+        std::vector<struct_grain_legacy> grains_legacy(std::max<uint32_t>(128, count_grains));
+        for (uint32_t count_grain = 0; count_grain < count_grains; ++count_grain) {
+            struct_grain_legacy& grain = grains_legacy[count_grain];
+            grain.address_start_frame = (count_grain * 37u) % 4096u;
+            grain.address_present_grain = 0;
+            grain.frames_grain = global_AudioFileData.frames_total - 4096u;
+            grain.gain_grain = 1.0f;
+            std::copy_n(garray_envelope_tables[kenvelope_hann].frames_envelope, kframes_envelope, grain.frames_gain_envelope);
+            grain.status_callback_grain = true;
+            grain.target_object = -2;
+        }
+        auto time_start = std::chrono::steady_clock::now();
+        for (uint32_t count_block = 0; count_block < blocks; ++count_block)
+            function_benchmark_legacy_block(grains_legacy, ioutput, interval_frames);
+        auto time_end = std::chrono::steady_clock::now();
+        double ns_legacy = std::chrono::duration<double, std::nano>(time_end - time_start).count() / blocks;
 
+        function_benchmark_fill_grains(count_grains);
+        double ns_pool = function_benchmark_time_callback(ioutput, blocks);
 
-                if (g_run_channel_order_test || function_channel_chosen(ch, outChannels)) {
-                    for (UInt32 fr = 0; fr < icount_frames; ++fr) {
-                        address_buffer[fr] = std::clamp(mix[mixIndex(ch, fr)], -1.0f, 1.0f);
-                    }
-                } else {
-                    for (UInt32 fr = 0; fr < icount_frames; ++fr) {
-                        address_buffer[fr] = 0.0f;
-                    }
-                }
+        std::cout << "  " << count_grains << " grains: legacy " << ns_legacy / 1000.0 << " us/block, "
+                  << "pool " << ns_pool / 1000.0 << " us/block (x" << (ns_legacy / ns_pool) << ")\n";
+    }
+}
+
+/**
+ * KERNEL VERIFICATION AND THROUGHPUT
+ * Every variant the CPU can run must match the scalar reference bit for bit
+ * (including odd tail lengths); the run fails otherwise. Throughput is
+ * reported as nanoseconds per 256-frame accumulation.
+ */
+bool function_benchmark_kernels() {
+    std::vector<struct_kernel_dispatch> array_variants = {{"scalar", function_kernel_accumulate_scalar}};
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))    array_variants.push_back({"SSE2", function_kernel_accumulate_sse2});
+    if (__builtin_cpu_supports("avx2"))    array_variants.push_back({"AVX2", function_kernel_accumulate_avx2});
+    if (__builtin_cpu_supports("avx512f")) array_variants.push_back({"AVX-512", function_kernel_accumulate_avx512});
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+    array_variants.push_back({"NEON", function_kernel_accumulate_neon});
+#endif
+
+    std::mt19937 rng_kernel{99u};
+    std::uniform_real_distribution<float> dist_kernel(-1.0f, 1.0f);
+    const uint32_t kframes_kernel = 1027;  // Not a multiple of any vector width: exercises every tail
+    std::vector<float> frames_source(kframes_kernel), frames_weight(kframes_kernel), frames_mix_start(kframes_kernel);
+    for (uint32_t fr = 0; fr < kframes_kernel; ++fr) {
+        frames_source[fr] = dist_kernel(rng_kernel);
+        frames_weight[fr] = dist_kernel(rng_kernel);
+        frames_mix_start[fr] = dist_kernel(rng_kernel);
+    }
+
+    std::vector<float> frames_reference = frames_mix_start;
+    function_kernel_accumulate_scalar(frames_reference.data(), frames_source.data(), frames_weight.data(), kframes_kernel);
+
+    bool status_match = true;
+    std::cout << "Grain accumulation kernels (selected: " << g_kernel_dispatch.name_isa << ")\n";
+    for (const struct_kernel_dispatch& variant : array_variants) {
+        std::vector<float> frames_result = frames_mix_start;
+        variant.function_accumulate(frames_result.data(), frames_source.data(), frames_weight.data(), kframes_kernel);
+        bool status_variant = std::memcmp(frames_result.data(), frames_reference.data(), kframes_kernel * sizeof(float)) == 0;
+        status_match = status_match && status_variant;
+
+        const uint32_t repeats = 200000;
+        std::vector<float> frames_timed = frames_mix_start;
+        auto time_start = std::chrono::steady_clock::now();
+        for (uint32_t count_repeat = 0; count_repeat < repeats; ++count_repeat)
+            variant.function_accumulate(frames_timed.data(), frames_source.data(), frames_weight.data(), 256);
+        auto time_end = std::chrono::steady_clock::now();
+
+        std::cout << "  " << variant.name_isa << ": " << (status_variant ? "bit-exact" : "MISMATCH") << ", "
+                  << std::chrono::duration<double, std::nano>(time_end - time_start).count() / repeats
+                  << " ns per 256 frames (checksum " << frames_timed[7] << ")\n";
+    }
+    return status_match;
+}
+
+/**
+ * OUTPUT CONVERSION KERNELS
+ * All six (sample type, layout) kernels convert a 16-channel bus with
+ * out-of-range peaks and an odd frame count, and must match a per-sample
+ * scalar reference bit for bit. Each is timed against that reference, which
+ * branches on the format per sample like the old callback tail. The kernels
+ * are called directly: integer streams normally reach them through the
+ * requantizer, which has its own benchmark.
+ */
+void function_benchmark_output_reference(const float* imix, UInt32 ichannels, UInt32 icount_frames, bool iis_float,
+                                         UInt32 ibits, bool iis_interleaved, AudioBufferList* oiobuffers) {
+    for (UInt32 ch = 0; ch < ichannels; ++ch) {
+        for (UInt32 fr = 0; fr < icount_frames; ++fr) {
+            const float sample = imix[static_cast<size_t>(ch) * icount_frames + fr];
+            const size_t index_buffer = iis_interleaved ? 0 : ch;
+            const size_t index_sample = iis_interleaved ? static_cast<size_t>(fr) * ichannels + ch : fr;
+            void* destination = oiobuffers->mBuffers[index_buffer].mData;
+            if (iis_float) {
+                static_cast<float*>(destination)[index_sample] = std::clamp(sample, -1.0f, 1.0f);
+            } else if (ibits == 16) {
+                static_cast<int16_t*>(destination)[index_sample] =
+                    static_cast<int16_t>(std::lrintf(std::clamp(sample, -1.0f, 1.0f) * kscale_output_int16));
+            } else {
+                static_cast<int32_t*>(destination)[index_sample] =
+                    static_cast<int32_t>(std::lrintf(std::clamp(sample * kscale_output_int32, -kscale_output_int32, klimit_output_int32)));
             }
-        } else {
-            float* address_buffer = static_cast<float*>(struct_ioData_period_buffer->mBuffers[0].mData);
-            for (UInt32 fr = 0; fr < icount_frames; ++fr) {
-                for (UInt32 ch = 0; ch < outChannels; ++ch) {
+        }
+    }
+}
 
-                    float v = function_channel_chosen(ch, outChannels) ? mix[mixIndex(ch, fr)] : 0.0f;
-                    address_buffer[fr * outChannels + ch] = std::clamp(v, -1.0f, 1.0f);
-                }
+bool function_benchmark_output_formats() {
+    struct struct_case_output { const char* name_case; bool is_float; UInt32 bits; bool is_interleaved; function_output_t function_output; };
+    const struct_case_output garray_cases[] = {
+        {"float32 planar", true, 32, false, function_output_convert<float, false>},
+        {"float32 interleaved", true, 32, true, function_output_convert<float, true>},
+        {"int16 planar", false, 16, false, function_output_convert<int16_t, false>},
+        {"int16 interleaved", false, 16, true, function_output_convert<int16_t, true>},
+        {"int32 planar", false, 32, false, function_output_convert<int32_t, false>},
+        {"int32 interleaved", false, 32, true, function_output_convert<int32_t, true>},
+    };
+    const UInt32 channels = 16;
+    const UInt32 frames = 509;   // Not a multiple of any vector width or the interleave chunk
+    const uint32_t repeats = 4000;
+
+    std::mt19937 rng_output{31u};
+    std::uniform_real_distribution<float> dist_output(-1.25f, 1.25f);
+    std::vector<float> frames_mix(static_cast<size_t>(channels) * frames);
+    for (float& sample : frames_mix) sample = dist_output(rng_output);
+    frames_mix[0] = 1.0f;   // Exact full scale: the int32 path must not wrap
+    frames_mix[1] = -1.0f;
+
+    const size_t bytes_all = static_cast<size_t>(channels) * frames * sizeof(int32_t);
+    std::vector<unsigned char> bytes_kernel(bytes_all), bytes_reference(bytes_all);
+    std::vector<unsigned char> bytes_list_kernel(sizeof(AudioBufferList) + channels * sizeof(AudioBuffer));
+    std::vector<unsigned char> bytes_list_reference(bytes_list_kernel.size());
+    AudioBufferList* list_kernel = reinterpret_cast<AudioBufferList*>(bytes_list_kernel.data());
+    AudioBufferList* list_reference = reinterpret_cast<AudioBufferList*>(bytes_list_reference.data());
+
+    bool status_all = true;
+    std::cout << "Output conversion kernels (" << channels << " ch x " << frames << " frames)\n";
+    for (const struct_case_output& output_case : garray_cases) {
+        const size_t bytes_sample = output_case.is_float ? 4 : output_case.bits / 8;
+        const UInt32 buffers = output_case.is_interleaved ? 1 : channels;
+        for (AudioBufferList* list : {list_kernel, list_reference}) {
+            unsigned char* bytes_base = (list == list_kernel) ? bytes_kernel.data() : bytes_reference.data();
+            list->mNumberBuffers = buffers;
+            for (UInt32 buffer = 0; buffer < buffers; ++buffer) {
+                list->mBuffers[buffer].mNumberChannels = output_case.is_interleaved ? channels : 1;
+                list->mBuffers[buffer].mDataByteSize = static_cast<UInt32>(frames * bytes_sample * list->mBuffers[buffer].mNumberChannels);
+                list->mBuffers[buffer].mData = bytes_base + static_cast<size_t>(buffer) * frames * bytes_sample;
             }
         }
-    } else {
-        if (isNonInterleaved) {
-            for (UInt32 ch = 0; ch < outChannels; ++ch) {
-                if (g_output_bits_per_channel == 16) {
-                    int16_t* address_buffer = static_cast<int16_t*>(struct_ioData_period_buffer->mBuffers[ch].mData);
-                   
-                    if (g_run_channel_order_test) {
-
-                        for (UInt32 fr = 0; fr < icount_frames; ++fr) {
-                            float v = std::clamp(mix[mixIndex(ch, fr)], -1.0f, 1.0f);
-                            address_buffer[fr] = static_cast<int16_t>(std::lrintf(v * 32767.0f));
-                        }
-                    } else if (function_channel_chosen(ch, outChannels)) {
+        std::fill(bytes_kernel.begin(), bytes_kernel.end(), 0);
+        std::fill(bytes_reference.begin(), bytes_reference.end(), 0);
+
+        const function_output_t function_output = output_case.function_output;
+        function_output(frames_mix.data(), channels, frames, list_kernel);
+        function_benchmark_output_reference(frames_mix.data(), channels, frames, output_case.is_float, output_case.bits,
+                                            output_case.is_interleaved, list_reference);
+        const bool status_case = std::memcmp(bytes_kernel.data(), bytes_reference.data(), bytes_all) == 0;
+        status_all = status_all && status_case;
+
+        auto time_start = std::chrono::steady_clock::now();
+        for (uint32_t count_repeat = 0; count_repeat < repeats; ++count_repeat) {
+            function_benchmark_output_reference(frames_mix.data(), channels, frames, output_case.is_float, output_case.bits,
+                                                output_case.is_interleaved, list_reference);
+        }
+        auto time_reference = std::chrono::steady_clock::now();
+        for (uint32_t count_repeat = 0; count_repeat < repeats; ++count_repeat) {
+            function_output(frames_mix.data(), channels, frames, list_kernel);
+        }
+        auto time_kernel = std::chrono::steady_clock::now();
+        const double ns_reference = std::chrono::duration<double, std::nano>(time_reference - time_start).count() / repeats;
+        const double ns_kernel = std::chrono::duration<double, std::nano>(time_kernel - time_reference).count() / repeats;
+        std::cout << "    " << output_case.name_case << ": " << (status_case ? "bit-exact" : "MISMATCH") << ", per-sample "
+                  << ns_reference / 1000.0 << " us, kernel " << ns_kernel / 1000.0 << " us per block (x"
+                  << ns_reference / ns_kernel << ")\n";
+    }
 
-                        for (UInt32 fr = 0; fr < icount_frames; ++fr) {
-                            float v = std::clamp(mix[mixIndex(ch, fr)], -1.0f, 1.0f);
-                            
-                            address_buffer[fr] = static_cast<int16_t>(std::lrintf(v * 32767.0f));
-                        }
-                    } else {
-                        for (UInt32 fr = 0; fr < icount_frames; ++fr) {
-                            address_buffer[fr] = 0;
-                        }
-                    }
-                } else {
-                    int32_t* address_buffer = static_cast<int32_t*>(struct_ioData_period_buffer->mBuffers[ch].mData);
-                    if (g_run_channel_order_test) {
+    return status_all;
+}
 
-                        for (UInt32 fr = 0; fr < icount_frames; ++fr) {
-                            float v = std::clamp(mix[mixIndex(ch, fr)], -1.0f, 1.0f);
-                            address_buffer[fr] = static_cast<int16_t>(std::lrintf(v * 32767.0f));
-                        }
-                    } else if (function_channel_chosen(ch, outChannels)) {
-                        for (UInt32 fr = 0; fr < icount_frames; ++fr) {
-                            float v = std::clamp(mix[mixIndex(ch, fr)], -1.0f, 1.0f);
-                            address_buffer[fr] = static_cast<int32_t>(std::lrintf(v * 2147483647.0f));
-                        }
-                    } else {
-                        for (UInt32 fr = 0; fr < icount_frames; ++fr) {
-                            address_buffer[fr] = 0;
-                        }
-                    }
-                }
+/**
+ * REQUANTIZATION
+ * The four-channel vector path and the scalar path must produce the same
+ * words from the same input and state. A -80 dBFS sine requantized to int16
+ * shows the distortion that rounding leaves at the 3rd harmonic (relative to
+ * the sine) and that TPDF dither removes, and each shaping filter is reported as its noise
+ * below 4 kHz against the flat TPDF floor. Round mode on an int32 stream
+ * must round each 24-bit word to nearest. Each mode's int16 block cost is
+ * timed against the per-sample rounding the callback used before.
+ */
+double function_benchmark_band_power(const std::vector<float>& isignal, double ifrequency_low, double ifrequency_high, double irate) {
+    // Mean Goertzel power over 16 frequencies in the band
+    double power_total = 0.0;
+    for (int index_bin = 0; index_bin < 16; ++index_bin) {
+        const double frequency = ifrequency_low + (ifrequency_high - ifrequency_low) * (index_bin + 0.5) / 16.0;
+        const double coefficient = 2.0 * std::cos(2.0 * M_PI * frequency / irate);
+        double state_first = 0.0, state_second = 0.0;
+        for (float sample : isignal) {
+            const double state_new = sample + coefficient * state_first - state_second;
+            state_second = state_first;
+            state_first = state_new;
+        }
+        power_total += state_first * state_first + state_second * state_second - coefficient * state_first * state_second;
+    }
+    return power_total / 16.0;
+}
+
+bool function_benchmark_requantize() {
+    const UInt32 channels = 16;
+    const UInt32 frames = 512;
+    const double rate = 48000.0;
+    function_mix_bus_prepare(channels, kframes_default_slice);
+    const int mode_saved = g_quantize_mode.load();
+
+    // Vector lanes against the scalar remainder: channel 4 repeats channel 0's input and state
+    std::mt19937 rng_quantize{41u};
+    std::uniform_real_distribution<float> dist_quantize(-1.1f, 1.1f);
+    const UInt32 channels_lanes = 5;
+    std::vector<float> samples_lanes(static_cast<size_t>(channels_lanes) * frames);
+    std::vector<int32_t> quantized_lanes(samples_lanes.size());
+    for (UInt32 fr = 0; fr < frames; ++fr) {
+        for (UInt32 ch = 0; ch < channels_lanes; ++ch) {
+            samples_lanes[static_cast<size_t>(fr) * channels_lanes + ch] = (ch == 4) ? samples_lanes[static_cast<size_t>(fr) * channels_lanes]
+                                                                                      : dist_quantize(rng_quantize);
+        }
+    }
+    bool status_lanes = true;
+    for (int mode = 0; mode < kcount_quantize_modes; ++mode) {
+        global_MixBus.state_dither[4] = global_MixBus.state_dither[0];
+        for (uint32_t tap = 0; tap < ktaps_shaping; ++tap) {
+            global_MixBus.error_shaping[tap * channels + 4] = global_MixBus.error_shaping[tap * channels];
+        }
+        function_requantize_block(samples_lanes.data(), channels_lanes, frames, garray_quantize_modes[mode], kscale_output_int16,
+                                  -32768.0f, 32767.0f, quantized_lanes.data());
+        for (UInt32 fr = 0; fr < frames; ++fr) {
+            status_lanes = status_lanes && quantized_lanes[static_cast<size_t>(fr) * channels_lanes] ==
+                                           quantized_lanes[static_cast<size_t>(fr) * channels_lanes + 4];
+        }
+    }
+    std::cout << "Requantization (int16)\n  vector and scalar paths: " << (status_lanes ? "bit-exact" : "MISMATCH") << "\n";
+
+    // Round mode on int32: the 24-bit word must be rounded to nearest, not truncated when the low byte is dropped
+    const UInt32 channels_round = 4, frames_round = 64;
+    const float garray_levels_round[channels_round] = {-2.0e-8f, 2.0e-8f, -1.0e-7f, 0.75f / 8388608.0f};   // -0.17, 0.17, -0.84, 0.75 LSB
+    std::vector<float> frames_round_mix(static_cast<size_t>(channels_round) * frames_round);
+    std::vector<int32_t> words_round(frames_round_mix.size());
+    for (UInt32 ch = 0; ch < channels_round; ++ch) {
+        std::fill_n(frames_round_mix.begin() + static_cast<size_t>(ch) * frames_round, frames_round, garray_levels_round[ch]);
+    }
+    std::vector<unsigned char> bytes_list_round(sizeof(AudioBufferList) + sizeof(AudioBuffer));
+    AudioBufferList* list_round = reinterpret_cast<AudioBufferList*>(bytes_list_round.data());
+    list_round->mNumberBuffers = 1;
+    list_round->mBuffers[0] = {channels_round, static_cast<UInt32>(words_round.size() * sizeof(int32_t)), words_round.data()};
+    g_quantize_mode.store(kquantize_round);
+    function_requantizer_reset();
+    function_output_requantize<int32_t, true>(frames_round_mix.data(), channels_round, frames_round, list_round);
+    bool status_round = true;
+    for (UInt32 fr = 0; fr < frames_round; ++fr) {
+        for (UInt32 ch = 0; ch < channels_round; ++ch) {
+            const int32_t word_expected = static_cast<int32_t>(static_cast<uint32_t>(std::lrintf(garray_levels_round[ch] * 8388608.0f)) << 8);
+            status_round = status_round && words_round[static_cast<size_t>(fr) * channels_round + ch] == word_expected;
+        }
+    }
+    std::cout << "  24-bit round mode: " << (status_round ? "rounded to nearest" : "TRUNCATED") << "\n";
+
+    // Spectra of a quiet 1 kHz sine through every mode (one second, mono)
+    const UInt32 frames_sine = 48000;
+    const float amplitude_sine = 1.0e-4f;   // -80 dBFS, about 3.3 LSB
+    std::vector<float> samples_sine(frames_sine);
+    for (UInt32 fr = 0; fr < frames_sine; ++fr) {
+        samples_sine[fr] = amplitude_sine * static_cast<float>(std::sin(2.0 * M_PI * 1000.0 * fr / rate));
+    }
+    std::vector<int32_t> quantized_sine(frames_sine);
+    std::vector<float> error_sine(frames_sine);
+    std::vector<float> scaled_sine(frames_sine);
+    for (UInt32 fr = 0; fr < frames_sine; ++fr) scaled_sine[fr] = samples_sine[fr] * kscale_output_int16;
+    const double power_fundamental = function_benchmark_band_power(scaled_sine, 999.75, 1000.25, rate);
+    double power_flat_band = 0.0;
+    for (int mode = 0; mode < kcount_quantize_modes; ++mode) {
+        function_requantizer_reset();
+        function_requantize_block(samples_sine.data(), 1, frames_sine, garray_quantize_modes[mode], kscale_output_int16,
+                                  -32768.0f, 32767.0f, quantized_sine.data());
+        for (UInt32 fr = 0; fr < frames_sine; ++fr) {
+            error_sine[fr] = static_cast<float>(quantized_sine[fr]) - samples_sine[fr] * kscale_output_int16;
+        }
+        const double power_harmonic = function_benchmark_band_power(error_sine, 2999.75, 3000.25, rate);
+        const double power_band = function_benchmark_band_power(error_sine, 100.0, 4000.0, rate);
+        if (mode == kquantize_tpdf) power_flat_band = power_band;
+        std::cout << "  " << garray_quantize_modes[mode].name_mode << ": 3rd harmonic "
+                  << 10.0 * std::log10((power_harmonic + 1e-12) / power_fundamental) << " dBc";
+        if (mode > kquantize_tpdf) {
+            std::cout << ", noise below 4 kHz " << 10.0 * std::log10(power_band / power_flat_band) << " dB vs flat TPDF";
+        }
+        std::cout << "\n";
+    }
+
+    // Block cost against the old per-sample rounding (16 ch x 512 frames, int16 interleaved)
+    std::vector<float> frames_mix(static_cast<size_t>(channels) * frames);
+    for (float& sample : frames_mix) sample = dist_quantize(rng_quantize) * 0.01f;
+    std::vector<int16_t> samples_output(frames_mix.size());
+    std::vector<unsigned char> bytes_list(sizeof(AudioBufferList) + sizeof(AudioBuffer));
+    AudioBufferList* list = reinterpret_cast<AudioBufferList*>(bytes_list.data());
+    list->mNumberBuffers = 1;
+    list->mBuffers[0] = {channels, static_cast<UInt32>(samples_output.size() * sizeof(int16_t)), samples_output.data()};
+    const uint32_t repeats = 4000;
+
+    auto time_start = std::chrono::steady_clock::now();
+    for (uint32_t count_repeat = 0; count_repeat < repeats; ++count_repeat) {
+        function_benchmark_output_reference(frames_mix.data(), channels, frames, false, 16, true, list);
+    }
+    const double ns_reference = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - time_start).count() / repeats;
+    bool status_cost = true;
+    std::cout << "  block cost (" << channels << " ch x " << frames << " frames): per-sample rounding " << ns_reference / 1000.0 << " us\n";
+    for (int mode = 0; mode < kcount_quantize_modes; ++mode) {
+        g_quantize_mode.store(mode);
+        time_start = std::chrono::steady_clock::now();
+        for (uint32_t count_repeat = 0; count_repeat < repeats; ++count_repeat) {
+            function_output_requantize<int16_t, true>(frames_mix.data(), channels, frames, list);
+        }
+        const double ns_mode = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - time_start).count() / repeats;
+        status_cost = status_cost && ns_mode < ns_reference;
+        std::cout << "    " << garray_quantize_modes[mode].name_mode << ": " << ns_mode / 1000.0 << " us\n";
+    }
+
+    g_quantize_mode.store(mode_saved);
+    function_mix_bus_prepare(kbenchmark_channels, kframes_default_slice);
+    if (!status_cost) std::cout << "  (a requantizer mode cost more than per-sample rounding)\n";
+    return status_lanes && status_round;
+}
+
+/**
+ * MASTER BUS LIMITER
+ * 16 channels of bursts up to +12 dBFS (plus a near-Nyquist tone whose
+ * inter-sample peaks exceed its samples) in 64-frame blocks at 48 kHz.
+ * The limited bus must stay under the ceiling by the true-peak estimate,
+ * a quiet bus must come out bit-identical after the reported latency, and
+ * the cost must stay under 2% of the block's real-time budget. The timed
+ * loop runs inside the callback's allocation scope.
+ */
+bool function_benchmark_limiter() {
+    const UInt32 channels = 16;
+    const UInt32 frames = 64;
+    const uint32_t blocks = 6000;   // 8 s
+    const double rate_saved = g_output_sample_rate;
+    g_output_sample_rate = 48000.0;
+    function_mix_bus_prepare(channels, kframes_default_slice);
+    const float ceiling = std::pow(10.0f, g_limiter_ceiling_db.load() / 20.0f);
+    const UInt32 frames_latency = function_limiter_latency();
+
+    // Loud program: noise bursts with a slow swell, channel 15 a tone at 0.45 x rate with a quarter-sample phase
+    std::mt19937 rng_limiter{23u};
+    std::uniform_real_distribution<float> dist_limiter(-1.0f, 1.0f);
+    std::vector<float> frames_program(static_cast<size_t>(channels) * frames * blocks);
+    for (uint32_t count_block = 0; count_block < blocks; ++count_block) {
+        for (UInt32 ch = 0; ch < channels; ++ch) {
+            for (UInt32 fr = 0; fr < frames; ++fr) {
+                const size_t frame_absolute = static_cast<size_t>(count_block) * frames + fr;
+                const float swell = 4.0f * static_cast<float>(0.5 + 0.5 * std::sin(2.0 * M_PI * frame_absolute / 24000.0));
+                frames_program[(static_cast<size_t>(count_block) * channels + ch) * frames + fr] = (ch == channels - 1)
+                    ? swell * static_cast<float>(std::sin(2.0 * M_PI * 0.45 * frame_absolute + 0.25 * M_PI))
+                    : swell * dist_limiter(rng_limiter);
             }
-        } else {
-            if (g_output_bits_per_channel == 16) {
-                int16_t* address_buffer = static_cast<int16_t*>(struct_ioData_period_buffer->mBuffers[0].mData);
-                for (UInt32 fr = 0; fr < icount_frames; ++fr) {
-                    for (UInt32 ch = 0; ch < outChannels; ++ch) {
-                        float v = (g_run_channel_order_test || function_channel_chosen(ch, outChannels)) ? std::clamp(mix[mixIndex(ch, fr)], -1.0f, 1.0f) : 0.0f;
-                        address_buffer[fr * outChannels + ch] = static_cast<int16_t>(std::lrintf(v * 32767.0f));
-                    }
-                }
-            } else {
-                int32_t* address_buffer = static_cast<int32_t*>(struct_ioData_period_buffer->mBuffers[0].mData);
-                for (UInt32 fr = 0; fr < icount_frames; ++fr) {
-                    for (UInt32 ch = 0; ch < outChannels; ++ch) {
-                        float v = (g_run_channel_order_test || function_channel_chosen(ch, outChannels)) ? std::clamp(mix[mixIndex(ch, fr)], -1.0f, 1.0f) : 0.0f;
-                        address_buffer[fr * outChannels + ch] = static_cast<int32_t>(std::lrintf(v * 2147483647.0f));
-                    }
+        }
+    }
+
+    float* mix = global_MixBus.frames_mix.data();
+    std::vector<float> frames_limited(frames_program.size());
+    global_Limiter.status_primed = false;
+    double ns_total = 0.0;
+    {
+        struct_callback_allocation_scope scope_allocation_guard;
+        for (uint32_t count_block = 0; count_block < blocks; ++count_block) {
+            const size_t offset_block = static_cast<size_t>(count_block) * channels * frames;
+            std::memcpy(mix, frames_program.data() + offset_block, static_cast<size_t>(channels) * frames * sizeof(float));
+            auto time_start = std::chrono::steady_clock::now();
+            function_limiter_process(mix, channels, frames);
+            ns_total += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - time_start).count();
+            std::memcpy(frames_limited.data() + offset_block, mix, static_cast<size_t>(channels) * frames * sizeof(float));
+        }
+    }
+
+    // Output true-peak estimate (same cubic midpoint as the detector)
+    float peak_output = 0.0f;
+    for (UInt32 ch = 0; ch < channels; ++ch) {
+        float before = 0.0f, here = 0.0f, next = 0.0f;
+        for (size_t frame_absolute = 0; frame_absolute < static_cast<size_t>(frames) * blocks; ++frame_absolute) {
+            const size_t count_block = frame_absolute / frames;
+            const float after = frames_limited[(count_block * channels + ch) * frames + frame_absolute % frames];
+            const float midpoint = (here + next) * 0.5625f - (before + after) * 0.0625f;
+            peak_output = std::max(peak_output, std::max(std::fabs(here), std::fabs(midpoint)));
+            before = here; here = next; next = after;
+        }
+    }
+    const bool status_ceiling = peak_output <= ceiling * 1.0001f;
+
+    // A bus under the ceiling passes unchanged, delayed by the reported latency
+    bool status_transparent = true;
+    global_Limiter.status_primed = false;
+    std::vector<float> frames_quiet(static_cast<size_t>(frames) * 64), frames_quiet_out(frames_quiet.size());
+    for (float& sample : frames_quiet) sample = 0.5f * dist_limiter(rng_limiter);
+    for (uint32_t count_block = 0; count_block < 64; ++count_block) {
+        for (UInt32 ch = 0; ch < channels; ++ch) {
+            std::memcpy(mix + static_cast<size_t>(ch) * frames, frames_quiet.data() + static_cast<size_t>(count_block) * frames,
+                        frames * sizeof(float));
+        }
+        function_limiter_process(mix, channels, frames);
+        for (UInt32 ch = 0; ch < channels; ++ch) {
+            for (UInt32 fr = 0; fr < frames; ++fr) {
+                const size_t frame_absolute = static_cast<size_t>(count_block) * frames + fr;
+                const float expected = (frame_absolute >= frames_latency) ? frames_quiet[frame_absolute - frames_latency] : 0.0f;
+                status_transparent = status_transparent && mix[static_cast<size_t>(ch) * frames + fr] == expected;
+            }
+        }
+    }
+
+    const double ns_block = ns_total / blocks;
+    const double percent_budget = 100.0 * ns_block / (frames * 1e9 / g_output_sample_rate);
+    std::cout << "Master limiter (" << channels << " ch, " << frames << "-frame blocks at 48 kHz): " << ns_block / 1000.0
+              << " us/block, " << percent_budget << "% of the block\n"
+              << "  latency " << frames_latency << " frames; output true-peak " << 20.0 * std::log10(peak_output)
+              << " dBFS (ceiling " << g_limiter_ceiling_db.load() << "): " << (status_ceiling ? "held" : "EXCEEDED")
+              << "; quiet bus " << (status_transparent ? "bit-identical after the latency" : "MODIFIED") << "\n";
+    if (percent_budget >= 2.0) std::cout << "  (over the 2% budget)\n";
+
+    g_output_sample_rate = rate_saved;
+    function_mix_bus_prepare(kbenchmark_channels, kframes_default_slice);
+    return status_ceiling && status_transparent;
+}
+
+/**
+ * OUTPUT CHANNEL GAIN
+ * A constant full-scale bus (16 channels, 64-frame blocks at 48 kHz) with
+ * one channel muted and one trimmed by -6 dB mid-stream. Unity channels
+ * must pass bit-identical, the mute must reach exactly zero and the trim
+ * its target, with no per-frame step larger than the ramp rate allows.
+ */
+bool function_benchmark_channel_gains() {
+    const UInt32 channels = 16;
+    const UInt32 frames = 64;
+    const uint32_t blocks = 4000;
+    const UInt32 channel_muted = 2, channel_trimmed = 4;
+    const double rate_saved = g_output_sample_rate;
+    g_output_sample_rate = 48000.0;
+    function_channel_gains_reset();
+    function_mix_bus_prepare(channels, kframes_default_slice);
+
+    garray_channel_gains[channel_muted].mute.store(true);
+    garray_channel_gains[channel_trimmed].trim.store(std::pow(10.0f, -6.0f / 20.0f));
+    const float step_allowed = static_cast<float>(1.0 / (kms_channel_gain_ramp * 0.001 * g_output_sample_rate)) * 1.001f;
+
+    float* mix = global_MixBus.frames_mix.data();
+    bool status_unity = true;
+    float step_largest = 0.0f;
+    float garray_previous[2] = {1.0f, 1.0f};
+    double ns_total = 0.0;
+    for (uint32_t count_block = 0; count_block < blocks; ++count_block) {
+        std::fill_n(mix, static_cast<size_t>(channels) * frames, 1.0f);
+        auto time_start = std::chrono::steady_clock::now();
+        function_channel_gain_process(mix, channels, frames);
+        ns_total += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - time_start).count();
+        for (UInt32 ch = 0; ch < channels; ++ch) {
+            const float* row = mix + static_cast<size_t>(ch) * frames;
+            for (UInt32 fr = 0; fr < frames; ++fr) {
+                if (ch == channel_muted || ch == channel_trimmed) {
+                    float& previous = garray_previous[ch == channel_trimmed];
+                    step_largest = std::max(step_largest, std::fabs(row[fr] - previous));
+                    previous = row[fr];
+                } else {
+                    status_unity = status_unity && row[fr] == 1.0f;
                 }
             }
         }
     }
+    const bool status_muted = garray_previous[0] == 0.0f;
+    const bool status_trimmed = std::fabs(garray_previous[1] - std::pow(10.0f, -6.0f / 20.0f)) < 1e-6f;
+    const bool status_ramp = step_largest <= step_allowed;
+
+    std::cout << "Output channel gain (" << channels << " ch, " << frames << "-frame blocks): "
+              << ns_total / blocks / 1000.0 << " us/block; unity " << (status_unity ? "bit-identical" : "MODIFIED")
+              << ", mute " << (status_muted ? "reached 0" : "INCOMPLETE") << ", -6 dB trim " << (status_trimmed ? "reached" : "MISSED")
+              << ", largest step " << step_largest << " per frame (ramp allows " << step_allowed << ")\n";
+
+    function_channel_gains_reset();
+    g_output_sample_rate = rate_saved;
+    function_mix_bus_prepare(kbenchmark_channels, kframes_default_slice);
+    return status_unity && status_muted && status_trimmed && status_ramp;
+}
 
-    return noErr;
+/**
+ * NULL DEVICE
+ * The live scheduler runs on the null device: four seconds as fast as
+ * possible with block sizes jittered 192-320 frames, then half a second
+ * paced in real time with 128-frame blocks. The sink must see every frame
+ * exactly once and no block outside the jitter range; the real-time run
+ * reports its late blocks.
+ */
+struct struct_benchmark_sink {
+    uint64_t frames_seen = 0;
+    uint64_t count_outside = 0;
+    UInt32 frames_low = 0;
+    UInt32 frames_high = 0;
+};
+
+void function_benchmark_sink(const AudioBufferList* ilist, UInt32 iframes, void* icontext) {
+    struct_benchmark_sink& sink = *static_cast<struct_benchmark_sink*>(icontext);
+    sink.frames_seen += iframes;
+    const bool status_last = (ilist->mBuffers[0].mDataByteSize == 0);
+    if (!status_last && (iframes < sink.frames_low || iframes > sink.frames_high)) ++sink.count_outside;
 }
 
+bool function_benchmark_null_device() {
+    const struct_audio_backend& backend = global_BackendNull;
+    struct_backend_format format_stream;
+    struct_benchmark_sink sink;
+    bool status_frames = true;
+
+    for (int run = 0; run < 2; ++run) {
+        const bool status_realtime = (run == 1);
+        struct_null_device_config& config = g_null_device_config;
+        config = struct_null_device_config{};
+        config.rate = 48000.0;
+        config.channels = kbenchmark_channels;
+        config.frames_block = status_realtime ? 128 : 256;
+        config.frames_jitter = status_realtime ? 0 : 64;
+        config.status_realtime = status_realtime;
+        config.frames_total = status_realtime ? 24000 : 4 * 48000;
+        config.function_sink = function_benchmark_sink;
+        config.context_sink = &sink;
+        sink = struct_benchmark_sink{};
+        sink.frames_low = config.frames_block - config.frames_jitter;
+        sink.frames_high = config.frames_block + config.frames_jitter;
+
+        if (!backend.function_open(format_stream, function_callback_audio, &global_AudioFileData)) return false;
+        function_engine_adopt_format(format_stream, kbenchmark_channels);
+        function_grain_pool_reset();
+        g_grain_polyphony.store(32);
+        global_AudioFileData.present_frame = 0;
+        global_ProcessGrain.frames_until_onset = 0.0;
+
+        backend.function_start();
+        function_null_device_wait();
+        backend.function_close();
+        function_null_device_report();
+
+        // The final block may be cut short by frames_total
+        status_frames = status_frames && sink.frames_seen == config.frames_total && global_NullDevice.stats.frames_rendered == config.frames_total &&
+                        sink.count_outside <= 1;
+    }
+    std::cout << "  every frame delivered once, block sizes within the jitter range: " << (status_frames ? "yes" : "NO") << "\n";
+
+    // Back to the planar float device the other benchmarks expect
+    format_stream = struct_backend_format{};
+    format_stream.rate = 48000.0;
+    format_stream.channels = kbenchmark_channels;
+    format_stream.frames_block_max = kframes_default_slice;
+    function_engine_adopt_format(format_stream, kbenchmark_channels);
+    return status_frames;
+}
 
+/**
+ * PROCESSING QUANTUM
+ * The live scheduler (spawning, jitter, density 0.25) renders two seconds
+ * through the callback three times from the same seed: 256-frame blocks,
+ * odd 37-frame blocks, and block sizes drawn at random from 1-512. Every
+ * channel must come out bit-identical. Then the cost of a 256-frame block
+ * with 128 sounding grains is timed at each quantum.
+ */
+bool function_benchmark_quantum() {
+    const UInt32 frames_block_max = 512;
+    const uint32_t frames_render = 2 * 48000;
+    const float interval_saved = g_interval_multiplier;
+    const double rate_saved = g_output_sample_rate;
+    g_output_sample_rate = 48000.0;
+    g_interval_multiplier = 0.25f;
+    function_mix_bus_prepare(kbenchmark_channels, kframes_default_slice);
+
+    struct_benchmark_output output;
+    function_benchmark_prepare_output(output, kbenchmark_channels, frames_block_max);
+    AudioUnitRenderActionFlags flags_render = 0;
+    AudioTimeStamp stamp_time{};
+    std::vector<float> frames_reference;
+    bool status_identical = true;
+
+    for (int pattern = 0; pattern < 3; ++pattern) {
+        std::mt19937 rng_block{99u};
+        std::uniform_int_distribution<UInt32> dist_block(1, frames_block_max);
+        std::vector<float> frames_stream(static_cast<size_t>(kbenchmark_channels) * frames_render);
+
+        g_rng_grain.seed(5u);
+        function_grain_pool_reset();
+        g_grain_polyphony.store(64);
+        global_AudioFileData.present_frame = 0;
+        global_ProcessGrain.frames_until_onset = 0.0;
+        global_Limiter.status_primed = false;
+        function_quantum_fifo_reset();
+
+        for (uint32_t frame_rendered = 0; frame_rendered < frames_render;) {
+            UInt32 frames = (pattern == 0) ? 256 : (pattern == 1) ? 37 : dist_block(rng_block);
+            frames = std::min<UInt32>(frames, frames_render - frame_rendered);
+            for (UInt32 ch = 0; ch < kbenchmark_channels; ++ch) output.list->mBuffers[ch].mDataByteSize = frames * sizeof(float);
+            function_callback_audio(&global_AudioFileData, &flags_render, &stamp_time, 0, frames, output.list);
+            for (UInt32 ch = 0; ch < kbenchmark_channels; ++ch) {
+                std::memcpy(frames_stream.data() + static_cast<size_t>(ch) * frames_render + frame_rendered,
+                            output.frames_output.data() + static_cast<size_t>(ch) * frames_block_max, frames * sizeof(float));
+            }
+            frame_rendered += frames;
+        }
+        if (pattern == 0) frames_reference.swap(frames_stream);
+        else status_identical = status_identical && frames_stream == frames_reference;
+    }
+    std::cout << "Processing quantum (" << g_frames_quantum << " frames): 256, 37 and random 1-" << frames_block_max
+              << " frame blocks " << (status_identical ? "bit-identical" : "DIFFER") << "\n";
+
+    // Cost of the quantum size itself: per-quantum grain overhead against per-frame work
+    const UInt32 frames_quantum_saved = g_frames_quantum;
+    struct_benchmark_output output_block;
+    function_benchmark_prepare_output(output_block, kbenchmark_channels, kbenchmark_block_frames);
+    for (UInt32 frames_quantum : {32u, 64u, 256u}) {
+        g_frames_quantum = frames_quantum;
+        function_mix_bus_prepare(kbenchmark_channels, kframes_default_slice);
+        function_benchmark_fill_grains(128);
+        const double ns_block = function_benchmark_time_callback(output_block, 400);
+        std::cout << "  " << frames_quantum << "-frame quantum: " << ns_block / 1000.0 << " us per 256-frame block (128 grains)\n";
+    }
 
+    g_frames_quantum = frames_quantum_saved;
+    g_interval_multiplier = interval_saved;
+    g_output_sample_rate = rate_saved;
+    function_mix_bus_prepare(kbenchmark_channels, kframes_default_slice);
+    return status_identical;
+}
 
+/**
+ * NORMALIZATION COST PER BLOCK
+ * Counts sqrt evaluations for grain normalization. Steady-state blocks should
+ * report zero (the old render loop did one per active grain per block); a
+ * density publish costs one per sounding grain, once.
+ */
+void function_benchmark_normalization(struct_benchmark_output& ioutput) {
+    const uint32_t kcount_grains = 1024;
+    const uint32_t blocks = 100;
 
+    function_benchmark_fill_grains(kcount_grains);
+    function_benchmark_time_callback(ioutput, 1);   // First block applies the pending density generation
 
+    g_count_normalization = 0;
+    function_benchmark_time_callback(ioutput, blocks);
+    const double count_steady = double(g_count_normalization) / double(blocks + 1);
 
+    g_count_normalization = 0;
+    g_density_generation.fetch_add(1, std::memory_order_release);
+    function_benchmark_time_callback(ioutput, 1);
+    const uint64_t count_publish = g_count_normalization;
 
+    std::cout << "Grain normalization (" << kcount_grains << " grains): " << count_steady
+              << " sqrt per block in steady state (per-block recompute: " << kcount_grains << "), "
+              << count_publish << " on a density publish\n";
+}
 
+/**
+ * TRANSPOSED GRAIN BUDGET
+ * 256 grains at mixed non-unity rates, each written to all 6 channels, timed
+ * per interpolation mode against the real-time budget of a 256-frame block at
+ * 48 kHz (5333 us). Then a full-scale tone at 0.45 x the source rate is read
+ * at rate 2: everything it produces is an alias, so its level is each mode's
+ * alias rejection for the widest upward transposition.
+ */
+void function_benchmark_transposition(struct_benchmark_output& ioutput) {
+    const uint32_t kcount_grains = 256;
+    const uint32_t blocks = 400;
+    const double us_budget = kbenchmark_block_frames * 1e6 / 48000.0;
+    const float garray_rates[] = {0.5f, 0.7937f, 0.9439f, 1.0595f, 1.2599f, 1.4983f, 2.0f};
+    const int mode_saved = g_interpolation_mode.load();
+
+    std::cout << "Transposed grains (" << kcount_grains << " grains x " << kbenchmark_channels << " channels, "
+              << kbenchmark_block_frames << "-frame blocks)\n";
+    for (int mode = 0; mode < kcount_interpolation_modes; ++mode) {
+        g_interpolation_mode.store(mode);
+        function_benchmark_fill_grains(kcount_grains);
+        for (uint32_t index_active = 0; index_active < global_ProcessGrain.active_envelopes_grain; ++index_active) {
+            const uint32_t slot = global_ProcessGrain.array_active_grains[index_active];
+            global_ProcessGrain.pool_grains.rate_grain[slot] = garray_rates[index_active % (sizeof(garray_rates) / sizeof(garray_rates[0]))];
+            global_ProcessGrain.pool_grains.frames_grain[slot] = (global_AudioFileData.frames_total - 8192u) / 2u;
+            global_ProcessGrain.pool_grains.target_object[slot] = -2;
+        }
+        double ns_block = function_benchmark_time_callback(ioutput, blocks);
 
+        std::cout << "  " << garray_names_interpolation[mode] << ": " << ns_block / 1000.0 << " us/block ("
+                  << (100.0 * ns_block / 1000.0 / us_budget) << "% of real time)\n";
+    }
+    g_interpolation_mode.store(mode_saved);
+
+    const uint32_t frames_tone = 8192, frames_read = 2048;
+    std::vector<float> frames_source(frames_tone), frames_coefficient(4 * frames_read), frames_read_out(frames_read);
+    std::vector<int32_t> frames_index(frames_read);
+    for (uint32_t fr = 0; fr < frames_tone; ++fr) frames_source[fr] = static_cast<float>(std::sin(2.0 * M_PI * 0.45 * fr));
+    std::cout << "  Alias level of a 0.45 x rate tone read at rate 2:";
+    for (int mode = 0; mode < kcount_interpolation_modes; ++mode) {
+        const struct_interpolation_run run = function_interpolation_prepare(64.0, krate_grain_max, frames_read, mode, frames_tone,
+                                                                            frames_index.data(), frames_coefficient.data());
+        const uint32_t stride_coefficient = (mode == kinterpolation_hermite) ? 4 : 1;
+        function_interpolate_channel(frames_source.data() + run.frame_tap_first, frames_index.data() + run.frame_skip,
+                                     frames_coefficient.data() + run.frame_skip * stride_coefficient, mode, run.band_sinc,
+                                     run.frames_run, frames_read_out.data());
+        double energy = 0.0;
+        for (uint32_t fr = 0; fr < run.frames_run; ++fr) energy += static_cast<double>(frames_read_out[fr]) * frames_read_out[fr];
+        std::cout << (mode ? ", " : " ") << garray_names_interpolation[mode] << " "
+                  << 10.0 * std::log10(2.0 * energy / std::max<uint32_t>(1, run.frames_run)) << " dB";
+    }
+    std::cout << "\n";
+}
 
+/**
+ * SOURCE LOADING
+ * Writes a 6-channel 16-bit file and a mono float file next to the binary,
+ * then times the previous frame-by-frame ifstream reader against the mapped
+ * loader. The converted samples must match exactly.
+ */
+enum : int {
+    kwav_layout_plain = 0,      // RIFF, 16-byte fmt, data
+    kwav_layout_list_first,     // RIFF, odd-sized LIST chunk before fmt (pad byte)
+    kwav_layout_extensible,     // RIFF, WAVE_FORMAT_EXTENSIBLE fmt with a channel mask
+    kwav_layout_rf64,           // RF64, ds64 sizes, data size placeholder
+    kwav_layout_fmt_last,       // RIFF, data before fmt
+    kcount_wav_layouts
+};
 
-// =============================================================================
-// PLAY AUDIO FILE FUNCTION
-// =============================================================================
-void playAudioFile(const std::string& name_file, 
-                   UInt32 selection_device, 
-                   uint16_t channels_file, 
-                   uint32_t rate_samples, 
-                   uint16_t bits_sample,
-                   uint16_t audio_format, // audio format from WAV file (1=PCM, 3=IEEE float)
-                   std::ifstream& file) {
-    AudioStreamBasicDescription formatAudio;
+bool function_benchmark_write_wav(const std::string& iname_file, uint16_t ichannels, uint16_t ibits_sample,
+                                  uint16_t iformat, uint32_t iframes, int ilayout = kwav_layout_plain,
+                                  uint32_t irate_samples = 48000) {
+    std::ofstream file_out(iname_file, std::ios::binary);
+    if (!file_out) return false;
+    auto function_put = [&file_out](const void* ibytes, std::streamsize icount) {
+        file_out.write(static_cast<const char*>(ibytes), icount);
+    };
+    const uint32_t bytes_data = iframes * ichannels * (ibits_sample / 8);
+    const uint32_t rate_samples = irate_samples;
+    const uint32_t bytes_per_second = rate_samples * ichannels * (ibits_sample / 8);
+    const uint16_t bytes_block = ichannels * (ibits_sample / 8);
+    const bool status_extensible = (ilayout == kwav_layout_extensible);
+    const uint32_t bytes_fmt = status_extensible ? 40 : 16;
+    const uint16_t format_tag = status_extensible ? kwave_format_extensible : iformat;
+    const uint32_t placeholder = ksize_chunk_rf64;
+
+    function_put(ilayout == kwav_layout_rf64 ? "RF64" : "RIFF", 4);
+    const uint32_t bytes_riff = 36 + bytes_data;
+    function_put(ilayout == kwav_layout_rf64 ? &placeholder : &bytes_riff, 4);
+    function_put("WAVE", 4);
+    if (ilayout == kwav_layout_rf64) {
+        const uint32_t bytes_ds64 = 28;
+        const uint64_t garray_sizes[3] = {bytes_riff + 36ull, bytes_data, iframes};
+        const uint32_t length_table = 0;
+        function_put("ds64", 4); function_put(&bytes_ds64, 4);
+        function_put(garray_sizes, sizeof(garray_sizes)); function_put(&length_table, 4);
+    }
+    if (ilayout == kwav_layout_list_first) {
+        const uint32_t bytes_list = 13;
+        function_put("LIST", 4); function_put(&bytes_list, 4);
+        function_put("INFOISFT\x01\0\0\0A\0", 14);   // 13 bytes + pad byte
+    }
+    auto function_put_fmt = [&]() {
+        function_put("fmt ", 4); function_put(&bytes_fmt, 4);
+        function_put(&format_tag, 2); function_put(&ichannels, 2);
+        function_put(&rate_samples, 4); function_put(&bytes_per_second, 4);
+        function_put(&bytes_block, 2); function_put(&ibits_sample, 2);
+        if (status_extensible) {
+            const uint16_t bytes_extension = 22;
+            const uint32_t mask_channel = (1u << ichannels) - 1u;
+            const unsigned char kguid_tail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00,
+                                                  0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+            function_put(&bytes_extension, 2); function_put(&ibits_sample, 2); function_put(&mask_channel, 4);
+            function_put(&iformat, 2); function_put(kguid_tail, sizeof(kguid_tail));
+        }
+    };
+    if (ilayout != kwav_layout_fmt_last) function_put_fmt();
+    function_put("data", 4);
+    function_put(ilayout == kwav_layout_rf64 ? &placeholder : &bytes_data, 4);
+
+    std::mt19937 rng_file{77u};
+    std::vector<char> frames_block(static_cast<size_t>(bytes_block) * 4096);
+    for (uint32_t frame_first = 0; frame_first < iframes; frame_first += 4096) {
+        const uint32_t count_frames = std::min<uint32_t>(4096, iframes - frame_first);
+        for (size_t count_byte = 0; count_byte < static_cast<size_t>(count_frames) * bytes_block; count_byte += 2) {
+            uint16_t value = static_cast<uint16_t>(rng_file());
+            if (iformat == kwave_format_ieee_float && ibits_sample == 32 && (count_byte % 4) == 2) value &= 0x3E7F;   // Keep float exponents finite and small
+            if (iformat == kwave_format_ieee_float && ibits_sample == 64 && (count_byte % 8) == 6) value &= 0x3FEF;   // |x| < 1 for doubles
+            std::memcpy(frames_block.data() + count_byte, &value, 2);
+        }
+        file_out.write(frames_block.data(), static_cast<std::streamsize>(count_frames) * bytes_block);
+    }
+    if (ilayout == kwav_layout_fmt_last) {
+        if (bytes_data & 1u) function_put("", 1);   // Pad byte after an odd-sized data chunk
+        function_put_fmt();
+    }
+    return static_cast<bool>(file_out);
+}
 
-    formatAudio.mSampleRate = rate_samples;
-    formatAudio.mFormatID = kAudioFormatLinearPCM; 
+// Parse a benchmark file and load it resident
+bool function_benchmark_load_file(const std::string& iname_file) {
+    struct_wav_format format_file;
+    return function_wav_parse(iname_file, format_file) && function_source_load_mapped(iname_file, format_file);
+}
 
-    formatAudio.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked | kAudioFormatFlagIsNonInterleaved;
-    formatAudio.mBitsPerChannel = 32;
-    formatAudio.mChannelsPerFrame = channels_file;
-    formatAudio.mFramesPerPacket = 1;
-    formatAudio.mBytesPerFrame = sizeof(Float32);
-    formatAudio.mBytesPerPacket = sizeof(Float32);
+void function_benchmark_source_load() {
+    struct struct_case_load { const char* name_case; uint16_t channels; uint16_t bits; uint16_t format; uint32_t frames; };
+    const struct_case_load garray_cases[] = {
+        {"6 ch 16-bit PCM", 6, 16, 1, 1u << 21},
+        {"1 ch 32-bit float", 1, 32, 3, 1u << 22},
+    };
+    const std::string name_file = "granular_benchmark_source.wav";
+    const uint32_t kaddress_data = 44;
+
+    std::cout << "Source loading (frame-by-frame ifstream vs mapped)\n";
+    for (const struct_case_load& load_case : garray_cases) {
+        if (!function_benchmark_write_wav(name_file, load_case.channels, load_case.bits, load_case.format, load_case.frames)) {
+            std::cerr << "  Could not write " << name_file << "\n";
+            return;
+        }
 
-    AudioUnit unit_audio;
-    AudioComponentDescription descriptionComponentAudio;
+        // Previous loader: one read and one vector per frame
+        auto time_start = std::chrono::steady_clock::now();
+        std::vector<std::vector<float>> samples_legacy(load_case.channels, std::vector<float>(load_case.frames));
+        {
+            std::ifstream file(name_file, std::ios::binary);
+            file.seekg(kaddress_data, std::ios::beg);
+            for (uint32_t fr = 0; fr < load_case.frames; ++fr) {
+                if (load_case.bits == 16) {
+                    std::vector<int16_t> sample16(load_case.channels);
+                    file.read(reinterpret_cast<char*>(sample16.data()), load_case.channels * sizeof(int16_t));
+                    for (uint16_t ch = 0; ch < load_case.channels; ++ch) samples_legacy[ch][fr] = sample16[ch] / 32768.0f;
+                } else {
+                    std::vector<float> sample32(load_case.channels);
+                    file.read(reinterpret_cast<char*>(sample32.data()), load_case.channels * sizeof(float));
+                    for (uint16_t ch = 0; ch < load_case.channels; ++ch) samples_legacy[ch][fr] = sample32[ch];
+                }
+            }
+        }
+        auto time_legacy = std::chrono::steady_clock::now();
 
-    descriptionComponentAudio.componentType = kAudioUnitType_Output;
-    descriptionComponentAudio.componentSubType = kAudioUnitSubType_HALOutput;
-    descriptionComponentAudio.componentManufacturer = kAudioUnitManufacturer_Apple;
-    descriptionComponentAudio.componentFlags = 0;
-    descriptionComponentAudio.componentFlagsMask = 0;
+        std::cout << "  " << load_case.name_case << ", " << load_case.frames << " frames: legacy "
+                  << std::chrono::duration<double, std::milli>(time_legacy - time_start).count() << " ms\n  ";
+        function_benchmark_load_file(name_file);
 
-    AudioComponent component_audio = AudioComponentFindNext(NULL, &descriptionComponentAudio);
-    if (!component_audio) { 
-        std::cerr << "Audio output component error: \n";
-        return;
-    } else {
-        std::cout << "Audio components detected.\n\n";
+        bool status_match = global_AudioFileData.frames_total == load_case.frames;
+        for (uint16_t ch = 0; status_match && ch < load_case.channels; ++ch) {
+            status_match = std::memcmp(samples_legacy[ch].data(), global_AudioFileData.samples[ch],
+                                       load_case.frames * sizeof(float)) == 0;
+        }
+        if (!status_match) std::cout << "  MISMATCH against the frame-by-frame loader\n";
+        function_source_release();
     }
+    std::remove(name_file.c_str());
+}
 
-    OSStatus status_unit_audio;
+/**
+ * SAMPLE DECODERS
+ * Each converter runs over the same random data as its scalar reference and
+ * must match it bit for bit (including the odd-length tail). Throughput is
+ * reported in MB/s of file bytes, next to a plain memcpy of the same bytes,
+ * so conversion can be compared against disk read rates. Multichannel
+ * 8-bit, 24-bit and float64 files then go through the loader and must
+ * match the reference decode of their data chunk.
+ */
+bool function_benchmark_decoders() {
+    struct struct_case_decode { uint16_t bits; uint16_t format; };
+    const struct_case_decode garray_cases[] = {
+        {8, kwave_format_pcm}, {16, kwave_format_pcm}, {24, kwave_format_pcm},
+        {32, kwave_format_pcm}, {32, kwave_format_ieee_float}, {64, kwave_format_ieee_float},
+    };
+    const size_t kcount_samples = (1u << 22) + 5;
+    const int kpasses = 4;
+
+    bool status_all = true;
+    std::mt19937 rng_bytes{2024u};
+    std::vector<float> frames_reference(kcount_samples);
+    std::vector<float> frames_decoded(kcount_samples);
+    std::cout << "Sample decoders (" << kcount_samples << " samples, MB/s of file bytes)\n";
+    for (const struct_case_decode& decode_case : garray_cases) {
+        struct_wav_format format_case{};
+        format_case.format_tag = decode_case.format;
+        format_case.bits_sample = decode_case.bits;
+        struct_sample_decoder decoder_scalar, decoder_best;
+        function_decoder_select(format_case, decoder_scalar, true);
+        function_decoder_select(format_case, decoder_best);
+
+        const size_t bytes_case = kcount_samples * decoder_scalar.bytes_sample;
+        std::vector<unsigned char> bytes_source(bytes_case + 16);
+        for (unsigned char& value : bytes_source) value = static_cast<unsigned char>(rng_bytes());
+        if (decode_case.format == kwave_format_ieee_float) {
+            // Keep exponents finite: clear the top exponent bit of every sample
+            for (size_t n = 0; n < kcount_samples; ++n) bytes_source[(n + 1) * decoder_scalar.bytes_sample - 1] &= 0xBF;
+        }
 
-    status_unit_audio = AudioComponentInstanceNew(component_audio, &unit_audio);
-    if (status_unit_audio != noErr) { 
-        std::cerr << "Audio component instance error: " << status_unit_audio << " \n";
-        return;
-    } else {
-        std::cout << "Audio component instance created.\n";
+        auto function_time = [&](function_convert_t ifunction_convert, float* odestination) {
+            double ms_best = 1e30;
+            for (int pass = 0; pass < kpasses; ++pass) {
+                auto time_start = std::chrono::steady_clock::now();
+                ifunction_convert(bytes_source.data() + 1, odestination, kcount_samples);   // Unaligned on purpose
+                ms_best = std::min(ms_best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_start).count());
+            }
+            return bytes_case / (ms_best * 1000.0);
+        };
+        std::vector<unsigned char> bytes_copy(bytes_case);
+        double ms_copy = 1e30;
+        for (int pass = 0; pass < kpasses; ++pass) {
+            auto time_start = std::chrono::steady_clock::now();
+            std::memcpy(bytes_copy.data(), bytes_source.data() + 1, bytes_case);
+            ms_copy = std::min(ms_copy, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_start).count());
+        }
+        const double mbps_scalar = function_time(decoder_scalar.function_convert, frames_reference.data());
+        const double mbps_best = function_time(decoder_best.function_convert, frames_decoded.data());
+        const bool status_match = std::memcmp(frames_reference.data(), frames_decoded.data(), kcount_samples * sizeof(float)) == 0;
+        std::cout << "  " << decoder_scalar.name_decoder << ": scalar " << mbps_scalar << ", "
+                  << (decoder_best.function_convert == decoder_scalar.function_convert ? "selected" : "SIMD") << " "
+                  << mbps_best << " (memcpy " << bytes_case / (ms_copy * 1000.0) << ")"
+                  << (status_match ? "" : "  MISMATCH") << "\n";
+        status_all = status_all && status_match;
+    }
 
-        std::cout << "Sample rate: " << formatAudio.mSampleRate << "\n";
-        std::cout << "Format ID: " << formatAudio.mFormatID << "\n";
-        std::cout << "Format flags: " << formatAudio.mFormatFlags << "\n";
-        std::cout << "Bits per channel: " << formatAudio.mBitsPerChannel << "\n";
-        std::cout << "Channels per frame: " << formatAudio.mChannelsPerFrame << "\n";
-        std::cout << "Frames per packet: " << formatAudio.mFramesPerPacket << "\n";
-        std::cout << "Bytes per frame: " << formatAudio.mBytesPerFrame << "\n";
-        std::cout << "Bytes per packet: " << formatAudio.mBytesPerPacket << "\n\n";
+    // Whole files through the loader: block split, deinterleave and tails
+    const std::string name_file = "granular_benchmark_decode.wav";
+    const uint16_t channels = 6;
+    const uint32_t frames = 200003;
+    for (const struct_case_decode& decode_case : {garray_cases[0], garray_cases[2], garray_cases[5]}) {
+        struct_wav_format format_file{};
+        struct_sample_decoder decoder_scalar;
+        bool status_file = function_benchmark_write_wav(name_file, channels, decode_case.bits, decode_case.format, frames) &&
+                           function_wav_parse(name_file, format_file) &&
+                           function_decoder_select(format_file, decoder_scalar, true);
+        std::cout << "  ";
+        status_file = status_file && function_source_load_mapped(name_file, format_file) && global_AudioFileData.frames_total == frames;
+        if (status_file) {
+            std::vector<unsigned char> bytes_data(static_cast<size_t>(format_file.bytes_data));
+            std::ifstream file(name_file, std::ios::binary);
+            file.seekg(static_cast<std::streamoff>(format_file.address_data), std::ios::beg);
+            file.read(reinterpret_cast<char*>(bytes_data.data()), static_cast<std::streamsize>(bytes_data.size()));
+            std::vector<float> frames_interleaved(static_cast<size_t>(frames) * channels);
+            decoder_scalar.function_convert(bytes_data.data(), frames_interleaved.data(), frames_interleaved.size());
+            for (uint16_t ch = 0; status_file && ch < channels; ++ch) {
+                for (uint32_t fr = 0; status_file && fr < frames; ++fr)
+                    status_file = std::memcmp(&global_AudioFileData.samples[ch][fr], &frames_interleaved[static_cast<size_t>(fr) * channels + ch], sizeof(float)) == 0;
+            }
+        }
+        if (!status_file) std::cout << "  " << decode_case.bits << "-bit file load FAILED\n";
+        status_all = status_all && status_file;
+        function_source_release();
     }
+    std::remove(name_file.c_str());
+    return status_all;
+}
 
-    status_unit_audio = AudioUnitSetProperty(unit_audio,
-                                             kAudioOutputUnitProperty_CurrentDevice,
-                                             kAudioUnitScope_Global, 
-                                             0, 
-                                             &selection_device, 
-                                             sizeof(selection_device));
-    if (status_unit_audio != noErr) {
-        std::cerr << "Failed to set audio output. Error: " << status_unit_audio << " \n";
-        AudioComponentInstanceDispose(unit_audio);
-        return;
-    } else {
-        std::cout << "Audio output configured.\n";
+/**
+ * PARALLEL DECODE
+ * Startup time for a 6-channel 24-bit source with 1, 2, 4, ... decode
+ * workers up to the core count (at least 4, so the chunk split is always
+ * exercised). Every pool size must produce the same planar buffer as the
+ * single worker. A speedup is only printed for pool sizes that fit on the
+ * cores present; above that the threads time-slice and the ratio says
+ * nothing about scaling.
+ */
+bool function_benchmark_parallel_decode() {
+    const std::string name_file = "granular_benchmark_parallel.wav";
+    const uint32_t frames = 1u << 21;
+    const uint32_t count_cores = std::max(1u, std::thread::hardware_concurrency());
+    if (!function_benchmark_write_wav(name_file, 6, 24, kwave_format_pcm, frames)) {
+        std::cerr << "  Could not write " << name_file << "\n";
+        return false;
     }
 
-    status_unit_audio = AudioUnitSetProperty(unit_audio, 
-                                             kAudioUnitProperty_StreamFormat, 
-                                             kAudioUnitScope_Input, 
-                                             0, 
-                                             &formatAudio, 
-                                             sizeof(formatAudio));
-    if (status_unit_audio != noErr) {
-        std::cerr << "Audio unit formatting error: " << status_unit_audio << " \n";
-        AudioComponentInstanceDispose(unit_audio);
-        return; 
-    } else {
-        std::cout << "Audio unit format established. Observe program output device's sample rate setup and input monitoring (if applicaple).\n\n";
+    bool status_all = true;
+    double ms_single = 0.0;
+    planar_frames_t frames_reference;
+    std::cout << "Parallel decode (6 ch 24-bit, " << frames << " frames, " << count_cores << " cores)\n";
+    const uint32_t count_workers_max = std::max(4u, count_cores);
+    for (uint32_t count_workers = 1; ; count_workers = std::min(count_workers * 2, count_workers_max)) {
+        g_count_workers_decode = count_workers;
+        std::cout << "  ";
+        auto time_start = std::chrono::steady_clock::now();
+        bool status_load = function_benchmark_load_file(name_file);
+        const double ms_load = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_start).count();
+        if (count_workers == 1) {
+            ms_single = ms_load;
+            frames_reference = global_AudioFileData.frames_planar;
+        }
+        status_load = status_load && global_AudioFileData.frames_planar == frames_reference;
+        std::cout << "  " << count_workers << (count_workers == 1 ? " worker: " : " workers: ") << ms_load << " ms startup, ";
+        if (count_workers <= count_cores) std::cout << ms_single / ms_load << "x";
+        else std::cout << "oversubscribed";
+        std::cout << (status_load ? "" : "  MISMATCH") << "\n";
+        status_all = status_all && status_load;
+        function_source_release();
+        if (count_workers == count_workers_max) break;
     }
+    g_count_workers_decode = 0;
+    std::remove(name_file.c_str());
+    return status_all;
+}
 
-    file.seekg(36, std::ios::beg);
-    char array_bytes_chunk_audio[4];
-    uint32_t bytes_chunk_audio;
-    bool status_chunkID_audio = false;
+/**
+ * SAMPLE-RATE CONVERSION
+ * Per quality level: error of 1 kHz and 15 kHz sines converted from 44.1 to
+ * 48 kHz against the exact sine at 48 kHz, rejection of a 23 kHz tone that
+ * must not alias into a 48 -> 44.1 kHz conversion, and load-time throughput
+ * for a 6-channel source. A resampled streaming source must then match the
+ * resident conversion exactly across the primed window.
+ */
+bool function_benchmark_resampler() {
+    constexpr double kPi = 3.14159265358979323846;
+    const uint32_t frames_tone = 1u << 16;
+    std::vector<float> frames_input(frames_tone);
+    std::vector<float> frames_output(frames_tone * 2);
+
+    // Power of the converted tone (or of its error against the exact tone) away from the edges, in dB
+    auto function_tone_db = [&](const struct_resampler& iresampler, uint32_t irate_in, uint32_t irate_out, double ifrequency, bool istatus_error) {
+        for (uint32_t fr = 0; fr < frames_tone; ++fr) frames_input[fr] = static_cast<float>(std::sin(2.0 * kPi * ifrequency * fr / irate_in));
+        const uint32_t frames_out = static_cast<uint32_t>(function_resample_frames(iresampler, frames_tone));
+        function_resample_span(iresampler, frames_input.data(), 0, frames_tone, 0, frames_out, frames_output.data());
+        double power = 0.0;
+        const uint32_t margin = 1024;
+        for (uint32_t fr = margin; fr < frames_out - margin; ++fr) {
+            const double exact = istatus_error ? std::sin(2.0 * kPi * ifrequency * fr / irate_out) : 0.0;
+            power += (frames_output[fr] - exact) * (frames_output[fr] - exact);
+        }
+        return 10.0 * std::log10(power / (frames_out - 2 * margin) / 0.5 + 1e-30);   // Relative to a full-scale sine
+    };
 
-    while (!file.eof() && !status_chunkID_audio) {
-        file.read(array_bytes_chunk_audio, 4);
-        file.read(reinterpret_cast<char*>(&bytes_chunk_audio), sizeof(bytes_chunk_audio));
+    bool status_all = true;
+    std::cout << "Sample-rate conversion\n";
+    for (int quality = 0; quality < kcount_resample_qualities; ++quality) {
+        struct_resampler resampler_up, resampler_down;
+        function_resampler_prepare(44100, 48000, quality, resampler_up);
+        function_resampler_prepare(48000, 44100, quality, resampler_down);
+        const double db_error_1k = function_tone_db(resampler_up, 44100, 48000, 1000.0, true);
+        const double db_error_15k = function_tone_db(resampler_up, 44100, 48000, 15000.0, true);
+        const double db_alias = function_tone_db(resampler_down, 48000, 44100, 23000.0, false);
+
+        // Throughput: 6 channels, 2^20 frames at 44.1 kHz, through the worker pool
+        const uint16_t channels = 6;
+        const uint32_t frames_source = 1u << 20;
+        global_AudioFileData.channels_file = channels;
+        global_AudioFileData.frames_total = frames_source;
+        global_AudioFileData.frames_planar.assign(static_cast<size_t>(channels) * frames_source, 0.0f);
+        global_AudioFileData.samples.assign(channels, nullptr);
+        for (uint16_t ch = 0; ch < channels; ++ch) {
+            global_AudioFileData.samples[ch] = global_AudioFileData.frames_planar.data() + static_cast<size_t>(ch) * frames_source;
+            for (uint32_t fr = 0; fr < frames_source; ++fr) {
+                global_AudioFileData.frames_planar[static_cast<size_t>(ch) * frames_source + fr] = static_cast<float>(std::sin(0.01 * (ch + 1) * fr));
+            }
+        }
+        global_Resampler = resampler_up;
+        std::cout << "  ";
+        auto time_start = std::chrono::steady_clock::now();
+        const bool status_resample = function_source_resample();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_start).count();
+        function_source_release();
+
+        const bool status_quality = status_resample && db_error_1k < -60.0 && db_alias < -50.0 &&
+                                    (quality == kresample_draft || db_error_15k < -60.0);   // Draft rolls off the top octave
+        std::cout << "  " << garray_resample_qualities[quality].name_quality << " (" << resampler_up.taps << " taps up, "
+                  << resampler_down.taps << " down): error 1 kHz " << db_error_1k << " dB, 15 kHz " << db_error_15k
+                  << " dB, 23 kHz alias " << db_alias << " dB, " << (frames_source / seconds / 1e6) << " M frames/s x 6 ch ("
+                  << (frames_source / 44100.0 / seconds) << "x real time)" << (status_quality ? "" : "  FAILED") << "\n";
+        status_all = status_all && status_quality;
+    }
 
-        if (std::string(array_bytes_chunk_audio, 4) == "data") {
-            status_chunkID_audio = true;
-            std::cout << "Data Chunk ID detected.\n\n";
-            break;
-        } else {
-            file.seekg(bytes_chunk_audio, std::ios::cur);
+    // Streaming pages must reproduce the resident conversion
+    const std::string name_file = "granular_benchmark_resample.wav";
+    const uint32_t frames_file = 300007;
+    struct_wav_format format_file;
+    bool status_stream = function_benchmark_write_wav(name_file, 6, 16, kwave_format_pcm, frames_file, kwav_layout_plain, 44100) &&
+                         function_wav_parse(name_file, format_file);
+    function_resampler_prepare(44100, 48000, kresample_standard, global_Resampler);
+    std::cout << "  ";
+    status_stream = status_stream && function_source_open(name_file, format_file) &&
+                    global_AudioFileData.frames_total == function_resample_frames(global_Resampler, frames_file);
+    planar_frames_t frames_resident(global_AudioFileData.frames_planar);
+    const uint32_t frames_resident_total = global_AudioFileData.frames_total;
+    std::cout << "  ";
+    status_stream = status_stream && function_stream_open(name_file, format_file) &&
+                    global_AudioFileData.frames_total == frames_resident_total;
+    if (status_stream) {
+        std::vector<float> scratch_span(kframes_stream_page);
+        for (uint16_t ch = 0; status_stream && ch < 6; ++ch) {
+            for (uint32_t frame_first = 0; status_stream && frame_first < frames_resident_total; frame_first += kframes_stream_page) {
+                const uint32_t count_frames = std::min(kframes_stream_page, frames_resident_total - frame_first);
+                const float* span = function_source_span(ch, frame_first, count_frames, scratch_span.data());
+                status_stream = std::memcmp(span, frames_resident.data() + static_cast<size_t>(ch) * frames_resident_total + frame_first,
+                                            count_frames * sizeof(float)) == 0;
+            }
         }
     }
+    std::cout << "  streaming vs resident at 48 kHz: " << (status_stream ? "identical" : "MISMATCH") << "\n";
+    function_stream_close();
+    function_source_release();
+    global_Resampler = struct_resampler{};
+    std::remove(name_file.c_str());
+    return status_all && status_stream;
+}
 
-    if (!status_chunkID_audio) {
-        std::cerr << "No audio data ID detected.\n\n";
-        AudioComponentInstanceDispose(unit_audio);
-        return;
+/**
+ * SIDECAR CACHE
+ * A 6-channel 24-bit source opens once cold (decode, then write the
+ * sidecar) and once from the sidecar, which must map identical frames
+ * without decoding. Changing one byte of the source must invalidate it.
+ */
+bool function_benchmark_sidecar() {
+    const std::string name_file = "granular_benchmark_sidecar.wav";
+    const std::string name_sidecar = function_sidecar_name(name_file);
+    const uint32_t frames = 1u << 21;
+    struct_wav_format format_file;
+    std::remove(name_sidecar.c_str());
+    if (!function_benchmark_write_wav(name_file, 6, 24, kwave_format_pcm, frames) || !function_wav_parse(name_file, format_file)) {
+        std::cerr << "  Could not write " << name_file << "\n";
+        return false;
+    }
+
+    g_status_sidecar = true;
+    std::cout << "Sidecar cache (6 ch 24-bit, " << frames << " frames)\n  ";
+    auto time_start = std::chrono::steady_clock::now();
+    bool status_all = function_source_open(name_file, format_file);
+    auto time_cold = std::chrono::steady_clock::now();
+    planar_frames_t frames_reference(global_AudioFileData.frames_planar);
+    std::cout << "  ";
+    auto time_start_hit = std::chrono::steady_clock::now();
+    status_all = status_all && function_source_open(name_file, format_file);
+    auto time_hit = std::chrono::steady_clock::now();
+    status_all = status_all && global_AudioFileData.frames_planar.empty() && global_AudioFileData.frames_total == frames;
+    for (uint16_t ch = 0; status_all && ch < 6; ++ch) {
+        status_all = std::memcmp(global_AudioFileData.samples[ch], frames_reference.data() + static_cast<size_t>(ch) * frames,
+                                 frames * sizeof(float)) == 0;
     }
+    const double ms_cold = std::chrono::duration<double, std::milli>(time_cold - time_start).count();
+    const double ms_hit = std::chrono::duration<double, std::milli>(time_hit - time_start_hit).count();
+    std::cout << "  startup: decode + write " << ms_cold << " ms, sidecar " << ms_hit << " ms ("
+              << ms_cold / ms_hit << "x)" << (status_all ? "" : "  MISMATCH") << "\n";
 
+    // Edit one sample in place: the stale sidecar must be rebuilt, not mapped
     {
-        UInt32 asbdSize = sizeof(g_output_asbd);
-        if (AudioUnitGetProperty(unit_audio,
-                                 kAudioUnitProperty_StreamFormat,
-                                 kAudioUnitScope_Input,
-                                 0,
-                                 &g_output_asbd,
-                                 &asbdSize) == noErr) {
-            g_output_is_float = (g_output_asbd.mFormatFlags & kAudioFormatFlagIsFloat) != 0;
-            g_output_non_interleaved = (g_output_asbd.mFormatFlags & kAudioFormatFlagIsNonInterleaved) != 0;
-            g_output_channels = g_output_asbd.mChannelsPerFrame;
-            g_output_bits_per_channel = g_output_asbd.mBitsPerChannel;
-            g_output_sample_rate = g_output_asbd.mSampleRate;
-            
+        std::fstream file_edit(name_file, std::ios::binary | std::ios::in | std::ios::out);
+        file_edit.seekp(static_cast<std::streamoff>(format_file.address_data + 12345), std::ios::beg);
+        file_edit.put('\x5A');
+    }
+    std::cout << "  ";
+    const bool status_rebuilt = function_source_open(name_file, format_file) && !global_AudioFileData.frames_planar.empty();
+    std::cout << "  edited source: " << (status_rebuilt ? "sidecar rebuilt" : "STALE SIDECAR USED") << "\n";
+
+    function_source_release();
+    g_status_sidecar = false;
+    std::remove(name_file.c_str());
+    std::remove(name_sidecar.c_str());
+    return status_all && status_rebuilt;
+}
 
-         std::cout << "Device output channels: " << g_output_channels << std::endl;
+/**
+ * WAV PARSER LAYOUTS
+ * The same audio written as plain RIFF, with a LIST chunk before fmt, as
+ * WAVE_FORMAT_EXTENSIBLE, as RF64 and with fmt after data must parse to the
+ * same format and load to identical samples.
+ */
+bool function_benchmark_wav_layouts() {
+    const char* const garray_names_layout[kcount_wav_layouts] = {"plain RIFF", "LIST before fmt", "extensible", "RF64/ds64",
+                                                                   "fmt after data"};
+    const std::string name_file = "granular_benchmark_layout.wav";
+    const uint16_t channels = 6;
+    const uint32_t frames = 10007;
+
+    bool status_all = true;
+    planar_frames_t frames_reference;
+    std::cout << "WAV header layouts\n";
+    for (int layout = 0; layout < kcount_wav_layouts; ++layout) {
+        struct_wav_format format_file;
+        bool status_layout = function_benchmark_write_wav(name_file, channels, 16, kwave_format_pcm, frames, layout) &&
+                             function_wav_parse(name_file, format_file) &&
+                             format_file.channels_file == channels && format_file.bits_sample == 16 &&
+                             format_file.format_tag == kwave_format_pcm && format_file.bytes_data == frames * channels * 2u &&
+                             format_file.is_rf64 == (layout == kwav_layout_rf64) &&
+                             format_file.is_extensible == (layout == kwav_layout_extensible);
+        status_layout = status_layout && function_source_load_mapped(name_file, format_file);
+        if (status_layout) {
+            planar_frames_t frames_loaded(global_AudioFileData.frames_planar);
+            if (layout == kwav_layout_plain) frames_reference = frames_loaded;
+            status_layout = (frames_loaded == frames_reference);
         }
+        std::cout << "  " << garray_names_layout[layout] << ": " << (status_layout ? "ok" : "FAILED")
+                  << " (speakers " << function_wav_speaker_layout(format_file) << ", data at byte " << format_file.address_data << ")\n";
+        status_all = status_all && status_layout;
+        function_source_release();
     }
+    std::remove(name_file.c_str());
+    return status_all;
+}
 
-    triggerChannelOrderTest(g_test_frames_per_channel,
-                            g_test_silence_frames,
-                            g_test_base_freq,
-                            g_test_freq_step);
+/**
+ * STREAMING SOURCE
+ * A fixed transposed grain cloud must render identically from the resident
+ * source and from the streaming window cache. The live scheduler then runs
+ * with the widest jitter and travel-factor settings to count underruns.
+ */
+uint64_t function_benchmark_render_hash(struct_benchmark_output& ioutput, uint32_t iblocks, bool istatus_spawn, double& ons_block,
+                                        uint16_t isource_grain = 0) {
+    const float garray_rates[] = {0.7f, 0.7937f, 1.0f, 1.2599f, 2.0f};
+    function_benchmark_fill_grains(64, isource_grain);
+    for (uint32_t index_active = 0; index_active < global_ProcessGrain.active_envelopes_grain; ++index_active) {
+        const uint32_t slot = global_ProcessGrain.array_active_grains[index_active];
+        global_ProcessGrain.pool_grains.rate_grain[slot] = garray_rates[index_active % 5];
+        global_ProcessGrain.pool_grains.frames_grain[slot] = 12288;   // Longest live grain: 8192 frames x travel factor 1.5
+    }
+    if (istatus_spawn) global_ProcessGrain.frames_until_onset = 0.0;
+    global_Limiter.status_primed = false;   // Each render starts from an empty limiter delay line
+
+    AudioUnitRenderActionFlags flags_render = 0;
+    AudioTimeStamp stamp_time{};
+    uint64_t hash_output = 1469598103934665603ull;
+    double ns_total = 0.0;
+    for (uint32_t count_block = 0; count_block < iblocks; ++count_block) {
+        auto time_start = std::chrono::steady_clock::now();
+        function_callback_audio(&global_AudioFileData, &flags_render, &stamp_time, 0, kbenchmark_block_frames, ioutput.list);
+        ns_total += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - time_start).count();
+        for (float sample : ioutput.frames_output) {
+            uint32_t bits_sample;
+            std::memcpy(&bits_sample, &sample, sizeof(bits_sample));
+            hash_output = (hash_output ^ bits_sample) * 1099511628211ull;
+        }
+    }
+    ons_block = ns_total / iblocks;
+    return hash_output;
+}
 
-    global_AudioFileData.file = &file;
-    global_AudioFileData.bytes_total_read_file = file.tellg();
-    global_AudioFileData.bytes_chunk_audio = bytes_chunk_audio;
-    global_AudioFileData.address_first_audio = static_cast<uint32_t>(file.tellg());
+void function_benchmark_streaming(struct_benchmark_output& ioutput) {
+    const std::string name_file = "granular_benchmark_stream.wav";
+    const uint32_t kframes_file = 1u << 21;
+    const uint32_t blocks_fixed = 64;
+    const uint32_t blocks_live = 6000;
+    if (!function_benchmark_write_wav(name_file, kbenchmark_channels, 16, 1, kframes_file)) return;
+
+    std::cout << "Streaming source (" << kbenchmark_channels << " ch, 64 grains)\n  ";
+    double ns_resident = 0.0, ns_streaming = 0.0, ns_live = 0.0;
+    function_benchmark_load_file(name_file);
+    const uint64_t hash_resident = function_benchmark_render_hash(ioutput, blocks_fixed, false, ns_resident);
+
+    std::cout << "  ";
+    struct_wav_format format_stream;
+    function_wav_parse(name_file, format_stream);
+    function_stream_open(name_file, format_stream);
+    const uint64_t hash_streaming = function_benchmark_render_hash(ioutput, blocks_fixed, false, ns_streaming);
+
+    const int jitter_saved = g_jitter_range;
+    const float travel_min_saved = g_travel_factor_min, travel_max_saved = g_travel_factor_max;
+    g_jitter_range = 2000;
+    g_travel_factor_min = 0.5f;
+    g_travel_factor_max = 1.5f;
+    global_StreamCache.count_underrun_frames.store(0);
+    function_benchmark_render_hash(ioutput, blocks_live, true, ns_live);
+    const uint64_t count_underrun = global_StreamCache.count_underrun_frames.load();
+    g_jitter_range = jitter_saved;
+    g_travel_factor_min = travel_min_saved;
+    g_travel_factor_max = travel_max_saved;
+    function_stream_close();
+
+    std::cout << "  fixed cloud: resident " << ns_resident / 1000.0 << " us/block, streaming " << ns_streaming / 1000.0
+              << " us/block, output " << ((hash_resident == hash_streaming) ? "identical" : "DIFFERS") << "\n"
+              << "  live scheduler, " << blocks_live << " blocks: " << ns_live / 1000.0 << " us/block, "
+              << count_underrun << " underrun frames\n";
+    std::remove(name_file.c_str());
+}
 
-    global_AudioFileData.channels_file     = channels_file;
+/**
+ * SOURCE BANK
+ * Three files of different channel counts, formats and rates load into one
+ * arena; every channel must start 64-byte aligned and hold exactly what the
+ * file loads to on its own. A fixed cloud reading bank source 1 must render
+ * identically to the same file loaded as the primary source, and the live
+ * scheduler then draws every grain from a random source.
+ */
+bool function_benchmark_source_bank(struct_benchmark_output& ioutput) {
+    struct struct_case_bank { const char* name_file; uint16_t channels; uint16_t bits; uint16_t format; uint32_t frames; uint32_t rate; };
+    const struct_case_bank garray_cases[] = {
+        {"granular_benchmark_bank_a.wav", kbenchmark_channels, 16, kwave_format_pcm, 200000, 48000},
+        {"granular_benchmark_bank_b.wav", 2, 24, kwave_format_pcm, 100003, 44100},
+        {"granular_benchmark_bank_c.wav", 1, 32, kwave_format_ieee_float, 50001, 96000},
+    };
+    std::vector<std::string> names_bank;
+    for (const struct_case_bank& bank_case : garray_cases) {
+        if (!function_benchmark_write_wav(bank_case.name_file, bank_case.channels, bank_case.bits, bank_case.format,
+                                          bank_case.frames, kwav_layout_plain, bank_case.rate)) {
+            std::cerr << "  Could not write " << bank_case.name_file << "\n";
+            return false;
+        }
+        names_bank.push_back(bank_case.name_file);
+    }
 
-    global_AudioFileData.present_frame     = 0;
-    global_AudioFileData.file_is_ieee_float = (audio_format == 3);
+    std::cout << "Source bank (" << names_bank.size() << " files)\n  ";
+    g_resample_quality = kresample_standard;
+    bool status_all = function_source_bank_load(names_bank, 48000) && global_SourceBank.count_sources == names_bank.size() + 1;
+
+    // Alignment and contents against each file loaded alone
+    for (uint32_t id_source = 1; status_all && id_source < global_SourceBank.count_sources; ++id_source) {
+        const struct_case_bank& bank_case = garray_cases[id_source - 1];
+        struct_wav_format format_file;
+        function_resampler_prepare(bank_case.rate, 48000, g_resample_quality, global_Resampler);
+        status_all = function_wav_parse(bank_case.name_file, format_file) && function_source_open(bank_case.name_file, format_file) &&
+                     global_AudioFileData.frames_total == global_SourceBank.frames_source[id_source] &&
+                     global_SourceBank.channels_source[id_source] == bank_case.channels;
+        for (uint16_t ch = 0; status_all && ch < bank_case.channels; ++ch) {
+            const float* channel_bank = function_bank_span(static_cast<uint16_t>(id_source), ch, 0, 0, nullptr);
+            status_all = reinterpret_cast<uintptr_t>(channel_bank) % kbytes_arena_align == 0 &&
+                         std::memcmp(channel_bank, global_AudioFileData.samples[ch], global_AudioFileData.frames_total * sizeof(float)) == 0;
+        }
+        function_source_release();
+    }
+    global_Resampler = struct_resampler{};
+    std::cout << "  arena layout: " << (status_all ? "aligned, contents match" : "MISMATCH") << "\n";
+
+    // Same file through bank source 1 and as the primary source
+    double ns_primary = 0.0, ns_bank = 0.0, ns_live = 0.0;
+    status_all = status_all && function_benchmark_load_file(garray_cases[0].name_file);
+    const uint64_t hash_primary = function_benchmark_render_hash(ioutput, 64, false, ns_primary, 0);
+    const uint64_t hash_bank = function_benchmark_render_hash(ioutput, 64, false, ns_bank, 1);
+    const bool status_render = status_all && hash_primary == hash_bank;
+
+    // Live scheduler drawing every grain from a random source
+    g_source_selection.store(ksource_random);
+    function_benchmark_render_hash(ioutput, 2000, true, ns_live);
+    std::cout << "  fixed cloud: primary " << ns_primary / 1000.0 << " us/block, bank " << ns_bank / 1000.0
+              << " us/block, output " << (status_render ? "identical" : "DIFFERS") << "\n"
+              << "  live scheduler, random source per grain: " << ns_live / 1000.0 << " us/block\n";
+
+    function_source_release();
+    function_source_bank_release();
+    for (const std::string& name_file : names_bank) std::remove(name_file.c_str());
+    return status_render;
+}
+
+int function_run_benchmarks() {
+    g_status_sidecar = false;   // Only the sidecar benchmark leaves caches behind (and removes them)
+    struct_benchmark_output output_benchmark;
+    function_benchmark_prepare_output(output_benchmark, kbenchmark_channels, kbenchmark_block_frames);
+    function_benchmark_prepare_engine(kbenchmark_channels, kbenchmark_source_frames);
+
+    if (!function_benchmark_kernels()) {
+        std::cerr << "Kernel variants disagree with the scalar reference.\n";
+        return 1;
+    }
+    if (!function_benchmark_output_formats()) {
+        std::cerr << "Output conversion kernels disagree with the scalar reference.\n";
+        return 1;
+    }
+    if (!function_benchmark_requantize()) {
+        std::cerr << "Requantizer vector path disagrees with the scalar path.\n";
+        return 1;
+    }
+    if (!function_benchmark_limiter()) {
+        std::cerr << "Master limiter exceeded its ceiling or altered a bus below it.\n";
+        return 1;
+    }
+    if (!function_benchmark_channel_gains()) {
+        std::cerr << "Output channel gains did not ramp to their targets.\n";
+        return 1;
+    }
+    if (!function_benchmark_null_device()) {
+        std::cerr << "The null device dropped, repeated or mis-sized blocks.\n";
+        return 1;
+    }
+    if (!function_benchmark_quantum()) {
+        std::cerr << "The engine output depends on the host block size.\n";
+        return 1;
+    }
+    function_benchmark_grain_layout(output_benchmark);
+    function_benchmark_normalization(output_benchmark);
+    function_benchmark_transposition(output_benchmark);
+    function_benchmark_source_load();   // Last: these replace the benchmark source
+    if (!function_benchmark_wav_layouts()) {
+        std::cerr << "WAV header layouts disagree.\n";
+        return 1;
+    }
+    if (!function_benchmark_decoders()) {
+        std::cerr << "Sample decoders disagree with the scalar reference.\n";
+        return 1;
+    }
+    if (!function_benchmark_parallel_decode()) {
+        std::cerr << "Parallel decode disagrees with the single-worker decode.\n";
+        return 1;
+    }
+    if (!function_benchmark_resampler()) {
+        std::cerr << "Sample-rate conversion is outside its quality bounds.\n";
+        return 1;
+    }
+    if (!function_benchmark_sidecar()) {
+        std::cerr << "Sidecar cache returned stale or different frames.\n";
+        return 1;
+    }
+    function_benchmark_streaming(output_benchmark);
+    if (!function_benchmark_source_bank(output_benchmark)) {
+        std::cerr << "Source bank layout or rendering differs from the files loaded alone.\n";
+        return 1;
+    }
+    return 0;
+}
 
-    const uint32_t bytes_sample = bits_sample/8;
+#endif // GRANULAR_BENCHMARK
 
-    global_AudioFileData.frames_total = global_AudioFileData.bytes_chunk_audio/(bytes_sample*channels_file);
+// =============================================================================
+// OFFLINE RENDER
+// =============================================================================
 
-    global_AudioFileData.samples.assign(channels_file, std::vector<float>(global_AudioFileData.frames_total));
+/**
+ * HEADLESS FASTER-THAN-REAL-TIME RENDER
+ *
+ * Drives function_callback_audio in a tight loop with a synthetic interleaved
+ * buffer list, exactly as the HAL output unit would, and streams every block
+ * to a multichannel WAV. The engine's output kernels write the file's sample
+ * format directly, so PCM renders go through the same requantizer (--dither)
+ * as an integer device. The source goes through the same pipeline as live
+ * playback (sidecar, decode, resample, source bank), so a render with a fixed
+ * --seed is a reproducible snapshot of the engine for regression tests.
+ *
+ * USAGE:
+ *   granular <source.wav> --output <render.wav> [options]
+ *
+ * The render speed is reported as a multiple of real time: seconds of audio
+ * rendered per second of wall time, counting the engine and the conversion
+ * to the file format but not the disk writes.
+ */
+struct struct_render_options {
+    std::string name_source;
+    std::string name_output;
+    std::vector<std::string> names_bank;
+    double seconds_duration = 0.0;         // 0 = the source's length
+    uint32_t channels_output = 0;          // 0 = the source's channel count
+    uint32_t rate_engine = 0;              // 0 = the source's sample rate
+    uint32_t frames_block = 512;
+    uint32_t frames_device_jitter = 0;     // Null device block-size jitter, +/- frames
+    uint32_t frames_quantum = kframes_quantum_default;   // Engine processing quantum
+    bool status_realtime = false;          // Null device pacing: real time or as fast as possible
+    uint16_t bits_output = 32;             // 16 or 24 = PCM, 32 = float
+    uint32_t frames_grain = 2048;
+    int jitter_range = 1000;
+    float interval_multiplier = 0.5f;
+    float travel_percent = 10.0f;
+    uint32_t polyphony = 8;
+    int envelope = kenvelope_hann;
+    int interpolation = kinterpolation_hermite;
+    int quality_resample = kresample_standard;
+    int quantize = kquantize_tpdf;         // Requantizer for 16/24-bit PCM
+    bool status_limiter = true;
+    float limiter_ceiling_db = -1.0f;
+    float limiter_attack_ms = 1.0f;
+    float limiter_release_ms = 80.0f;
+    float limiter_lookahead_ms = 1.5f;
+    std::vector<std::pair<uint32_t, float>> trims;   // Output channel (1-based), dB
+    std::vector<uint32_t> mutes;                     // Output channels (1-based)
+    std::string sequence;                  // Empty = every grain on all channels
+    int objects[3] = {1, 2, 3};            // Output channels (1-based) of objects 1-3
+    bool status_seeded = false;
+    uint32_t seed = 0;
+    uint64_t mb_resident_limit = 0;        // 0 = a quarter of physical memory
+    bool status_sidecar = false;           // Map and write <file>.planar decode caches
+};
 
-    file.seekg(global_AudioFileData.address_first_audio, std::ios::beg);
-    for (uint32_t count_RAM_frame = 0; count_RAM_frame < global_AudioFileData.frames_total; ++count_RAM_frame) {
-        if (bits_sample == 16) {
+void function_render_usage() {
+    std::cout << "Usage: granular <source.wav> [--output <render.wav>] [options]\n"
+              << "  Renders on the null audio device; without --output nothing is written (soak test)\n"
+              << "  --duration <seconds>     Length to render (default: the source's length)\n"
+              << "  --channels <1-16>        Output channels (default: the source's channel count)\n"
+              << "  --rate <Hz>              Engine sample rate (default: the source's rate)\n"
+              << "  --bits <16|24|32>        16/24-bit PCM or 32-bit float output (default 32)\n"
+              << "  --block <frames>         Callback block size (16-4096, default 512)\n"
+              << "  --device-jitter <frames> Vary each block size by up to this many frames (default 0)\n"
+              << "  --pace <fast|realtime>   Pull blocks as fast as possible or on the wall clock (default fast)\n"
+              << "  --quantum <frames>       Engine processing quantum (" << kframes_quantum_min << "-" << kframes_quantum_max
+              << ", default " << kframes_quantum_default << ")\n"
+              << "  --grain <frames>         Grain length (256-8192, default 2048)\n"
+              << "  --jitter <frames>        Grain launch window (0-2000, default 1000)\n"
+              << "  --density <multiplier>   Interval = grain length x this (0.1-2.0, default 0.5)\n"
+              << "  --travel <percent>       Pitch variation range (0-" << kpercent_travel_max << ", default 10; grains play at most "
+              << krate_grain_max << "x speed)\n"
+              << "  --polyphony <grains>     Maximum overlapping grains (1-" << max_density_cloud_grain << ", default 8)\n"
+              << "  --envelope <hann|tukey|gaussian|triangle>\n"
+              << "  --interpolation <linear|hermite|sinc>\n"
+              << "  --quality <draft|standard|high>   Source resampling quality\n"
+              << "  --dither <round|tpdf|first|second|e-weighted>   PCM requantizer (default tpdf)\n"
+              << "  --limiter <on|off>       Master look-ahead limiter (default on)\n"
+              << "  --ceiling <dBTP>         Limiter ceiling (-24 to 0, default -1)\n"
+              << "  --attack <ms>            Limiter attack (0.05-10, default 1, at most the look-ahead)\n"
+              << "  --release <ms>           Limiter release (1-2000, default 80)\n"
+              << "  --lookahead <ms>         Limiter look-ahead (0.1-10, default 1.5)\n"
+              << "  --trim <channel>:<dB>    Output channel trim (-60 to +6, repeatable)\n"
+              << "  --mute <channel>         Mute an output channel (repeatable)\n"
+              << "  --sequence \"<pattern>\"   Grain hopping sequence, e.g. \"1 2 3*5 x 2*7\"\n"
+              << "  --objects <a,b,c>        Output channels of objects 1-3 (default 1,2,3)\n"
+              << "  --seed <n>               Fix the grain randomness for a reproducible render\n"
+              << "  --resident-limit <MB>    Larger sources stream from disk and stay out of the bank (default "
+              << function_resident_limit_default() / (1024 * 1024) << ")\n"
+              << "  --sidecar, --no-sidecar  Cache decoded sources as <file>.planar next to them (default off)\n"
+              << "  --bank <file.wav>        Add a source bank file (repeatable)\n";
+}
 
-            std::vector<int16_t> sample16(channels_file);
+// Index of iname in inames, or -1
+int function_render_keyword(const std::string& iname, const char* const* inames, int icount) {
+    for (int index_name = 0; index_name < icount; ++index_name) {
+        if (iname == inames[index_name]) return index_name;
+    }
+    return -1;
+}
 
-            file.read(reinterpret_cast<char*>(sample16.data()),
-                      channels_file*sizeof(int16_t));
+bool function_render_parse_arguments(int argc, char* argv[], struct_render_options& ooptions) {
+    static const char* const garray_keywords_envelope[kcount_envelope_tables] = {"hann", "tukey", "gaussian", "triangle"};
+    static const char* const garray_keywords_interpolation[kcount_interpolation_modes] = {"linear", "hermite", "sinc"};
 
-            for (uint16_t ch = 0; ch < channels_file; ++ch) {
-                global_AudioFileData.samples[ch][count_RAM_frame] = sample16[ch]/32768.0f;
+    for (int index_argument = 1; index_argument < argc; ++index_argument) {
+        const std::string argument = argv[index_argument];
+        if (argument.compare(0, 2, "--") != 0) {
+            if (!ooptions.name_source.empty()) {
+                std::cerr << "Unexpected argument: " << argument << "\n";
+                return false;
             }
-        } else if (bits_sample == 32) {
-            if (global_AudioFileData.file_is_ieee_float) {
-                std::vector<float> sample32(channels_file);
-                file.read(reinterpret_cast<char*>(sample32.data()),
-                          channels_file*sizeof(float));
-                for (uint16_t ch = 0; ch < channels_file; ++ch) {
-                    global_AudioFileData.samples[ch][count_RAM_frame] = sample32[ch];
+            ooptions.name_source = argument;
+            continue;
+        }
+        if (argument == "--sidecar" || argument == "--no-sidecar") {
+            ooptions.status_sidecar = (argument == "--sidecar");
+            continue;
+        }
+        if (index_argument + 1 >= argc) {
+            std::cerr << "Missing value for " << argument << "\n";
+            return false;
+        }
+        const std::string value = argv[++index_argument];
+
+        try {
+            if (argument == "--output") {
+                ooptions.name_output = value;
+            } else if (argument == "--bank") {
+                ooptions.names_bank.push_back(value);
+            } else if (argument == "--duration") {
+                ooptions.seconds_duration = std::stod(value);
+                if (ooptions.seconds_duration <= 0.0) throw std::out_of_range(value);
+            } else if (argument == "--channels") {
+                ooptions.channels_output = static_cast<uint32_t>(std::stoul(value));
+                if (ooptions.channels_output < 1 || ooptions.channels_output > 16) throw std::out_of_range(value);
+            } else if (argument == "--rate") {
+                ooptions.rate_engine = static_cast<uint32_t>(std::stoul(value));
+                if (ooptions.rate_engine < 8000 || ooptions.rate_engine > 384000) throw std::out_of_range(value);
+            } else if (argument == "--bits") {
+                ooptions.bits_output = static_cast<uint16_t>(std::stoul(value));
+                if (ooptions.bits_output != 16 && ooptions.bits_output != 24 && ooptions.bits_output != 32) throw std::out_of_range(value);
+            } else if (argument == "--block") {
+                ooptions.frames_block = static_cast<uint32_t>(std::stoul(value));
+                if (ooptions.frames_block < 16 || ooptions.frames_block > kframes_default_slice) throw std::out_of_range(value);
+            } else if (argument == "--device-jitter") {
+                ooptions.frames_device_jitter = static_cast<uint32_t>(std::stoul(value));
+                if (ooptions.frames_device_jitter > kframes_default_slice / 2) throw std::out_of_range(value);
+            } else if (argument == "--quantum") {
+                ooptions.frames_quantum = static_cast<uint32_t>(std::stoul(value));
+                if (ooptions.frames_quantum < kframes_quantum_min || ooptions.frames_quantum > kframes_quantum_max) throw std::out_of_range(value);
+            } else if (argument == "--pace") {
+                if (value != "fast" && value != "realtime") throw std::out_of_range(value);
+                ooptions.status_realtime = (value == "realtime");
+            } else if (argument == "--grain") {
+                ooptions.frames_grain = static_cast<uint32_t>(std::stoul(value));
+                if (ooptions.frames_grain < 256 || ooptions.frames_grain > 8192) throw std::out_of_range(value);
+            } else if (argument == "--jitter") {
+                ooptions.jitter_range = std::stoi(value);
+                if (ooptions.jitter_range < 0 || ooptions.jitter_range > 2000) throw std::out_of_range(value);
+            } else if (argument == "--density") {
+                ooptions.interval_multiplier = std::stof(value);
+                if (ooptions.interval_multiplier < 0.1f || ooptions.interval_multiplier > 2.0f) throw std::out_of_range(value);
+            } else if (argument == "--travel") {
+                ooptions.travel_percent = std::stof(value);
+                if (ooptions.travel_percent < 0.0f || ooptions.travel_percent > kpercent_travel_max) throw std::out_of_range(value);
+            } else if (argument == "--polyphony") {
+                ooptions.polyphony = static_cast<uint32_t>(std::stoul(value));
+                if (ooptions.polyphony < 1 || ooptions.polyphony > static_cast<uint32_t>(max_density_cloud_grain)) throw std::out_of_range(value);
+            } else if (argument == "--envelope") {
+                ooptions.envelope = function_render_keyword(value, garray_keywords_envelope, kcount_envelope_tables);
+                if (ooptions.envelope < 0) throw std::out_of_range(value);
+            } else if (argument == "--interpolation") {
+                ooptions.interpolation = function_render_keyword(value, garray_keywords_interpolation, kcount_interpolation_modes);
+                if (ooptions.interpolation < 0) throw std::out_of_range(value);
+            } else if (argument == "--quality") {
+                ooptions.quality_resample = -1;
+                for (int quality = 0; quality < kcount_resample_qualities; ++quality) {
+                    if (value == garray_resample_qualities[quality].name_quality) ooptions.quality_resample = quality;
                 }
-            } else {
-                std::vector<int32_t> sample32i(channels_file);
-                file.read(reinterpret_cast<char*>(sample32i.data()),
-                          channels_file*sizeof(int32_t));
-                for (uint16_t ch = 0; ch < channels_file; ++ch) {
-                    global_AudioFileData.samples[ch][count_RAM_frame] =
-                        std::clamp(static_cast<float>(sample32i[ch]) / 2147483647.0f, -1.0f, 1.0f);
+                if (ooptions.quality_resample < 0) throw std::out_of_range(value);
+            } else if (argument == "--dither") {
+                ooptions.quantize = -1;
+                for (int mode = 0; mode < kcount_quantize_modes; ++mode) {
+                    if (value == garray_quantize_modes[mode].keyword_mode) ooptions.quantize = mode;
                 }
+                if (ooptions.quantize < 0) throw std::out_of_range(value);
+            } else if (argument == "--limiter") {
+                if (value != "on" && value != "off") throw std::out_of_range(value);
+                ooptions.status_limiter = (value == "on");
+            } else if (argument == "--ceiling") {
+                ooptions.limiter_ceiling_db = std::stof(value);
+                if (ooptions.limiter_ceiling_db < -24.0f || ooptions.limiter_ceiling_db > 0.0f) throw std::out_of_range(value);
+            } else if (argument == "--attack") {
+                ooptions.limiter_attack_ms = std::stof(value);
+                if (ooptions.limiter_attack_ms < 0.05f || ooptions.limiter_attack_ms > kms_lookahead_max) throw std::out_of_range(value);
+            } else if (argument == "--release") {
+                ooptions.limiter_release_ms = std::stof(value);
+                if (ooptions.limiter_release_ms < 1.0f || ooptions.limiter_release_ms > 2000.0f) throw std::out_of_range(value);
+            } else if (argument == "--lookahead") {
+                ooptions.limiter_lookahead_ms = std::stof(value);
+                if (ooptions.limiter_lookahead_ms < 0.1f || ooptions.limiter_lookahead_ms > kms_lookahead_max) throw std::out_of_range(value);
+            } else if (argument == "--trim") {
+                const size_t index_separator = value.find(':');
+                if (index_separator == std::string::npos) throw std::invalid_argument(value);
+                const uint32_t channel_trim = static_cast<uint32_t>(std::stoul(value.substr(0, index_separator)));
+                const float trim_db = std::stof(value.substr(index_separator + 1));
+                if (channel_trim < 1 || channel_trim > kcount_channels_gain ||
+                    trim_db < kdb_channel_trim_min || trim_db > kdb_channel_trim_max) throw std::out_of_range(value);
+                ooptions.trims.push_back({channel_trim, trim_db});
+            } else if (argument == "--mute") {
+                ooptions.mutes.push_back(static_cast<uint32_t>(std::stoul(value)));
+                if (ooptions.mutes.back() < 1 || ooptions.mutes.back() > kcount_channels_gain) throw std::out_of_range(value);
+            } else if (argument == "--sequence") {
+                ooptions.sequence = value;
+                function_sequence_parse(value);   // Throws on malformed tokens
+            } else if (argument == "--objects") {
+                char separator_first = 0, separator_second = 0;
+                std::istringstream stream_objects(value);
+                if (!(stream_objects >> ooptions.objects[0] >> separator_first >> ooptions.objects[1]
+                                     >> separator_second >> ooptions.objects[2]) ||
+                    separator_first != ',' || separator_second != ',') throw std::invalid_argument(value);
+            } else if (argument == "--resident-limit") {
+                ooptions.mb_resident_limit = std::stoull(value);
+                if (ooptions.mb_resident_limit < 1) throw std::out_of_range(value);
+            } else if (argument == "--seed") {
+                ooptions.seed = static_cast<uint32_t>(std::stoul(value));
+                ooptions.status_seeded = true;
+            } else {
+                std::cerr << "Unknown option: " << argument << "\n";
+                return false;
             }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << argument << ": " << value << "\n";
+            return false;
         }
     }
 
-    global_ProcessGrain.frames_object_grain = 2048;
-    global_ProcessGrain.frames_common_grains = 3;
-    global_ProcessGrain.count_present_frame = 0;
-    global_ProcessGrain.active_envelopes_grain = 0;
+    if (ooptions.name_source.empty()) {
+        std::cerr << "A source file is required.\n";
+        return false;
+    }
+    if (ooptions.frames_device_jitter >= ooptions.frames_block) {
+        std::cerr << "--device-jitter must be smaller than --block.\n";
+        return false;
+    }
+    return true;
+}
 
-    AURenderCallbackStruct structure_callback_audio;
-    structure_callback_audio.inputProc = function_callback_audio;
-    structure_callback_audio.inputProcRefCon = &global_AudioFileData;
+/**
+ * RIFF header for the render: plain PCM/float fmt for mono and stereo,
+ * WAVE_FORMAT_EXTENSIBLE (no speaker mask) above two channels. Written once
+ * with the final sizes, which are known before rendering starts.
+ */
+void function_render_write_header(std::ofstream& ofile, uint16_t ichannels, uint32_t irate, uint16_t ibits, uint32_t ibytes_data) {
+    auto function_put = [&ofile](const void* ibytes, std::streamsize icount) {
+        ofile.write(static_cast<const char*>(ibytes), icount);
+    };
+    const bool status_extensible = ichannels > 2;
+    const uint16_t format_sample = (ibits == 32) ? kwave_format_ieee_float : kwave_format_pcm;
+    const uint16_t format_tag = status_extensible ? kwave_format_extensible : format_sample;
+    const uint32_t bytes_fmt = status_extensible ? 40 : 16;
+    const uint16_t bytes_block = ichannels * (ibits / 8);
+    const uint32_t bytes_per_second = irate * bytes_block;
+    const uint32_t bytes_riff = 4 + (8 + bytes_fmt) + (8 + ibytes_data);
+
+    function_put("RIFF", 4); function_put(&bytes_riff, 4); function_put("WAVE", 4);
+    function_put("fmt ", 4); function_put(&bytes_fmt, 4);
+    function_put(&format_tag, 2); function_put(&ichannels, 2);
+    function_put(&irate, 4); function_put(&bytes_per_second, 4);
+    function_put(&bytes_block, 2); function_put(&ibits, 2);
+    if (status_extensible) {
+        const uint16_t bytes_extension = 22;
+        const uint32_t mask_channels = 0;
+        const unsigned char kguid_tail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00,
+                                              0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+        function_put(&bytes_extension, 2); function_put(&ibits, 2); function_put(&mask_channels, 4);
+        function_put(&format_sample, 2); function_put(kguid_tail, sizeof(kguid_tail));
+    }
+    function_put("data", 4); function_put(&ibytes_data, 4);
+}
 
-    status_unit_audio = AudioUnitSetProperty(unit_audio,
-                                            kAudioUnitProperty_SetRenderCallback, 
-                                            kAudioUnitScope_Input, 
-                                            0, 
-                                            &structure_callback_audio,
-                                            sizeof(structure_callback_audio));
-    if (status_unit_audio != noErr) {
-        std::cerr << "Rendering error: " << status_unit_audio << " \n";
-        AudioComponentInstanceDispose(unit_audio);
-        return;
-    } else {
-        std::cout << "Audio units render.\n\n";
+// 24-bit PCM: the top three bytes of each left-justified int32 word from the output kernel
+void function_render_pack_int24(const int32_t* iwords, size_t icount, unsigned char* odestination) {
+    for (size_t index_word = 0; index_word < icount; ++index_word) {
+        const uint32_t word = static_cast<uint32_t>(iwords[index_word]);
+        odestination[3 * index_word] = static_cast<unsigned char>(word >> 8);
+        odestination[3 * index_word + 1] = static_cast<unsigned char>(word >> 16);
+        odestination[3 * index_word + 2] = static_cast<unsigned char>(word >> 24);
     }
+}
 
-    status_unit_audio = AudioUnitInitialize(unit_audio);
-    if (status_unit_audio != noErr) {
-        std::cerr << "Audio initialization error: " << status_unit_audio << " \n";
-        AudioComponentInstanceDispose(unit_audio);
-        return;
+// Null device sink: appends each rendered interleaved block to the WAV
+struct struct_render_sink {
+    std::ofstream* file_output;
+    uint16_t bits_output;
+    uint32_t channels_output;
+    std::vector<unsigned char> bytes_block;   // 24-bit packing scratch, largest block
+};
+
+void function_render_sink(const AudioBufferList* ilist, UInt32 iframes, void* icontext) {
+    struct_render_sink& sink = *static_cast<struct_render_sink*>(icontext);
+    const size_t count_samples = static_cast<size_t>(iframes) * sink.channels_output;
+    if (sink.bits_output == 24) {
+        function_render_pack_int24(static_cast<const int32_t*>(ilist->mBuffers[0].mData), count_samples, sink.bytes_block.data());
+        sink.file_output->write(reinterpret_cast<const char*>(sink.bytes_block.data()), static_cast<std::streamsize>(count_samples * 3));
     } else {
-        std::cout << "Audio initialized.\n";
+        sink.file_output->write(static_cast<const char*>(ilist->mBuffers[0].mData), static_cast<std::streamsize>(count_samples * (sink.bits_output / 8)));
     }
+}
 
-    std::cout << "Calling audio into units.\n";
+int function_render_offline(const struct_render_options& ioptions) {
+    struct_wav_format format_file;
+    if (!function_wav_parse(ioptions.name_source, format_file)) return 1;
+    if (format_file.channels_file > 16) {
+        std::cerr << "Unsupported channel count: " << format_file.channels_file << " (max 16)\n";
+        return 1;
+    }
 
-    status_unit_audio = AudioOutputUnitStart(unit_audio);
-    if (status_unit_audio != noErr) {
-        std::cerr << "Output playback error: " << status_unit_audio << " \n";
-        return;
-    } else {
-        std::cout << "Output playback starts.\n";
+    function_shape_envelope();
+    function_shape_sinc_table();
+    function_kernel_select();
+
+    // Engine parameters, as the live controls would set them
+    const uint32_t rate_engine = ioptions.rate_engine ? ioptions.rate_engine : format_file.rate_samples;
+    const uint32_t channels_output = ioptions.channels_output ? ioptions.channels_output : format_file.channels_file;
+    g_output_sample_rate = rate_engine;
+    g_resample_quality = ioptions.quality_resample;
+    if (ioptions.mb_resident_limit) g_bytes_resident_limit = ioptions.mb_resident_limit << 20;
+    g_status_sidecar = ioptions.status_sidecar;
+    global_ProcessGrain.frames_object_grain = ioptions.frames_grain;
+    global_ProcessGrain.frames_common_grains = 3;
+    global_ProcessGrain.frames_until_onset = 0.0;
+    g_jitter_range = ioptions.jitter_range;
+    g_interval_multiplier = ioptions.interval_multiplier;
+    g_travel_factor_min = 1.0f - ioptions.travel_percent / 100.0f;
+    g_travel_factor_max = 1.0f + ioptions.travel_percent / 100.0f;
+    g_grain_polyphony.store(ioptions.polyphony);
+    g_envelope_active.store(&garray_envelope_tables[ioptions.envelope]);
+    g_interpolation_mode.store(ioptions.interpolation);
+    for (int object = 0; object < 3; ++object) {
+        const int channel_object = std::clamp(ioptions.objects[object], 1, static_cast<int>(channels_output)) - 1;
+        garray_channel_anchor[object] = static_cast<uint16_t>(channel_object);
+        g_original_sequence_channels[object] = static_cast<uint16_t>(channel_object);
     }
+    g_use_grain_hopping = !ioptions.sequence.empty();
+    g_grain_sequence = function_sequence_parse(ioptions.sequence);
+    g_original_sequence_string = ioptions.sequence;
+    g_sequence_position = 0;
+    if (ioptions.status_seeded) g_rng_grain.seed(ioptions.seed);
+
+    // Bank files borrow global_AudioFileData, so they load before the primary source
+    if (!ioptions.names_bank.empty()) function_source_bank_load(ioptions.names_bank, rate_engine);
+    function_resampler_prepare(format_file.rate_samples, rate_engine, g_resample_quality, global_Resampler);
+    if (!function_source_open(ioptions.name_source, format_file)) return 1;
+    global_AudioFileData.present_frame = 0;
+    function_grain_pool_reset();
+
+    g_frames_quantum = ioptions.frames_quantum;
+    g_quantize_mode.store(ioptions.quantize);
+    g_limiter_enabled.store(ioptions.status_limiter);
+    g_limiter_ceiling_db.store(ioptions.limiter_ceiling_db);
+    g_limiter_attack_ms.store(ioptions.limiter_attack_ms);
+    g_limiter_release_ms.store(ioptions.limiter_release_ms);
+    g_limiter_lookahead_ms.store(ioptions.limiter_lookahead_ms);
+    function_channel_gains_reset();
+    for (const auto& trim : ioptions.trims) garray_channel_gains[trim.first - 1].trim.store(std::pow(10.0f, trim.second / 20.0f));
+    for (uint32_t channel_muted : ioptions.mutes) garray_channel_gains[channel_muted - 1].mute.store(true);
+    g_run_channel_order_test = false;
+    g_status_audio_playback = true;
 
-    std::cout << "Listening for channel order test...\n";
-    while (g_run_channel_order_test) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const uint64_t frames_render = (ioptions.seconds_duration > 0.0)
+        ? static_cast<uint64_t>(std::llround(ioptions.seconds_duration * rate_engine))
+        : global_AudioFileData.frames_total;
+    const uint32_t bytes_frame = channels_output * (ioptions.bits_output / 8);
+    const bool status_file = !ioptions.name_output.empty();
+    if (status_file && frames_render * bytes_frame > 0xFFFFFFFFull - 80) {
+        std::cerr << "The render would exceed the 4 GB WAV limit; shorten --duration or use fewer channels.\n";
+        return 1;
     }
-    std::cout << "Channel test complete!\n\n";
-    
-    // ========================================================================
-    // ============ NEW: POST-SINE-TEST SUBWOOFER ANALYSIS MESSAGE ============
-    // ========================================================================
-    // After users have heard the sine test, help them interpret what they heard
-    // This is more accurate than just assuming based on channel count
-    if (g_output_channels == 6) {
-        std::cout << "📊 SINE TEST ANALYSIS (6-channel system detected):\n";
-        std::cout << "Based on standard 5.1 surround conventions, Channel 4 is typically LFE (subwoofer).\n";
-        std::cout << "If you noticed that Channel 4 sounded different (bass-heavy, no sound, or\n";
-        std::cout << "only low frequencies), it's likely the LFE/subwoofer channel.\n";
-        std::cout << "💡 TIP: For spatial granular synthesis, consider using channels 1,2,3,5,6\n";
-        std::cout << "to avoid unintended subwoofer effects in your grain sequences.\n\n";
+
+    // Null device with one interleaved buffer in the file's sample format, so the engine's
+    // output kernels (and requantizer, for PCM) write the file samples; 24-bit comes from int32
+    struct_null_device_config& config = g_null_device_config;
+    config = struct_null_device_config{};
+    config.rate = rate_engine;
+    config.channels = channels_output;
+    config.frames_block = ioptions.frames_block;
+    config.frames_jitter = ioptions.frames_device_jitter;
+    config.status_realtime = ioptions.status_realtime;
+    config.frames_total = frames_render;
+    config.seed = ioptions.status_seeded ? ioptions.seed : 1;
+    config.is_float = (ioptions.bits_output == 32);
+    config.non_interleaved = false;
+    config.bits = (ioptions.bits_output == 16) ? 16 : 32;
+
+    std::ofstream file_output;
+    struct_render_sink sink{&file_output, ioptions.bits_output, channels_output, {}};
+    if (status_file) {
+        file_output.open(ioptions.name_output, std::ios::binary);
+        if (!file_output) {
+            std::cerr << "Could not create " << ioptions.name_output << "\n";
+            return 1;
+        }
+        function_render_write_header(file_output, static_cast<uint16_t>(channels_output), rate_engine, ioptions.bits_output,
+                                     static_cast<uint32_t>(frames_render * bytes_frame));
+        sink.bytes_block.resize(static_cast<size_t>(ioptions.frames_block + ioptions.frames_device_jitter) * bytes_frame);
+        config.function_sink = function_render_sink;
+        config.context_sink = &sink;
     }
-    // ========================================================================
-    
-    // ========================================================================
-    // ========== COMMENTED OUT: CHANNEL OFFSET SETUP FUNCTION CALL ==========
-    // ========================================================================
-    // ISSUE: This was calling the channel rotation interface when we only want
-    // the subwoofer warning (which appears in setupGrainHopping function)
-    // SOLUTION: Comment out this call to disable rotation/shifting interface
-    // NOTE: The subwoofer warning still appears in setupGrainHopping()
-    // setupChannelOffset();  // COMMENTED OUT - rotation interface disabled
-    // ========================================================================
-    
-    function_anchor_configure(g_output_channels);
 
-    g_status_audio_playback = false;
-    
-    setupGrainHopping();
-    
-    // THE AUDIO PLAYBACK IS MONITORED AT THE INTERACTIVE FUNCTION NOW
-    // Instead of exiting exactly when the audio time has passed, the audio starts outputting silence
-    // File reader stops at the end of audio chunk before callback continues to loop in silence (0.0f)
+    const struct_audio_backend& backend = global_BackendNull;
+    struct_backend_format format_stream;
+    if (!backend.function_open(format_stream, function_callback_audio, &global_AudioFileData)) return 1;
+    function_engine_adopt_format(format_stream, format_file.channels_file);   // Not latency-compensated: the limiter delay leads the file
 
-    // std::this_thread::sleep_for(std::chrono::seconds(bytes_chunk_audio/(channels_file*((rate_samples)*(bits_sample/8)))));
+    std::cout << "Rendering " << frames_render << " frames (" << static_cast<double>(frames_render) / rate_engine << " s) x "
+              << channels_output << " channels at " << rate_engine << " Hz to "
+              << (status_file ? ioptions.name_output : std::string("the null device only")) << "\n";
 
-    // Start live control monitoring instead of just waiting for audio to finish
-    std::cout << "\nAudio starting:";
-    std::cout << "Live controls:\n\n";
-        flive_control_monitor(unit_audio, file, channels_file,
-                       rate_samples, bits_sample, audio_format, selection_device);
+    backend.function_start();
+    function_null_device_wait();
+    backend.function_close();
 
-    AudioOutputUnitStop(unit_audio);
-    AudioComponentInstanceDispose(unit_audio);
-    std::cout << "Stopped and disposed audio unit.\n\n";
+    if (status_file) {
+        file_output.close();
+        if (!file_output) {
+            std::cerr << "Could not write " << ioptions.name_output << "\n";
+            return 1;
+        }
+    }
+
+    const double seconds_audio = static_cast<double>(frames_render) / rate_engine;
+    const double seconds_engine = global_NullDevice.stats.ns_render_total * 1e-9;
+    std::cout << "Rendered " << seconds_audio << " s in " << seconds_engine << " s: "
+              << (seconds_engine > 0.0 ? seconds_audio / seconds_engine : 0.0) << "x real time ("
+              << global_ProcessGrain.active_envelopes_grain << " grains sounding at the end)\n";
+    function_null_device_report();
+
+    function_stream_close();
+    function_source_release();
+    function_source_bank_release();
+    return 0;
 }
 
 // =============================================================================
@@ -1984,9 +7610,30 @@ void playAudioFile(const std::string& name_file,
  * - Professional audio software development practices
  * - Mathematical foundations of digital audio processing
  * 
+ * With command-line arguments (or in headless builds) the application renders
+ * offline to WAV instead of opening a device (see OFFLINE RENDER).
+ *
  * @return int Application exit status (0 = success, 1 = error)
  */
-int main() {
+int main(int argc, char* argv[]) {
+#ifdef GRANULAR_BENCHMARK
+    // Benchmark builds measure the engine without a device or user input
+    return function_run_benchmarks();
+#endif
+
+    if (argc > 1) {
+        struct_render_options options_render;
+        if (!function_render_parse_arguments(argc, argv, options_render)) {
+            function_render_usage();
+            return 1;
+        }
+        return function_render_offline(options_render);
+    }
+#ifdef GRANULAR_HEADLESS
+    function_render_usage();
+    return 1;
+#else
+
     // Initialize and demonstrate the sequence parsing system
     function_print_vector();
 
@@ -2002,37 +7649,41 @@ int main() {
 
     std::cout << name_file << "\n";
 
-    function_shape_envelope();
-
-    file.seekg(22, std::ios::beg);
-    unsigned char bytes_channels_file[2];
-    file.read(reinterpret_cast<char*>(bytes_channels_file), sizeof(bytes_channels_file));
-    uint16_t channels_file = 0;
-    for (int a = 0; a < sizeof(bytes_channels_file); a++) {
-        channels_file |= (static_cast<uint16_t>(bytes_channels_file[a]) << (a * 8));
+    // Optional source bank: more files the grains can draw from (live key 'b')
+    std::cout << "Add more WAV files to the source bank (one name per line, '.' to finish):\n";
+    std::string name_bank;
+    while (std::cin >> name_bank && name_bank != ".") {
+        g_names_bank.push_back(name_bank);
     }
-    
-    uint32_t rate_samples; 
-    file.read(reinterpret_cast<char*>(&rate_samples), sizeof(rate_samples));
-    
-    file.seekg(34, std::ios::beg);
-    uint16_t bits_sample; 
-    file.read(reinterpret_cast<char*>(&bits_sample), sizeof(bits_sample));
 
-    // Parse audio format from WAV header (position 20-21)
-    file.seekg(20, std::ios::beg);
-    uint16_t audio_format = 1; // Default to PCM format for safety
-    file.read(reinterpret_cast<char*>(&audio_format), sizeof(audio_format));
+    // Decode caches are written next to the sources, so they are opt-in
+    std::cout << "Cache decoded sources as <file>.planar next to them for faster restarts? (y/n): ";
+    std::string choice_sidecar;
+    std::cin >> choice_sidecar;
+    g_status_sidecar = (choice_sidecar == "y" || choice_sidecar == "Y");
+
+    function_shape_envelope();
+    function_shape_sinc_table();
+    function_kernel_select();
 
+    // Walk the RIFF/RF64 chunks once; the descriptor feeds both the loader and the engine
     file.close();
+    struct_wav_format format_file;
+    if (!function_wav_parse(name_file, format_file)) {
+        return 1;
+    }
 
     std::cout << "File information: \n";
-    std::cout << "Number of channels: " << channels_file << "\n";
-    std::cout << "Sample rate: " << rate_samples << "\n";
-    std::cout << "Bit resolution: " << bits_sample << "\n\n";
-
-    if (channels_file > 16) {
-        std::cerr << "Unsupported channel count: " << channels_file << " (max 16)\n";
+    std::cout << "Container: " << (format_file.is_rf64 ? "RF64" : "RIFF")
+              << (format_file.is_extensible ? " (WAVE_FORMAT_EXTENSIBLE)" : "") << "\n";
+    std::cout << "Number of channels: " << format_file.channels_file << "\n";
+    std::cout << "Speaker layout: " << function_wav_speaker_layout(format_file) << "\n";
+    std::cout << "Sample rate: " << format_file.rate_samples << "\n";
+    std::cout << "Bit resolution: " << format_file.bits_valid << " (" << format_file.bits_sample << "-bit "
+              << ((format_file.format_tag == kwave_format_ieee_float) ? "float" : "PCM") << ")\n\n";
+
+    if (format_file.channels_file > 16) {
+        std::cerr << "Unsupported channel count: " << format_file.channels_file << " (max 16)\n";
         return 1;
     }
 
@@ -2049,7 +7700,8 @@ int main() {
         return 1;
     }
 
-    playAudioFile(name_file, selection_verified_device, channels_file, rate_samples, bits_sample, audio_format, file);
+    playAudioFile(name_file, selection_verified_device, format_file, file);
 
     return 0;
+#endif
 }